@@ -0,0 +1,1409 @@
+/**
+ * @file    cbrng.c
+ * @brief   Counter-based random number generator
+ *
+ * Philox4x32-10 (Salmon et al. 2011, "Parallel random numbers: as easy as
+ * 1, 2, 3"). The 128-bit counter is built from the pixel block index (low
+ * 64 bits) and the frame index (high 64 bits), the key is the seed.
+ * Pixel ii of frame f only depends on (seed, f, ii), so the image can be
+ * split in independent chunks processed by any number of threads.
+ *
+ * Poisson and gamma deviates use one Philox block per pixel (block index =
+ * pixel index, key word 1 flagged with CBRNG_KEY_PERPIXEL). Their batch
+ * kernels evaluate a vectorized candidate and acceptance test; rejected
+ * pixels draw further blocks with the attempt number folded into key
+ * word 0.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "CommandLineInterface/CLIcore.h"
+
+#include "cbrng.h"
+
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+
+// number of pixels per work unit, must be a multiple of 4
+#define CBRNG_CHUNK 4096
+
+// key flag of per-pixel block distributions
+#define CBRNG_KEY_PERPIXEL 0x80000000U
+
+// Poisson : inversion below this mean, PTRS transformed rejection above
+#define CBRNG_POISSON_SMALL 10.0f
+
+#ifdef HAVE_LIBGOMP
+#define CBRNG_PRAGMA_SIMD _Pragma("omp simd")
+#else
+#define CBRNG_PRAGMA_SIMD
+#endif
+
+void cbrng_philox4x32(const uint32_t ctr[4],
+                      const uint32_t key[2],
+                      uint32_t       out[4])
+{
+    uint32_t c0 = ctr[0];
+    uint32_t c1 = ctr[1];
+    uint32_t c2 = ctr[2];
+    uint32_t c3 = ctr[3];
+    uint32_t k0 = key[0];
+    uint32_t k1 = key[1];
+
+    for(int round = 0; round < 10; round++)
+    {
+        uint64_t p0 = (uint64_t) PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t) PHILOX_M1 * c2;
+
+        c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t) p1;
+        c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t) p0;
+
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+/**
+ * @brief Philox block of counter {blk, frame}, inlined in vector loops
+ */
+static inline void cbrng_block(uint32_t *restrict out,
+                               uint64_t blk,
+                               uint64_t frame,
+                               uint32_t k0,
+                               uint32_t k1)
+{
+    uint32_t c0 = (uint32_t) blk;
+    uint32_t c1 = (uint32_t)(blk >> 32);
+    uint32_t c2 = (uint32_t) frame;
+    uint32_t c3 = (uint32_t)(frame >> 32);
+
+    for(int round = 0; round < 10; round++)
+    {
+        uint64_t p0 = (uint64_t) PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t) PHILOX_M1 * c2;
+
+        c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t) p1;
+        c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t) p0;
+
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+/**
+ * @brief Fill buf with nblk consecutive Philox blocks starting at blk0
+ *
+ * Written as a flat loop over independent blocks so that the compiler can
+ * vectorize it.
+ */
+static void cbrng_blocks(uint32_t *restrict buf,
+                         uint64_t blk0,
+                         uint64_t nblk,
+                         uint32_t k0,
+                         uint32_t k1,
+                         uint64_t frame)
+{
+#ifdef HAVE_LIBGOMP
+    #pragma omp simd
+#endif
+    for(uint64_t blk = 0; blk < nblk; blk++)
+    {
+        cbrng_block(buf + 4 * blk, blk0 + blk, frame, k0, k1);
+    }
+}
+
+/**
+ * @brief Fill buf with Philox blocks blk0 + idx[0..n-1]
+ */
+static void cbrng_blocks_list(uint32_t *restrict buf,
+                              uint64_t blk0,
+                              const uint32_t *restrict idx,
+                              uint64_t n,
+                              uint32_t k0,
+                              uint32_t k1,
+                              uint64_t frame)
+{
+#ifdef HAVE_LIBGOMP
+    #pragma omp simd
+#endif
+    for(uint64_t j = 0; j < n; j++)
+    {
+        cbrng_block(buf + 4 * j, blk0 + idx[j], frame, k0, k1);
+    }
+}
+
+// uniform in [0,1)
+static inline float cbrng_u32_to_uniform(uint32_t x)
+{
+    return (x >> 8) * (1.0f / 16777216.0f);
+}
+
+/**
+ * @brief uniform in (0,1] for log arguments
+ *
+ * 31 random bits, resolution 2^-32 near 0: -2 ln(u) reaches 44.4, so
+ * Box-Muller deviates extend to 6.66 sigma instead of 5.77 sigma with
+ * 24 bits. Signed conversion keeps the loops vectorizable.
+ */
+static inline float cbrng_u32_to_uniform_tail(uint32_t x)
+{
+    return ((int32_t)(x >> 1) + 0.5f) * (1.0f / 2147483648.0f);
+}
+
+/**
+ * @brief Natural log, branch-free (Cephes logf polynomial)
+ *
+ * Valid for normal positive x, relative error ~1e-7. Written with selects
+ * only so that loops calling it vectorize.
+ */
+static inline float cbrng_logf(float x)
+{
+    union
+    {
+        float    f;
+        uint32_t i;
+    } u = {x};
+
+    // x = m * 2^e, m in [0.5,1)
+    float e = (float)((int32_t)((u.i >> 23) & 0xff) - 126);
+    u.i     = (u.i & 0x007fffff) | 0x3f000000;
+    float m = u.f;
+
+    // m in [sqrt(0.5), sqrt(2))
+    float small = (float)(m < 0.70710678f);
+    e -= small;
+    m = m * (1.0f + small) - 1.0f;
+
+    float z = m * m;
+    float y = 7.0376836292E-2f;
+    y       = y * m - 1.1514610310E-1f;
+    y       = y * m + 1.1676998740E-1f;
+    y       = y * m - 1.2420140846E-1f;
+    y       = y * m + 1.4249322787E-1f;
+    y       = y * m - 1.6668057665E-1f;
+    y       = y * m + 2.0000714765E-1f;
+    y       = y * m - 2.4999993993E-1f;
+    y       = y * m + 3.3333331174E-1f;
+    y *= m * z;
+    y += -2.12194440E-4f * e;
+    y += -0.5f * z;
+
+    return m + y + 0.693359375f * e;
+}
+
+/**
+ * @brief cos(2 pi t), sin(2 pi t) for t in [0,1), branch-free
+ *
+ * Reduction to [-pi/4, pi/4] by quadrant, Cephes minimax polynomials.
+ * Absolute error ~1e-7. Quadrant rotation is done with arithmetic rather
+ * than branches so that loops calling it vectorize.
+ */
+static inline void cbrng_sincos2pi(float t, float *c, float *s)
+{
+    float q  = (float)((int32_t)(4.0f * t + 0.5f));
+    float ph = (4.0f * t - q) * (float)(M_PI / 2.0);
+    float p2 = ph * ph;
+    int   iq = ((int32_t) q) & 3;
+
+    float sp = ph + ph * p2 *
+               (-1.6666654611E-1f +
+                p2 * (8.3321608736E-3f + p2 * (-1.9515295891E-4f)));
+    float cp = 1.0f - 0.5f * p2 +
+               p2 * p2 *
+               (4.166664568298827E-2f +
+                p2 * (-1.388731625493765E-3f + p2 * 2.443315711809948E-5f));
+
+    // rotate by quadrant
+    float swap  = (float)(iq & 1);
+    float signc = 1.0f - 2.0f * (float)(((iq + 1) >> 1) & 1);
+    float signs = 1.0f - 2.0f * (float)((iq >> 1) & 1);
+
+    *c = signc * (cp + swap * (sp - cp));
+    *s = signs * (sp + swap * (cp - sp));
+}
+
+/**
+ * @brief Box-Muller transform of a random word pair
+ *
+ * Words 2k and 2k+1 of each chunk produce the two normal deviates written
+ * at positions 2k and 2k+1.
+ */
+static inline void
+cbrng_boxmuller(uint32_t x0, uint32_t x1, float *z0, float *z1)
+{
+    // u1 in (0,1] avoids log(0)
+    float u1 = cbrng_u32_to_uniform_tail(x0);
+    float u2 = cbrng_u32_to_uniform(x1);
+    float r  = sqrtf(-2.0f * cbrng_logf(u1));
+    float c, s;
+
+    cbrng_sincos2pi(u2, &c, &s);
+    *z0 = r * c;
+    *z1 = r * s;
+}
+
+/**
+ * @brief Batch gaussian sampler
+ *
+ * Fills v[0..n-1] from random words w[0..n] (n rounded up to even).
+ */
+static void cbrng_gauss_batch(float *restrict v,
+                              const uint32_t *restrict w,
+                              uint64_t n)
+{
+    uint64_t npair = n / 2;
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp simd
+#endif
+    for(uint64_t k = 0; k < npair; k++)
+    {
+        float z0, z1;
+        cbrng_boxmuller(w[2 * k], w[2 * k + 1], &z0, &z1);
+        v[2 * k]     = z0;
+        v[2 * k + 1] = z1;
+    }
+    if(n & 1)
+    {
+        float z0, z1;
+        cbrng_boxmuller(w[n - 1], w[n], &z0, &z1);
+        v[n - 1] = z0;
+    }
+}
+
+// truncated gaussian inverse CDF table size (intervals)
+#define CBRNG_GAUSSTRC_TABLESIZE 4096
+
+static float          gausstrc_table[CBRNG_GAUSSTRC_TABLESIZE + 2];
+static pthread_once_t gausstrc_table_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Build truncated gaussian inverse CDF table
+ *
+ * Entry k is the deviate z such that the truncated CDF equals
+ * k / CBRNG_GAUSSTRC_TABLESIZE. Linear interpolation error is below 1e-7
+ * (h^2/8 * max|z''|, with max|z''| ~ 8 at the truncation limit).
+ */
+static void cbrng_gausstrc_table_init()
+{
+    double a  = CBRNG_GAUSSTRC_LIMIT;
+    double p0 = 0.5 * erfc(a / M_SQRT2);
+    double p1 = 1.0 - p0;
+    double z  = -a;
+
+    for(int k = 0; k <= CBRNG_GAUSSTRC_TABLESIZE; k++)
+    {
+        double p = p0 + (p1 - p0) * k / CBRNG_GAUSSTRC_TABLESIZE;
+
+        // Newton iterations on the normal CDF, starting from previous entry
+        for(int iter = 0; iter < 20; iter++)
+        {
+            double dp  = 0.5 * erfc(-z / M_SQRT2) - p;
+            double pdf = exp(-0.5 * z * z) / sqrt(2.0 * M_PI);
+            z -= dp / pdf;
+            if(fabs(dp) < 1e-15)
+            {
+                break;
+            }
+        }
+        gausstrc_table[k] = (float) z;
+    }
+    // guard entry for interpolation at u -> 1
+    gausstrc_table[CBRNG_GAUSSTRC_TABLESIZE + 1] =
+        gausstrc_table[CBRNG_GAUSSTRC_TABLESIZE];
+}
+
+/**
+ * @brief Batch truncated gaussian sampler (inverse CDF table)
+ */
+static void cbrng_gausstrc_batch(float *restrict v,
+                                 const uint32_t *restrict w,
+                                 uint64_t n)
+{
+    const float *restrict table = gausstrc_table;
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp simd
+#endif
+    for(uint64_t ii = 0; ii < n; ii++)
+    {
+        float   t = cbrng_u32_to_uniform(w[ii]) * CBRNG_GAUSSTRC_TABLESIZE;
+        int32_t k = (int32_t) t;
+        float   f = t - k;
+        v[ii]     = table[k] + f * (table[k + 1] - table[k]);
+    }
+}
+
+/**
+ * @brief Bitwise select, c ? a : b
+ *
+ * Float conditional expressions are not if-converted by the compiler
+ * unless finite math is assumed; this form vectorizes and keeps NaN
+ * operands out of the result.
+ */
+static inline float cbrng_selectf(int c, float a, float b)
+{
+    union
+    {
+        float    f;
+        uint32_t i;
+    } ua = {a}, ub = {b};
+    uint32_t m = -(uint32_t)(c != 0);
+
+    ua.i = (ua.i & m) | (ub.i & ~m);
+    return ua.f;
+}
+
+/**
+ * @brief Exponential, branch-free (Cephes expf polynomial)
+ *
+ * Argument is clamped to [-87, 88], relative error ~1e-7.
+ */
+static inline float cbrng_expf(float x)
+{
+    x = cbrng_selectf(x < -87.0f, -87.0f, x);
+    x = cbrng_selectf(x > 88.0f, 88.0f, x);
+
+    // x = n ln2 + r, |r| <= ln2/2
+    float t = x * 1.44269504088896341f + 0.5f;
+    float n = (float)(int32_t) t;
+    n -= (float)(n > t);
+    x -= n * 0.693359375f;
+    x -= n * -2.12194440E-4f;
+
+    float z = x * x;
+    float y = 1.9875691500E-4f;
+    y       = y * x + 1.3981999507E-3f;
+    y       = y * x + 8.3334519073E-3f;
+    y       = y * x + 4.1665795894E-2f;
+    y       = y * x + 1.6666665459E-1f;
+    y       = y * x + 5.0000001201E-1f;
+    y       = y * z + x + 1.0f;
+
+    union
+    {
+        float   f;
+        int32_t i;
+    } u;
+    u.i = ((int32_t) n + 127) << 23;
+
+    return y * u.f;
+}
+
+// uniform in (0,1], safe for log
+static inline float cbrng_u32_to_uniform_pos(uint32_t x)
+{
+    return ((x >> 8) + 1) * (1.0f / 16777216.0f);
+}
+
+// uniform in (0,1], double precision, scalar paths
+static inline double cbrng_u32_to_uniform_dpos(uint32_t x)
+{
+    return (x + 1.0) * (1.0 / 4294967296.0);
+}
+
+/**
+ * @brief Philox block for rejection retry
+ *
+ * Same counter as the first draw of pixel ii, attempt number folded into
+ * key word 0.
+ */
+static void cbrng_retry_block(uint64_t ii,
+                              uint32_t attempt,
+                              uint32_t k0,
+                              uint32_t k1,
+                              uint64_t frame,
+                              uint32_t out[4])
+{
+    uint32_t ctr[4];
+    uint32_t key[2];
+
+    ctr[0] = (uint32_t) ii;
+    ctr[1] = (uint32_t)(ii >> 32);
+    ctr[2] = (uint32_t) frame;
+    ctr[3] = (uint32_t)(frame >> 32);
+    key[0] = k0 ^ (attempt * PHILOX_W0);
+    key[1] = k1;
+    cbrng_philox4x32(ctr, key, out);
+}
+
+// log(k!) : direct sum for small k, Stirling series above
+static double cbrng_logfactorial(double k)
+{
+    if(k < 16.0)
+    {
+        double s = 0.0;
+        for(int i = 2; i <= (int) k; i++)
+        {
+            s += log((double) i);
+        }
+        return s;
+    }
+
+    double x = k + 1.0;
+    return (x - 0.5) * log(x) - x + 0.5 * log(2.0 * M_PI) +
+           1.0 / (12.0 * x) - 1.0 / (360.0 * x * x * x);
+}
+
+/**
+ * @brief PTRS acceptance test (Hormann 1993), double precision
+ *
+ * Returns 1 and sets *k if the pair (u, v) is accepted for mean lam.
+ */
+static int cbrng_ptrs_accept(double lam, double u, double v, double *k)
+{
+    double slam     = sqrt(lam);
+    double b        = 0.931 + 2.53 * slam;
+    double a        = -0.059 + 0.02483 * b;
+    double invalpha = 1.1239 + 1.1328 / (b - 3.4);
+    double vr       = 0.9277 - 3.6224 / (b - 2.0);
+
+    u -= 0.5;
+    double us = 0.5 - fabs(u);
+    if(us <= 0.0)
+    {
+        return 0;
+    }
+
+    double kk = floor((2.0 * a / us + b) * u + lam + 0.43);
+    if((us >= 0.07) && (v <= vr))
+    {
+        *k = kk;
+        return 1;
+    }
+    if((kk < 0.0) || ((us < 0.013) && (v > us)))
+    {
+        return 0;
+    }
+    if(log(v) + log(invalpha) - log(a / (us * us) + b) <=
+            -lam + kk * log(lam) - cbrng_logfactorial(kk))
+    {
+        *k = kk;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief PTRS test in single precision, vectorizable
+ *
+ * Returns 1 (accept, *k set), 0 (reject) or -1 when the pair must be
+ * decided by cbrng_ptrs_accept : within the rounding margin of the
+ * acceptance bound, k < 4, or us < 0.013 with v <= us. lam >= 10.
+ */
+static inline int cbrng_ptrs_test(float lam, float u, float v, float *k)
+{
+    float b  = 0.931f + 2.53f * sqrtf(lam);
+    float a  = -0.059f + 0.02483f * b;
+    float vr = 0.9277f - 3.6224f / (b - 2.0f);
+    float ia = 1.1239f + 1.1328f / (b - 3.4f);
+
+    u -= 0.5f;
+    float us = 0.5f - fabsf(u);
+    float uc = cbrng_selectf(us > 0.013f, us, 0.013f);
+
+    // mean added in double precision : k exact for large means
+    double y  = (double)((2.0f * a / uc + b) * u) + lam + 0.43;
+    float  kf = (float)(int32_t) y;
+    kf -= (float)((double) kf > y);
+
+    float vc  = cbrng_selectf(v > 1.0e-30f, v, 1.0e-30f);
+    float lhs = cbrng_logf(vc) + cbrng_logf(ia) -
+                cbrng_logf(a / (uc * uc) + b);
+    // log(k!) = lgamma(k+1), Stirling series
+    float x   = cbrng_selectf(kf > 4.0f, kf + 1.0f, 5.0f);
+    float lg  = (x - 0.5f) * cbrng_logf(x) - x + 0.91893853f +
+                1.0f / (12.0f * x) - 1.0f / (360.0f * x * x * x);
+    float kl  = kf * cbrng_logf(lam);
+    float rhs = -lam + kl - lg;
+    float eps = 4.0e-6f * (lam + fabsf(kl) + fabsf(lg)) + 1.0e-5f;
+
+    int full    = (us >= 0.013f) & (kf >= 4.0f);
+    int accept  = ((us >= 0.07f) & (v <= vr)) | (full & (lhs <= rhs - eps));
+    int reject  = (kf < 0.0f) | ((us < 0.013f) & (v > us)) |
+                  (full & (lhs > rhs + eps));
+
+    *k = kf;
+    return accept - (1 - accept) * (1 - reject);
+}
+
+/**
+ * @brief Batch Poisson sampler
+ *
+ * Pixels ii0 .. ii0+n-1, four random words per pixel in w. Means below
+ * CBRNG_POISSON_SMALL use branch-free inversion (word 0), with the search
+ * length set by the largest such mean in the batch. Larger means use the
+ * PTRS candidate from words 1 and 2. Rejected pixels are collected in a
+ * list and retried in vectorized rounds, each drawing one block per pixel
+ * with the attempt number folded into key word 0.
+ */
+static void cbrng_poisson_batch(float *restrict v,
+                                const float *restrict lam,
+                                const uint32_t *restrict w,
+                                uint64_t n,
+                                uint64_t ii0,
+                                uint32_t k0,
+                                uint32_t k1,
+                                uint64_t frame)
+{
+    float    p[CBRNG_CHUNK / 4];
+    float    F[CBRNG_CHUNK / 4];
+    float    u[CBRNG_CHUNK / 4];
+    float    ls[CBRNG_CHUNK / 4];
+    int8_t   st[CBRNG_CHUNK / 4];
+    uint32_t idx[CBRNG_CHUNK / 4];
+    uint32_t wr[CBRNG_CHUNK];
+    float    lmax = 0.0f;
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp simd reduction(max:lmax)
+#endif
+    for(uint64_t ii = 0; ii < n; ii++)
+    {
+        float l = cbrng_selectf(lam[ii] < CBRNG_POISSON_SMALL, lam[ii], 0.0f);
+        lmax    = cbrng_selectf(l > lmax, l, lmax);
+    }
+    // P(k >= kmax) < 1e-10, no iteration if all means are 0 or large
+    int kmax = 0;
+    if(lmax > 0.0f)
+    {
+        kmax = (int)(lmax + 7.0f * sqrtf(lmax) + 8.0f);
+    }
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp simd
+#endif
+    for(uint64_t ii = 0; ii < n; ii++)
+    {
+        float l     = lam[ii];
+        int   small = !(l >= CBRNG_POISSON_SMALL);
+
+        // inversion start, non-positive or NaN mean gives 0
+        float lsi = cbrng_selectf(l > 0.0f, l, 0.0f);
+        ls[ii]    = cbrng_selectf(small, lsi, CBRNG_POISSON_SMALL);
+        u[ii]     = cbrng_u32_to_uniform(w[4 * ii]);
+        p[ii]     = cbrng_expf(-ls[ii]);
+        F[ii]     = p[ii];
+
+        // PTRS first candidate
+        float lp = cbrng_selectf(small, CBRNG_POISSON_SMALL, l);
+        float kf;
+        int   t = cbrng_ptrs_test(lp,
+                                  cbrng_u32_to_uniform(w[4 * ii + 1]),
+                                  cbrng_u32_to_uniform(w[4 * ii + 2]),
+                                  &kf);
+
+        // small means : inversion count accumulated below
+        v[ii]  = cbrng_selectf(small, 0.0f, kf);
+        st[ii] = (int8_t)(t + small * (1 - t));
+    }
+
+    // inversion : count CDF values below u, k loop outermost
+    for(int k = 0; k < kmax; k++)
+    {
+        float invk = 1.0f / (float)(k + 1);
+
+#ifdef HAVE_LIBGOMP
+        #pragma omp simd
+#endif
+        for(uint64_t ii = 0; ii < n; ii++)
+        {
+            float small = (float)(ls[ii] < CBRNG_POISSON_SMALL);
+            v[ii] += small * (float)(u[ii] > F[ii]);
+            p[ii] *= ls[ii] * invk;
+            F[ii] += p[ii];
+        }
+    }
+
+    // rejected and undecided candidates
+    uint64_t nrem = 0;
+    for(uint64_t ii = 0; ii < n; ii++)
+    {
+        double k;
+        if(st[ii] == 1)
+        {
+            continue;
+        }
+        if((st[ii] == -1) &&
+                cbrng_ptrs_accept(lam[ii],
+                                  cbrng_u32_to_uniform(w[4 * ii + 1]),
+                                  cbrng_u32_to_uniform(w[4 * ii + 2]),
+                                  &k))
+        {
+            v[ii] = (float) k;
+            continue;
+        }
+        idx[nrem++] = (uint32_t) ii;
+    }
+
+    for(uint32_t attempt = 1; nrem > 0; attempt++)
+    {
+        float kr[CBRNG_CHUNK / 4];
+
+        cbrng_blocks_list(wr, ii0, idx, nrem, k0 ^ (attempt * PHILOX_W0), k1,
+                          frame);
+
+#ifdef HAVE_LIBGOMP
+        #pragma omp simd
+#endif
+        for(uint64_t j = 0; j < nrem; j++)
+        {
+            float ur = cbrng_u32_to_uniform(wr[4 * j]);
+            float vr = cbrng_u32_to_uniform(wr[4 * j + 1]);
+            st[j]    = (int8_t) cbrng_ptrs_test(lam[idx[j]], ur, vr, &kr[j]);
+        }
+
+        uint64_t nrem1 = 0;
+        for(uint64_t j = 0; j < nrem; j++)
+        {
+            double k;
+            if(st[j] == 1)
+            {
+                v[idx[j]] = kr[j];
+            }
+            else if((st[j] == -1) &&
+                    cbrng_ptrs_accept(lam[idx[j]],
+                                      cbrng_u32_to_uniform(wr[4 * j]),
+                                      cbrng_u32_to_uniform(wr[4 * j + 1]),
+                                      &k))
+            {
+                v[idx[j]] = (float) k;
+            }
+            else
+            {
+                idx[nrem1++] = idx[j];
+            }
+        }
+        nrem = nrem1;
+    }
+}
+
+/**
+ * @brief Batch gamma sampler (Marsaglia-Tsang 2000)
+ *
+ * Four random words per pixel : words 0,1 normal deviate, word 2
+ * acceptance uniform, word 3 shape boost for shape < 1. Non-positive
+ * shape gives 0. Rejected pixels are flagged in rej.
+ */
+static void cbrng_gamma_batch(float *restrict v,
+                              uint8_t *restrict rej,
+                              const float *restrict shape,
+                              float scale,
+                              const uint32_t *restrict w,
+                              uint64_t n)
+{
+#ifdef HAVE_LIBGOMP
+    #pragma omp simd
+#endif
+    for(uint64_t ii = 0; ii < n; ii++)
+    {
+        float s     = shape[ii];
+        int   valid = (s > 0.0f);
+        float s1    = cbrng_selectf(valid, s, 1.0f);
+        float a     = cbrng_selectf(s1 < 1.0f, s1 + 1.0f, s1);
+        float d     = a - 1.0f / 3.0f;
+        float c     = 1.0f / sqrtf(9.0f * d);
+
+        float z, z1;
+        cbrng_boxmuller(w[4 * ii], w[4 * ii + 1], &z, &z1);
+        float u  = cbrng_u32_to_uniform_pos(w[4 * ii + 2]);
+        float t  = 1.0f + c * z;
+        float v3 = t * t * t;
+        float vl = cbrng_selectf(v3 > 1.0e-30f, v3, 1.0e-30f);
+        float z2 = z * z;
+
+        int accept = (t > 0.0f) &
+                     ((u < 1.0f - 0.0331f * z2 * z2) |
+                      (cbrng_logf(u) <
+                       0.5f * z2 + d * (1.0f - v3 + cbrng_logf(vl))));
+
+        // u2^(1/s) underflows to 0 for very small shapes, where
+        // cbrng_expf would clamp to exp(-87)
+        float u2    = cbrng_u32_to_uniform_pos(w[4 * ii + 3]);
+        float lb    = cbrng_logf(u2) / s1;
+        float ub    = cbrng_selectf(lb < -87.0f, 0.0f, cbrng_expf(lb));
+        float boost = cbrng_selectf(s1 < 1.0f, ub, 1.0f);
+
+        v[ii]   = cbrng_selectf(valid, d * v3 * boost * scale, 0.0f);
+        rej[ii] = (uint8_t)(valid & !accept);
+    }
+}
+
+static float cbrng_gamma_retry(float    s,
+                               float    scale,
+                               uint64_t ii,
+                               uint32_t k0,
+                               uint32_t k1,
+                               uint64_t frame)
+{
+    double a = (s < 1.0f) ? s + 1.0 : s;
+    double d = a - 1.0 / 3.0;
+    double c = 1.0 / sqrt(9.0 * d);
+
+    for(uint32_t attempt = 1;; attempt++)
+    {
+        uint32_t out[4];
+
+        cbrng_retry_block(ii, attempt, k0, k1, frame, out);
+        double z = sqrt(-2.0 * log(cbrng_u32_to_uniform_dpos(out[0]))) *
+                   cos(2.0 * M_PI * cbrng_u32_to_uniform_dpos(out[1]));
+        double t = 1.0 + c * z;
+        if(t <= 0.0)
+        {
+            continue;
+        }
+        double v3 = t * t * t;
+        double u  = cbrng_u32_to_uniform_dpos(out[2]);
+        if((u < 1.0 - 0.0331 * z * z * z * z) ||
+                (log(u) < 0.5 * z * z + d * (1.0 - v3 + log(v3))))
+        {
+            double x = d * v3;
+            if(s < 1.0f)
+            {
+                x *= pow(cbrng_u32_to_uniform_dpos(out[3]), 1.0 / s);
+            }
+            return (float)(x * scale);
+        }
+    }
+}
+
+/**
+ * @brief Batch samplers with one random word per pixel
+ */
+static void cbrng_exp_batch(float *restrict v,
+                            const float *restrict mean,
+                            const uint32_t *restrict w,
+                            uint64_t n)
+{
+#ifdef HAVE_LIBGOMP
+    #pragma omp simd
+#endif
+    for(uint64_t ii = 0; ii < n; ii++)
+    {
+        v[ii] = -mean[ii] * cbrng_logf(cbrng_u32_to_uniform_pos(w[ii]));
+    }
+}
+
+static void cbrng_rayleigh_batch(float *restrict v,
+                                 const float *restrict sigma,
+                                 const uint32_t *restrict w,
+                                 uint64_t n)
+{
+#ifdef HAVE_LIBGOMP
+    #pragma omp simd
+#endif
+    for(uint64_t ii = 0; ii < n; ii++)
+    {
+        float lu = cbrng_logf(cbrng_u32_to_uniform_pos(w[ii]));
+        v[ii]    = sigma[ii] * sqrtf(-2.0f * lu);
+    }
+}
+
+// integers in [low, high], multiply-shift range reduction, at most
+// CBRNG_UNIFINT_MAXRANGE values (per-pixel low : range clamped)
+static void cbrng_unifint_batch(float *restrict v,
+                                const float *restrict low,
+                                float high,
+                                const uint32_t *restrict w,
+                                uint64_t n)
+{
+#ifdef HAVE_LIBGOMP
+    #pragma omp simd
+#endif
+    for(uint64_t ii = 0; ii < n; ii++)
+    {
+        float    lo    = floorf(low[ii]);
+        float    nval  = floorf(high) - lo + 1.0f;
+        float    nc    = cbrng_selectf(nval > 1.0f, nval, 1.0f);
+        uint32_t range = (uint32_t) cbrng_selectf(
+                             nc > CBRNG_UNIFINT_MAXRANGE,
+                             CBRNG_UNIFINT_MAXRANGE,
+                             nc);
+        v[ii] = lo + (float)(((uint64_t) w[ii] * range) >> 32);
+    }
+}
+
+/**
+ * @brief Compute n pixel values starting at pixel index ii0
+ *
+ * ii0 must be a multiple of 4, n <= CBRNG_CHUNK. p1 holds the per-pixel
+ * first parameter of distributions >= CBRNG_DISTRIB_POISSON.
+ */
+static void cbrng_chunk(float       *v,
+                        uint64_t     ii0,
+                        uint64_t     n,
+                        int          distrib,
+                        const float *p1,
+                        float        p2,
+                        uint32_t     k0,
+                        uint32_t     k1,
+                        uint64_t     frame)
+{
+    uint32_t buf[CBRNG_CHUNK];
+    uint8_t  rej[CBRNG_CHUNK / 4];
+    uint64_t nblk = (n + 3) / 4;
+
+    if((distrib == CBRNG_DISTRIB_POISSON) || (distrib == CBRNG_DISTRIB_GAMMA))
+    {
+        // one block per pixel
+        uint32_t k1p = k1 ^ CBRNG_KEY_PERPIXEL;
+
+        for(uint64_t jj = 0; jj < n; jj += CBRNG_CHUNK / 4)
+        {
+            uint64_t m = n - jj;
+            if(m > CBRNG_CHUNK / 4)
+            {
+                m = CBRNG_CHUNK / 4;
+            }
+            cbrng_blocks(buf, ii0 + jj, m, k0, k1p, frame);
+
+            if(distrib == CBRNG_DISTRIB_POISSON)
+            {
+                cbrng_poisson_batch(v + jj,
+                                    p1 + jj,
+                                    buf,
+                                    m,
+                                    ii0 + jj,
+                                    k0,
+                                    k1p,
+                                    frame);
+            }
+            else
+            {
+                cbrng_gamma_batch(v + jj, rej, p1 + jj, p2, buf, m);
+                for(uint64_t ii = 0; ii < m; ii++)
+                {
+                    if(rej[ii])
+                    {
+                        v[jj + ii] = cbrng_gamma_retry(p1[jj + ii],
+                                                       p2,
+                                                       ii0 + jj + ii,
+                                                       k0,
+                                                       k1p,
+                                                       frame);
+                    }
+                }
+            }
+        }
+        return;
+    }
+
+    cbrng_blocks(buf, ii0 / 4, nblk, k0, k1, frame);
+
+    switch(distrib)
+    {
+        case CBRNG_DISTRIB_GAUSS:
+            cbrng_gauss_batch(v, buf, n);
+            break;
+
+        case CBRNG_DISTRIB_GAUSSTRC:
+            cbrng_gausstrc_batch(v, buf, n);
+            break;
+
+        case CBRNG_DISTRIB_EXP:
+            cbrng_exp_batch(v, p1, buf, n);
+            break;
+
+        case CBRNG_DISTRIB_RAYLEIGH:
+            cbrng_rayleigh_batch(v, p1, buf, n);
+            break;
+
+        case CBRNG_DISTRIB_UNIFINT:
+            cbrng_unifint_batch(v, p1, p2, buf, n);
+            break;
+
+        default:
+#ifdef HAVE_LIBGOMP
+            #pragma omp simd
+#endif
+            for(uint64_t ii = 0; ii < n; ii++)
+            {
+                v[ii] = cbrng_u32_to_uniform(buf[ii]);
+            }
+            break;
+    }
+}
+
+/**
+ * @brief Per-pixel first parameter of chunk starting at ii0
+ *
+ * Points into p1map if provided, otherwise fills p1buf with the scalar.
+ */
+static const float *cbrng_chunk_p1(const CBRNG_PARAM *param,
+                                   int                distrib,
+                                   uint64_t           ii0,
+                                   uint64_t           n,
+                                   float             *p1buf)
+{
+    if(distrib < CBRNG_DISTRIB_POISSON)
+    {
+        return NULL;
+    }
+    if(param->p1map != NULL)
+    {
+        return param->p1map + ii0;
+    }
+    for(uint64_t ii = 0; ii < n; ii++)
+    {
+        p1buf[ii] = (float) param->p1;
+    }
+    return p1buf;
+}
+
+// used when no parameters are given
+static const CBRNG_PARAM cbrng_param_default = {1.0, 1.0, NULL};
+
+/**
+ * @brief floor(x + 0.5), branch-free
+ *
+ * Floats of magnitude >= 2^23 are integers and returned unchanged: the
+ * int32_t cast would overflow beyond 2^31, and x + 0.5 would round to
+ * even above 2^23.
+ */
+static inline float cbrng_roundf(float x)
+{
+    int   big = (fabsf(x) >= 8388608.0f);
+    float y   = cbrng_selectf(big, 0.0f, x) + 0.5f;
+    float t   = (float)(int32_t) y;
+
+    return cbrng_selectf(big, x, t - (float)(t > y));
+}
+
+/**
+ * @brief float to IEEE half, round to nearest even, branch-free
+ *
+ * The float addition performs the mantissa rounding (same method as the
+ * FP16 library by M. Dukhan). Overflow gives infinity, NaN is preserved.
+ */
+static inline uint16_t cbrng_float_to_half(float f)
+{
+    union
+    {
+        float    f;
+        uint32_t i;
+    } u = {f}, b;
+
+    uint32_t w2   = u.i + u.i;
+    uint32_t sign = u.i & 0x80000000U;
+    uint32_t bias = w2 & 0xff000000U;
+    bias          = (bias < 0x71000000U) ? 0x71000000U : bias;
+
+    // 2^112 then 2^-110 : overflow to infinity, exact otherwise
+    u.i &= 0x7fffffffU;
+    float base = (u.f * 5.192296858534828e+33f) * 7.703719777548943e-34f;
+    b.i        = (bias >> 1) + 0x07800000U;
+    b.f += base;
+
+    uint32_t nonsign = ((b.i >> 13) & 0x00007c00U) + (b.i & 0x00000fffU);
+
+    return (uint16_t)((sign >> 16) | ((w2 > 0xff000000U) ? 0x7e00U :
+                                      nonsign));
+}
+
+/**
+ * @brief Integer store kernels : scale, offset, saturation and rounding
+ *
+ * NaN is stored as the lower bound.
+ */
+#define CBRNG_STORE_INT(NAME, TYPE, ITYPE, VMIN, VMAX)                     \
+    static void NAME(TYPE *restrict out,                                   \
+                     const float *restrict v,                              \
+                     uint64_t n,                                           \
+                     float scale,                                          \
+                     float offset)                                         \
+    {                                                                      \
+        CBRNG_PRAGMA_SIMD                                                  \
+        for(uint64_t ii = 0; ii < n; ii++)                                 \
+        {                                                                  \
+            float x = v[ii] * scale + offset;                              \
+            x       = cbrng_selectf(!(x >= (VMIN)), (VMIN), x);            \
+            x       = cbrng_selectf(x > (VMAX), (VMAX), x);                \
+            out[ii] = (TYPE)(ITYPE) cbrng_roundf(x);                       \
+        }                                                                  \
+    }
+
+CBRNG_STORE_INT(cbrng_store_ui8, uint8_t, int32_t, 0.0f, 255.0f)
+CBRNG_STORE_INT(cbrng_store_si8, int8_t, int32_t, -128.0f, 127.0f)
+CBRNG_STORE_INT(cbrng_store_ui16, uint16_t, int32_t, 0.0f, 65535.0f)
+CBRNG_STORE_INT(cbrng_store_si16, int16_t, int32_t, -32768.0f, 32767.0f)
+// largest floats below 2^31 and 2^32
+CBRNG_STORE_INT(cbrng_store_si32,
+                int32_t,
+                int32_t,
+                -2147483648.0f,
+                2147483520.0f)
+CBRNG_STORE_INT(cbrng_store_ui32, uint32_t, int64_t, 0.0f, 4294967040.0f)
+
+static void cbrng_store_half(uint16_t *restrict out,
+                             const float *restrict v,
+                             uint64_t n,
+                             float scale,
+                             float offset)
+{
+    CBRNG_PRAGMA_SIMD
+    for(uint64_t ii = 0; ii < n; ii++)
+    {
+        // saturate to largest finite half
+        float x = v[ii] * scale + offset;
+        x       = cbrng_selectf(x < -65504.0f, -65504.0f, x);
+        x       = cbrng_selectf(x > 65504.0f, 65504.0f, x);
+        out[ii] = cbrng_float_to_half(x);
+    }
+}
+
+size_t cbrng_datatype_size(uint8_t datatype)
+{
+    switch(datatype)
+    {
+        case _DATATYPE_UINT8:
+        case _DATATYPE_INT8:
+            return 1;
+
+        case _DATATYPE_UINT16:
+        case _DATATYPE_INT16:
+        case _DATATYPE_HALF:
+            return 2;
+
+        case _DATATYPE_UINT32:
+        case _DATATYPE_INT32:
+        case _DATATYPE_FLOAT:
+            return 4;
+
+        case _DATATYPE_DOUBLE:
+            return 8;
+
+        default:
+            return 0;
+    }
+}
+
+void cbrng_store_typed(void        *array,
+                       uint8_t      datatype,
+                       uint64_t     ii0,
+                       const float *v,
+                       uint64_t     n,
+                       double       scale,
+                       double       offset)
+{
+    float fscale  = (float) scale;
+    float foffset = (float) offset;
+
+    switch(datatype)
+    {
+        case _DATATYPE_UINT8:
+            cbrng_store_ui8((uint8_t *) array + ii0, v, n, fscale, foffset);
+            break;
+
+        case _DATATYPE_INT8:
+            cbrng_store_si8((int8_t *) array + ii0, v, n, fscale, foffset);
+            break;
+
+        case _DATATYPE_UINT16:
+            cbrng_store_ui16((uint16_t *) array + ii0, v, n, fscale, foffset);
+            break;
+
+        case _DATATYPE_INT16:
+            cbrng_store_si16((int16_t *) array + ii0, v, n, fscale, foffset);
+            break;
+
+        case _DATATYPE_UINT32:
+            cbrng_store_ui32((uint32_t *) array + ii0, v, n, fscale, foffset);
+            break;
+
+        case _DATATYPE_INT32:
+            cbrng_store_si32((int32_t *) array + ii0, v, n, fscale, foffset);
+            break;
+
+        case _DATATYPE_HALF:
+            cbrng_store_half((uint16_t *) array + ii0, v, n, fscale, foffset);
+            break;
+
+        case _DATATYPE_FLOAT:
+        {
+            float *out = (float *) array + ii0;
+            CBRNG_PRAGMA_SIMD
+            for(uint64_t ii = 0; ii < n; ii++)
+            {
+                out[ii] = v[ii] * fscale + foffset;
+            }
+        }
+        break;
+
+        case _DATATYPE_DOUBLE:
+        {
+            double *out = (double *) array + ii0;
+            CBRNG_PRAGMA_SIMD
+            for(uint64_t ii = 0; ii < n; ii++)
+            {
+                out[ii] = v[ii] * scale + offset;
+            }
+        }
+        break;
+    }
+}
+
+/**
+ * @brief Fill array of any supported datatype
+ *
+ * Values are computed by chunk into a float buffer that stays in cache,
+ * then stored as value * scale + offset, saturated and rounded for
+ * integer types. Float output with unit scale and zero offset is written
+ * in place.
+ */
+errno_t cbrng_fill_typed(void              *array,
+                         uint8_t            datatype,
+                         uint64_t           nelement,
+                         int                distrib,
+                         const CBRNG_PARAM *param,
+                         double             scale,
+                         double             offset,
+                         uint64_t           seed,
+                         uint64_t           frame)
+{
+    uint32_t k0     = (uint32_t) seed;
+    uint32_t k1     = (uint32_t)(seed >> 32);
+    uint64_t nchunk = (nelement + CBRNG_CHUNK - 1) / CBRNG_CHUNK;
+    int      direct = (datatype == _DATATYPE_FLOAT) && (scale == 1.0) &&
+                      (offset == 0.0);
+
+    if(cbrng_datatype_size(datatype) == 0)
+    {
+        PRINT_ERROR("unsupported datatype %d", (int) datatype);
+        return RETURN_FAILURE;
+    }
+    if(param == NULL)
+    {
+        param = &cbrng_param_default;
+    }
+    if((distrib == CBRNG_DISTRIB_UNIFINT) && (param->p1map == NULL) &&
+            ((fabs(param->p1) > CBRNG_UNIFINT_MAXRANGE) ||
+             (fabs(param->p2) > CBRNG_UNIFINT_MAXRANGE) ||
+             (floor(param->p2) - floor(param->p1) + 1.0 >
+              CBRNG_UNIFINT_MAXRANGE)))
+    {
+        PRINT_ERROR("integer range [%g, %g] exceeds 2^24 values or bounds",
+                    param->p1,
+                    param->p2);
+        return RETURN_FAILURE;
+    }
+    pthread_once(&gausstrc_table_once, cbrng_gausstrc_table_init);
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for schedule(static) if(nchunk > 1)
+#endif
+    for(uint64_t chunk = 0; chunk < nchunk; chunk++)
+    {
+        float    v[CBRNG_CHUNK];
+        float    p1buf[CBRNG_CHUNK];
+        uint64_t ii0 = chunk * CBRNG_CHUNK;
+        uint64_t n   = nelement - ii0;
+        if(n > CBRNG_CHUNK)
+        {
+            n = CBRNG_CHUNK;
+        }
+        cbrng_chunk(direct ? (float *) array + ii0 : v,
+                    ii0,
+                    n,
+                    distrib,
+                    cbrng_chunk_p1(param, distrib, ii0, n, p1buf),
+                    (float) param->p2,
+                    k0,
+                    k1,
+                    frame);
+        if(direct == 0)
+        {
+            cbrng_store_typed(array, datatype, ii0, v, n, scale, offset);
+        }
+    }
+
+    return RETURN_SUCCESS;
+}
+
+errno_t cbrng_fill_float_param(float             *array,
+                               uint64_t           nelement,
+                               int                distrib,
+                               const CBRNG_PARAM *param,
+                               uint64_t           seed,
+                               uint64_t           frame)
+{
+    return cbrng_fill_typed(array,
+                            _DATATYPE_FLOAT,
+                            nelement,
+                            distrib,
+                            param,
+                            1.0,
+                            0.0,
+                            seed,
+                            frame);
+}
+
+errno_t cbrng_fill_double_param(double            *array,
+                                uint64_t           nelement,
+                                int                distrib,
+                                const CBRNG_PARAM *param,
+                                uint64_t           seed,
+                                uint64_t           frame)
+{
+    return cbrng_fill_typed(array,
+                            _DATATYPE_DOUBLE,
+                            nelement,
+                            distrib,
+                            param,
+                            1.0,
+                            0.0,
+                            seed,
+                            frame);
+}
+
+errno_t cbrng_fill_float(float   *array,
+                         uint64_t nelement,
+                         int      distrib,
+                         uint64_t seed,
+                         uint64_t frame)
+{
+    return cbrng_fill_float_param(array, nelement, distrib, NULL, seed, frame);
+}
+
+errno_t cbrng_fill_double(double  *array,
+                          uint64_t nelement,
+                          int      distrib,
+                          uint64_t seed,
+                          uint64_t frame)
+{
+    return cbrng_fill_double_param(array,
+                                   nelement,
+                                   distrib,
+                                   NULL,
+                                   seed,
+                                   frame);
+}
+
+/**
+ * @brief Draw a seed from the global ran1() generator
+ *
+ * Lets callers without an explicit seed use the batch samplers while
+ * remaining driven by the CLI random state. Seeds are drawn on 63 bits
+ * (<= CBRNG_SEED_MAX), so that the signed RNDSEED keyword holds them
+ * exactly.
+ */
+uint64_t cbrng_seed_ran1()
+{
+    uint64_t s0 = (uint64_t)(ran1() * 4294967296.0);
+    uint64_t s1 = (uint64_t)(ran1() * 4294967296.0);
+
+    return ((s1 << 32) | (s0 & 0xffffffff)) & CBRNG_SEED_MAX;
+}
+
+// error of one kernel sample from random words w[0..3]
+static double cbrng_kernel_sample_error(int kernel, const uint32_t *w)
+{
+    switch(kernel)
+    {
+        case CBRNG_KERNEL_LOGF:
+        {
+            float u = cbrng_u32_to_uniform_pos(w[0]);
+            return fabs(cbrng_logf(u) - log((double) u));
+        }
+
+        case CBRNG_KERNEL_EXPF:
+        {
+            float  x  = -87.0f + 175.0f * cbrng_u32_to_uniform(w[0]);
+            double ex = exp((double) x);
+            return fabs(cbrng_expf(x) - ex) / ex;
+        }
+
+        case CBRNG_KERNEL_SINCOS:
+        {
+            float t = cbrng_u32_to_uniform(w[0]);
+            float c, s;
+            cbrng_sincos2pi(t, &c, &s);
+            return fmax(fabs(c - cos(2.0 * M_PI * t)),
+                        fabs(s - sin(2.0 * M_PI * t)));
+        }
+
+        case CBRNG_KERNEL_GAUSS:
+        {
+            float z0, z1;
+            cbrng_boxmuller(w[0], w[1], &z0, &z1);
+            double u1 = cbrng_u32_to_uniform_tail(w[0]);
+            double u2 = (w[1] >> 8) * (1.0 / 16777216.0);
+            double r  = sqrt(-2.0 * log(u1));
+            return fmax(fabs(z0 - r * cos(2.0 * M_PI * u2)),
+                        fabs(z1 - r * sin(2.0 * M_PI * u2)));
+        }
+
+        default:
+        {
+            float v;
+            cbrng_gausstrc_batch(&v, w, 1);
+
+            // inverse CDF by Newton iterations from the table value
+            double u  = cbrng_u32_to_uniform(w[0]);
+            double p0 = 0.5 * erfc(CBRNG_GAUSSTRC_LIMIT / M_SQRT2);
+            double p  = p0 + (1.0 - 2.0 * p0) * u;
+            double z  = v;
+            for(int iter = 0; iter < 4; iter++)
+            {
+                double dp  = 0.5 * erfc(-z / M_SQRT2) - p;
+                double pdf = exp(-0.5 * z * z) / sqrt(2.0 * M_PI);
+                z -= dp / pdf;
+            }
+            return fabs(v - z);
+        }
+    }
+}
+
+errno_t cbrng_kernel_error(int       kernel,
+                           uint64_t  nsample,
+                           double   *errmax,
+                           double   *errrms)
+{
+    double emax = 0.0;
+    double esum = 0.0;
+
+    if((kernel < CBRNG_KERNEL_LOGF) || (kernel > CBRNG_KERNEL_GAUSSTRC))
+    {
+        PRINT_ERROR("unknown kernel %d", kernel);
+        return RETURN_FAILURE;
+    }
+    pthread_once(&gausstrc_table_once, cbrng_gausstrc_table_init);
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for reduction(max : emax) reduction(+ : esum)
+#endif
+    for(uint64_t k = 0; k < nsample; k++)
+    {
+        uint32_t ctr[4] = {(uint32_t) k, (uint32_t)(k >> 32), 0, 0};
+        uint32_t key[2] = {0x5eed, (uint32_t) kernel};
+        uint32_t w[4];
+
+        cbrng_philox4x32(ctr, key, w);
+        double e = cbrng_kernel_sample_error(kernel, w);
+        emax     = fmax(emax, e);
+        esum += e * e;
+    }
+
+    *errmax = emax;
+    *errrms = (nsample > 0) ? sqrt(esum / nsample) : 0.0;
+
+    return RETURN_SUCCESS;
+}
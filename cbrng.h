@@ -0,0 +1,132 @@
+#ifndef IMAGE_GEN_CBRNG_H
+#define IMAGE_GEN_CBRNG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @file cbrng.h
+ * @brief Counter-based random number generator (Philox4x32-10)
+ *
+ * Each pixel value is a pure function of (seed, frame, pixel index), so
+ * images can be filled by any number of threads and remain bit-identical
+ * for a given seed.
+ */
+
+// distributions supported by the counter-based fill functions
+#define CBRNG_DISTRIB_UNIFORM  0
+#define CBRNG_DISTRIB_GAUSS    1
+#define CBRNG_DISTRIB_GAUSSTRC 2
+// 3 is reserved (test pattern in mkrnd)
+#define CBRNG_DISTRIB_POISSON  4 // p1: mean
+#define CBRNG_DISTRIB_EXP      5 // p1: mean
+#define CBRNG_DISTRIB_GAMMA    6 // p1: shape, p2: scale (EMCCD: n_e-, gain)
+                                 // values below FLT_MIN are flushed to 0
+#define CBRNG_DISTRIB_RAYLEIGH 7 // p1: sigma
+#define CBRNG_DISTRIB_UNIFINT  8 // integers in [p1, p2]
+
+// float output : integers exact up to 2^24, bounds and count of values
+// of CBRNG_DISTRIB_UNIFINT are limited to it
+#define CBRNG_UNIFINT_MAXRANGE 16777216.0f
+
+// truncation limit of the truncated gaussian distribution
+#define CBRNG_GAUSSTRC_LIMIT 1.0
+
+/** @brief Distribution parameters
+ *
+ * If p1map is not NULL, it holds one p1 value per pixel (for example a
+ * Poisson mean image) and overrides p1.
+ */
+typedef struct
+{
+    double       p1;
+    double       p2;
+    const float *p1map;
+} CBRNG_PARAM;
+
+/** @brief Philox4x32-10 block function
+ *
+ * Maps a 128-bit counter and 64-bit key to four 32-bit random words.
+ */
+void cbrng_philox4x32(const uint32_t ctr[4],
+                      const uint32_t key[2],
+                      uint32_t       out[4]);
+
+errno_t cbrng_fill_float(float   *array,
+                         uint64_t nelement,
+                         int      distrib,
+                         uint64_t seed,
+                         uint64_t frame);
+
+errno_t cbrng_fill_double(double  *array,
+                          uint64_t nelement,
+                          int      distrib,
+                          uint64_t seed,
+                          uint64_t frame);
+
+errno_t cbrng_fill_float_param(float             *array,
+                               uint64_t           nelement,
+                               int                distrib,
+                               const CBRNG_PARAM *param,
+                               uint64_t           seed,
+                               uint64_t           frame);
+
+errno_t cbrng_fill_double_param(double            *array,
+                                uint64_t           nelement,
+                                int                distrib,
+                                const CBRNG_PARAM *param,
+                                uint64_t           seed,
+                                uint64_t           frame);
+
+/** @brief Fill array of native datatype (_DATATYPE_*)
+ *
+ * Stores value * scale + offset. Integer types are rounded to nearest
+ * and saturated, half precision is saturated to +/-65504.
+ */
+errno_t cbrng_fill_typed(void              *array,
+                         uint8_t            datatype,
+                         uint64_t           nelement,
+                         int                distrib,
+                         const CBRNG_PARAM *param,
+                         double             scale,
+                         double             offset,
+                         uint64_t           seed,
+                         uint64_t           frame);
+
+/** @brief Store n float values at element ii0 of array (same conversion
+ * as cbrng_fill_typed)
+ */
+void cbrng_store_typed(void        *array,
+                       uint8_t      datatype,
+                       uint64_t     ii0,
+                       const float *v,
+                       uint64_t     n,
+                       double       scale,
+                       double       offset);
+
+// single precision kernels of the batch samplers
+#define CBRNG_KERNEL_LOGF     0 // log(u), u in (0,1]
+#define CBRNG_KERNEL_EXPF     1 // exp(x), x in [-87,88], relative error
+#define CBRNG_KERNEL_SINCOS   2 // cos, sin(2 pi t), t in [0,1)
+#define CBRNG_KERNEL_GAUSS    3 // Box-Muller deviate pair
+#define CBRNG_KERNEL_GAUSSTRC 4 // truncated gaussian inverse CDF table
+
+/** @brief Error of a sampler kernel against double precision libm
+ *
+ * Inputs are derived from nsample Philox blocks as in the samplers, so
+ * the error excludes input quantization. Errors are absolute except for
+ * CBRNG_KERNEL_EXPF.
+ */
+errno_t cbrng_kernel_error(int       kernel,
+                           uint64_t  nsample,
+                           double   *errmax,
+                           double   *errrms);
+
+// element size [byte], 0 if datatype is not supported by cbrng_fill_typed
+size_t cbrng_datatype_size(uint8_t datatype);
+
+// largest seed recorded exactly by the signed RNDSEED keyword
+#define CBRNG_SEED_MAX 0x7fffffffffffffffULL
+
+uint64_t cbrng_seed_ran1();
+
+#endif
@@ -0,0 +1,307 @@
+/**
+ * @file    diskbatch.c
+ * @brief   Batch rendering of many sub-pixel disks into one image
+ *
+ * Disks are binned by DISKBATCH_TILE x DISKBATCH_TILE tile of the output
+ * (counting pass, then fill of a compressed index list). Tiles are then
+ * processed in parallel: tiles are disjoint, so disks overlapping
+ * several tiles are clipped to each and no write is shared between
+ * threads. Edge pixels take the exact disk area from pixcoverage_disk.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CommandLineInterface/CLIcore.h"
+
+#include "diskbatch.h"
+#include "pixcoverage.h"
+
+#define DISKBATCH_TILE 32
+
+// pixel range touched by disk, inclusive, unclamped
+static void disk_batch_bbox(double x,
+                            double y,
+                            double r,
+                            long  *i0,
+                            long  *i1,
+                            long  *j0,
+                            long  *j1)
+{
+    *i0 = (long) ceil(x - r - 0.5);
+    *i1 = (long) floor(x + r + 0.5);
+    *j0 = (long) ceil(y - r - 0.5);
+    *j1 = (long) floor(y + r + 0.5);
+}
+
+// tile range of disk, inclusive, returns 0 if outside image or empty
+static int disk_batch_tiles(double   x,
+                            double   y,
+                            double   r,
+                            uint32_t xsize,
+                            uint32_t ysize,
+                            long    *tx0,
+                            long    *tx1,
+                            long    *ty0,
+                            long    *ty1)
+{
+    long i0, i1, j0, j1;
+
+    if(!(r > 0.0))
+    {
+        return 0;
+    }
+    disk_batch_bbox(x, y, r, &i0, &i1, &j0, &j1);
+    if((i1 < 0) || (j1 < 0) || (i0 >= (long) xsize) || (j0 >= (long) ysize))
+    {
+        return 0;
+    }
+
+    *tx0 = (i0 < 0) ? 0 : i0 / DISKBATCH_TILE;
+    *ty0 = (j0 < 0) ? 0 : j0 / DISKBATCH_TILE;
+    *tx1 = ((i1 >= (long) xsize) ? (long) xsize - 1 : i1) / DISKBATCH_TILE;
+    *ty1 = ((j1 >= (long) ysize) ? (long) ysize - 1 : j1) / DISKBATCH_TILE;
+
+    return 1;
+}
+
+void disk_batch_raster(float        *array,
+                       uint32_t      xsize,
+                       uint32_t      ysize,
+                       long          ndisk,
+                       const double *x,
+                       const double *y,
+                       const double *r,
+                       const double *amp)
+{
+    long ntx   = (xsize + DISKBATCH_TILE - 1) / DISKBATCH_TILE;
+    long nty   = (ysize + DISKBATCH_TILE - 1) / DISKBATCH_TILE;
+    long ntile = ntx * nty;
+
+    // tstart[t] .. tstart[t+1]-1 : entries of tile t in tdisk
+    long *tstart = (long *) calloc(ntile + 1, sizeof(long));
+    if(tstart == NULL)
+    {
+        PRINT_ERROR("calloc returns NULL pointer");
+        abort();
+    }
+
+    for(long k = 0; k < ndisk; k++)
+    {
+        long tx0, tx1, ty0, ty1;
+        if(disk_batch_tiles(x[k],
+                            y[k],
+                            r[k],
+                            xsize,
+                            ysize,
+                            &tx0,
+                            &tx1,
+                            &ty0,
+                            &ty1))
+        {
+            for(long ty = ty0; ty <= ty1; ty++)
+                for(long tx = tx0; tx <= tx1; tx++)
+                {
+                    tstart[ty * ntx + tx + 1]++;
+                }
+        }
+    }
+    for(long t = 0; t < ntile; t++)
+    {
+        tstart[t + 1] += tstart[t];
+    }
+
+    long *tdisk = (long *) malloc(sizeof(long) * (tstart[ntile] + 1));
+    long *tfill = (long *) malloc(sizeof(long) * ntile);
+    if((tdisk == NULL) || (tfill == NULL))
+    {
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
+    }
+    memcpy(tfill, tstart, sizeof(long) * ntile);
+
+    for(long k = 0; k < ndisk; k++)
+    {
+        long tx0, tx1, ty0, ty1;
+        if(disk_batch_tiles(x[k],
+                            y[k],
+                            r[k],
+                            xsize,
+                            ysize,
+                            &tx0,
+                            &tx1,
+                            &ty0,
+                            &ty1))
+        {
+            for(long ty = ty0; ty <= ty1; ty++)
+                for(long tx = tx0; tx <= tx1; tx++)
+                {
+                    tdisk[tfill[ty * ntx + tx]++] = k;
+                }
+        }
+    }
+    free(tfill);
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for(long t = 0; t < ntile; t++)
+    {
+        long ti0 = (t % ntx) * DISKBATCH_TILE;
+        long tj0 = (t / ntx) * DISKBATCH_TILE;
+        long ti1 = ti0 + DISKBATCH_TILE - 1;
+        long tj1 = tj0 + DISKBATCH_TILE - 1;
+
+        if(ti1 >= (long) xsize)
+        {
+            ti1 = xsize - 1;
+        }
+        if(tj1 >= (long) ysize)
+        {
+            tj1 = ysize - 1;
+        }
+
+        for(long m = tstart[t]; m < tstart[t + 1]; m++)
+        {
+            long   k = tdisk[m];
+            double a = (amp == NULL) ? 1.0 : amp[k];
+            long   i0, i1, j0, j1;
+
+            disk_batch_bbox(x[k], y[k], r[k], &i0, &i1, &j0, &j1);
+            i0 = (i0 < ti0) ? ti0 : i0;
+            i1 = (i1 > ti1) ? ti1 : i1;
+            j0 = (j0 < tj0) ? tj0 : j0;
+            j1 = (j1 > tj1) ? tj1 : j1;
+
+            for(long jj = j0; jj <= j1; jj++)
+            {
+                float *row = array + (uint64_t) jj * xsize;
+                double dy  = jj - y[k];
+                for(long ii = i0; ii <= i1; ii++)
+                {
+                    row[ii] += (float)(a * pixcoverage_disk(ii - x[k],
+                                                            dy,
+                                                            r[k]));
+                }
+            }
+        }
+    }
+
+    free(tdisk);
+    free(tstart);
+}
+
+imageID make_disks(const char   *ID_name,
+                   uint32_t      l1,
+                   uint32_t      l2,
+                   long          ndisk,
+                   const double *x,
+                   const double *y,
+                   const double *r,
+                   const double *amp)
+{
+    imageID ID;
+
+    create_2Dimage_ID(ID_name, l1, l2, &ID);
+    disk_batch_raster(data.image[ID].array.F,
+                      data.image[ID].md[0].size[0],
+                      data.image[ID].md[0].size[1],
+                      ndisk,
+                      x,
+                      y,
+                      r,
+                      amp);
+
+    return (ID);
+}
+
+imageID make_disks_file(const char *ID_name,
+                        uint32_t    l1,
+                        uint32_t    l2,
+                        const char *fname)
+{
+    imageID ID;
+    FILE   *fp;
+    char    line[512];
+    long    ndisk  = 0;
+    long    nalloc = 0;
+    double *buff   = NULL; // x, y, r, amp per disk
+    long    lineno = 0;
+
+    fp = fopen(fname, "r");
+    if(fp == NULL)
+    {
+        PRINT_ERROR("cannot open file \"%s\"", fname);
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), fp) != NULL)
+    {
+        double v[4];
+        int    nv;
+
+        lineno++;
+        nv = sscanf(line, "%lf %lf %lf %lf", &v[0], &v[1], &v[2], &v[3]);
+        if(nv <= 0)
+        {
+            // blank line, comment or EOF
+            continue;
+        }
+        if(nv < 3)
+        {
+            PRINT_ERROR("%s line %ld: expected x y r [amplitude]",
+                        fname,
+                        lineno);
+            fclose(fp);
+            free(buff);
+            return -1;
+        }
+        if(nv == 3)
+        {
+            v[3] = 1.0;
+        }
+
+        if(ndisk == nalloc)
+        {
+            nalloc     = (nalloc == 0) ? 1024 : 2 * nalloc;
+            double *nb = (double *) realloc(buff, sizeof(double) * 4 * nalloc);
+            if(nb == NULL)
+            {
+                PRINT_ERROR("realloc returns NULL pointer");
+                abort();
+            }
+            buff = nb;
+        }
+        memcpy(buff + 4 * ndisk, v, sizeof(double) * 4);
+        ndisk++;
+    }
+    fclose(fp);
+
+    // split into coordinate arrays
+    double *x = (double *) malloc(sizeof(double) * 4 * (ndisk + 1));
+    if(x == NULL)
+    {
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
+    }
+    double *y   = x + ndisk;
+    double *r   = y + ndisk;
+    double *amp = r + ndisk;
+    for(long k = 0; k < ndisk; k++)
+    {
+        x[k]   = buff[4 * k];
+        y[k]   = buff[4 * k + 1];
+        r[k]   = buff[4 * k + 2];
+        amp[k] = buff[4 * k + 3];
+    }
+    free(buff);
+
+    printf("%ld disks read from %s\n", ndisk, fname);
+    ID = make_disks(ID_name, l1, l2, ndisk, x, y, r, amp);
+
+    free(x);
+
+    return (ID);
+}
@@ -0,0 +1,45 @@
+#ifndef IMAGE_GEN_DISKBATCH_H
+#define IMAGE_GEN_DISKBATCH_H
+
+#include <stdint.h>
+
+/** @file diskbatch.h
+ * @brief Batch rendering of many sub-pixel disks into one image
+ */
+
+/** @brief Add disks to float array (xsize x ysize)
+ *
+ * Pixel value += amp * (disk area inside pixel). Disks are binned by
+ * tile, and tiles are rasterized in parallel, each pixel being visited
+ * only by the disks that overlap it. amp may be NULL (amplitude 1).
+ */
+void disk_batch_raster(float        *array,
+                       uint32_t      xsize,
+                       uint32_t      ysize,
+                       long          ndisk,
+                       const double *x,
+                       const double *y,
+                       const double *r,
+                       const double *amp);
+
+/** @brief Create image with batch of disks */
+imageID make_disks(const char   *ID_name,
+                   uint32_t      l1,
+                   uint32_t      l2,
+                   long          ndisk,
+                   const double *x,
+                   const double *y,
+                   const double *r,
+                   const double *amp);
+
+/** @brief Create image with disks read from ASCII file
+ *
+ * One disk per line: x y r [amplitude], amplitude defaults to 1.
+ * Blank lines and lines starting with # are ignored.
+ */
+imageID make_disks_file(const char *ID_name,
+                        uint32_t    l1,
+                        uint32_t    l2,
+                        const char *fname);
+
+#endif
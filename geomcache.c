@@ -0,0 +1,132 @@
+/**
+ * @file    geomcache.c
+ * @brief   File cache of derived pupil geometry
+ *
+ * Geometry derived from a few parameters (segment centers, label maps)
+ * is written once to a file named after a hash of the parameters, in
+ * the milk shared memory directory, and mapped read-only by later
+ * calls. Callers store the parameters in the file and check them after
+ * mapping, the hash only selecting the file.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CommandLineInterface/CLIcore.h"
+
+#include "geomcache.h"
+
+uint64_t geomcache_fnv1a(uint64_t h, const void *buf, size_t len)
+{
+    const unsigned char *p = (const unsigned char *) buf;
+
+    for(size_t i = 0; i < len; i++)
+    {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+void geomcache_path(char *path, size_t len, const char *prefix, uint64_t key)
+{
+    const char *dir = getenv("MILK_SHM_DIR");
+
+    if((dir == NULL) || (dir[0] == '\0'))
+    {
+        dir = "/tmp";
+    }
+    // per user : a file of another user is neither read nor replaced
+    snprintf(path,
+             len,
+             "%s/%s_%lu_%016llx.geomcache",
+             dir,
+             prefix,
+             (unsigned long) geteuid(),
+             (unsigned long long) key);
+}
+
+void *geomcache_map(const char *path, size_t *mapsize)
+{
+    int         fd;
+    struct stat st;
+    void       *map;
+
+    // regular files only : no symbolic link planted in a shared /tmp
+    fd = open(path, O_RDONLY | O_NOFOLLOW);
+    if(fd == -1)
+    {
+        return NULL;
+    }
+    // written by us (mkstemp, mode 0600), not by another user
+    if((fstat(fd, &st) == -1) || !S_ISREG(st.st_mode) || (st.st_size == 0) ||
+            (st.st_uid != geteuid()) || (st.st_mode & (S_IWGRP | S_IWOTH)))
+    {
+        close(fd);
+        return NULL;
+    }
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+    {
+        return NULL;
+    }
+    *mapsize = st.st_size;
+    return map;
+}
+
+void geomcache_unmap(void *map, size_t mapsize)
+{
+    munmap(map, mapsize);
+}
+
+errno_t geomcache_write(const char        *path,
+                        int                nblk,
+                        const void *const *blk,
+                        const size_t      *blksize)
+{
+    char  tmppath[STRINGMAXLEN_FULLFILENAME];
+    FILE *fp;
+    int   fd;
+    int   ok = 1;
+
+    // unique name next to path, created exclusively (mode 0600)
+    if(snprintf(tmppath, sizeof(tmppath), "%s.XXXXXX", path) >=
+            (int) sizeof(tmppath))
+    {
+        return RETURN_FAILURE;
+    }
+    fd = mkstemp(tmppath);
+    if(fd == -1)
+    {
+        return RETURN_FAILURE;
+    }
+    fp = fdopen(fd, "wb");
+    if(fp == NULL)
+    {
+        close(fd);
+        remove(tmppath);
+        return RETURN_FAILURE;
+    }
+    for(int b = 0; b < nblk; b++)
+    {
+        if(fwrite(blk[b], 1, blksize[b], fp) != blksize[b])
+        {
+            ok = 0;
+        }
+    }
+    if(fclose(fp) != 0)
+    {
+        ok = 0;
+    }
+    if((ok == 0) || (rename(tmppath, path) != 0))
+    {
+        remove(tmppath);
+        return RETURN_FAILURE;
+    }
+    return RETURN_SUCCESS;
+}
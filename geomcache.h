@@ -0,0 +1,47 @@
+#ifndef IMAGE_GEN_GEOMCACHE_H
+#define IMAGE_GEN_GEOMCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @file geomcache.h
+ * @brief File cache of derived pupil geometry, memory-mapped on reuse
+ */
+
+#define GEOMCACHE_FNV_OFFSET 0xcbf29ce484222325ULL
+
+/** @brief FNV-1a 64-bit hash of buffer, continuing from h
+ *
+ * Start from GEOMCACHE_FNV_OFFSET.
+ */
+uint64_t geomcache_fnv1a(uint64_t h, const void *buf, size_t len);
+
+/** @brief Cache file path of key
+ *
+ * <dir>/<prefix>_<uid>_<key>.geomcache, dir is $MILK_SHM_DIR if set,
+ * /tmp otherwise, uid the effective user ID.
+ */
+void geomcache_path(char *path, size_t len, const char *prefix, uint64_t key);
+
+/** @brief Map cache file read-only
+ *
+ * NULL if absent, empty, not a regular file (symbolic links are not
+ * followed), not owned by the effective user or writable by others.
+ */
+void *geomcache_map(const char *path, size_t *mapsize);
+
+void geomcache_unmap(void *map, size_t mapsize);
+
+/** @brief Write blocks to cache file
+ *
+ * Blocks are written back to back to a temporary file created by
+ * mkstemp in the directory of path, renamed to path once complete:
+ * concurrent readers see either no file or a full one.
+ * Returns RETURN_FAILURE if the file cannot be written.
+ */
+errno_t geomcache_write(const char        *path,
+                        int                nblk,
+                        const void *const *blk,
+                        const size_t      *blksize);
+
+#endif
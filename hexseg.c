@@ -0,0 +1,515 @@
+/**
+ * @file    hexseg.c
+ * @brief   Geometry of hexagonal segmented pupils
+ *
+ * Segment validity, label map and moments of make_hexsegpupil, built
+ * from the lattice in O(pixels), and cached with geomcache if variable
+ * hexsegcache exists. The cache file holds a HEXSEGCACHEHDR header, then
+ * segx, segy, cand, moments and label map back to back. Indices read
+ * from the file are checked before use, and a file that fails the check
+ * is rebuilt.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CommandLineInterface/CLIcore.h"
+
+#include "geomcache.h"
+#include "hexseg.h"
+
+// pixel offset (x, y) from center within hexagon, as make_hexagon
+static inline int hexseg_inside(float x, float y, double rhex)
+{
+    float rsq = rhex * rhex;
+    float r1  = cos(M_PI / 6.0) * x + sin(M_PI / 6.0) * y;
+    float r2  = cos(-M_PI / 6.0) * x + sin(-M_PI / 6.0) * y;
+
+    return (x * x + y * y <= rsq) ||
+           ((fabs(y) <= rhex) && (fabs(r1) <= rhex) && (fabs(r2) <= rhex));
+}
+
+static long hexseg_clamp(long i, uint32_t size)
+{
+    if(i < 0)
+    {
+        return 0;
+    }
+    if(i > (long) size - 1)
+    {
+        return size - 1;
+    }
+    return i;
+}
+
+/**
+ * No pixel of the hexagon centered at (xc, yc) outside the pupil disk,
+ * over the make_hexagon bounding box. Same outcome as the former overlap
+ * of a full-frame hexagon image with the complement of the disk.
+ */
+static int hexseg_valid(
+    uint32_t size, double radius, double rhex, double xc, double yc)
+{
+    double xd      = size / 2; // pupil disk center, as make_disk call
+    float  radius1 = rhex * 2.0 / sqrt(3.0);
+    long   i0      = hexseg_clamp((long)(xc - radius1 - 1.0), size);
+    long   i1      = hexseg_clamp((long)(xc + radius1 + 1.0), size);
+    long   j0      = hexseg_clamp((long)(yc - radius1 - 1.0), size);
+    long   j1      = hexseg_clamp((long)(yc + radius1 + 1.0), size);
+
+    for(long jj = j0; jj < j1; jj++)
+        for(long ii = i0; ii < i1; ii++)
+        {
+            if(hexseg_inside(1.0 * ii - xc, 1.0 * jj - yc, rhex) &&
+                    ((ii - xd) * (ii - xd) + (jj - xd) * (jj - xd) >=
+                     radius * radius))
+            {
+                return 0;
+            }
+        }
+    return 1;
+}
+
+static void hexseg_init(
+    HEXSEG *hs, uint32_t size, double radius, double gap, double step)
+{
+    long x1max = (long)(2 * size / step);
+    long nq, nr, nmax;
+    int *valid;
+    long *candcell;
+
+    hs->step = step;
+    hs->rhex = (step - gap) * (sqrt(3.0) / 2.0);
+    hs->qmax = (long)(radius / (1.5 * step)) + 2;
+    hs->rmax = (long)(radius / (sqrt(3.0) * step)) + hs->qmax / 2 + 2;
+    nq       = 2 * hs->qmax + 1;
+    nr       = 2 * hs->rmax + 1;
+    nmax     = nq * nr;
+
+    hs->segx = (double *) malloc(sizeof(double) * nmax);
+    hs->segy = (double *) malloc(sizeof(double) * nmax);
+    hs->cand = (long *) malloc(sizeof(long) * nmax);
+    hs->cell = (long *) calloc(nmax, sizeof(long));
+    candcell = (long *) malloc(sizeof(long) * nmax);
+    valid    = (int *) malloc(sizeof(int) * nmax);
+    if((hs->segx == NULL) || (hs->segy == NULL) || (hs->cand == NULL) ||
+            (hs->cell == NULL) || (candcell == NULL) || (valid == NULL))
+    {
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
+    }
+
+    // candidates in legacy scan order, restricted to rows and columns
+    // reaching the disk; centers kept in segx, segy
+    long xa = -(long)(radius / (3.0 * step)) - 1;
+    long ya = -(long)(radius / (sqrt(3.0) * step)) - 1;
+    if(xa < -x1max)
+    {
+        xa = -x1max;
+    }
+    if(ya < -x1max)
+    {
+        ya = -x1max;
+    }
+    hs->ncand = 0;
+    for(long x1 = xa; (x1 < x1max) && (x1 <= -xa); x1++)
+        for(long y1 = ya; (y1 < x1max) && (y1 <= -ya); y1++)
+            for(int sub = 0; sub < 2; sub++)
+            {
+                double x2 = step * x1 * 3;
+                double y2 = step * sqrt(3.0) * y1;
+                if(sub == 1)
+                {
+                    x2 += step * 1.5;
+                    y2 += step * sqrt(3.0) / 2.0;
+                }
+                if(sqrt(x2 * x2 + y2 * y2) < radius)
+                {
+                    long q = 2 * x1 + sub;
+                    long r = y1 - x1;
+
+                    hs->segx[hs->ncand]  = x2;
+                    hs->segy[hs->ncand]  = y2;
+                    candcell[hs->ncand] = (r + hs->rmax) * nq + q + hs->qmax;
+                    hs->ncand++;
+                }
+            }
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for schedule(dynamic, 4)
+#endif
+    for(long c = 0; c < hs->ncand; c++)
+    {
+        valid[c] = hexseg_valid(size,
+                                radius,
+                                hs->rhex,
+                                0.5 * size + hs->segx[c],
+                                0.5 * size + hs->segy[c]);
+    }
+
+    // number segments, compacting centers
+    hs->nseg = 0;
+    for(long c = 0; c < hs->ncand; c++)
+    {
+        hs->cand[c] = -1;
+        if(valid[c])
+        {
+            hs->segx[hs->nseg]  = hs->segx[c];
+            hs->segy[hs->nseg]  = hs->segy[c];
+            hs->cand[c]         = hs->nseg;
+            hs->nseg++;
+            hs->cell[candcell[c]] = hs->nseg;
+        }
+    }
+
+    free(candcell);
+    free(valid);
+}
+
+static void hexseg_free(HEXSEG *hs)
+{
+    free(hs->segx);
+    free(hs->segy);
+    free(hs->cand);
+    free(hs->cell);
+}
+
+/**
+ * @brief Segment label map, one pass
+ *
+ * Each pixel is rounded to its nearest lattice cell in cube coordinates
+ * and tested against that cell's hexagon, as make_hexagon. label : size
+ * x size, segment index + 1, 0 outside segments. Requires gap >= 0
+ * (hexagons within their cells).
+ */
+static void hexseg_label(const HEXSEG *hs, uint32_t size, int32_t *label)
+{
+    long   nq      = 2 * hs->qmax + 1;
+    double step    = hs->step;
+    float  radius1 = hs->rhex * 2.0 / sqrt(3.0);
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for(uint32_t jj = 0; jj < size; jj++)
+    {
+        for(uint32_t ii = 0; ii < size; ii++)
+        {
+            double X  = ii - 0.5 * size;
+            double Y  = jj - 0.5 * size;
+            double qf = X / (1.5 * step);
+            double rf = Y / (sqrt(3.0) * step) - 0.5 * qf;
+            double sf = -qf - rf;
+            double qr = round(qf);
+            double rr = round(rf);
+            double sr = round(sf);
+            int32_t v = 0;
+
+            // cube rounding : fix the component with largest error
+            if((fabs(qr - qf) > fabs(rr - rf)) &&
+                    (fabs(qr - qf) > fabs(sr - sf)))
+            {
+                qr = -rr - sr;
+            }
+            else if(fabs(rr - rf) > fabs(sr - sf))
+            {
+                rr = -qr - sr;
+            }
+
+            long q = (long) qr;
+            long r = (long) rr;
+            if((labs(q) <= hs->qmax) && (labs(r) <= hs->rmax))
+            {
+                long seg = hs->cell[(r + hs->rmax) * nq + q + hs->qmax] - 1;
+                if(seg >= 0)
+                {
+                    double xc = 0.5 * size + hs->segx[seg];
+                    double yc = 0.5 * size + hs->segy[seg];
+
+                    // upper edges of make_hexagon bounding box excluded
+                    if((ii < hexseg_clamp((long)(xc + radius1 + 1.0), size)) &&
+                            (jj < hexseg_clamp((long)(yc + radius1 + 1.0),
+                                               size)) &&
+                            hexseg_inside(1.0 * ii - xc, 1.0 * jj - yc,
+                                          hs->rhex))
+                    {
+                        v = seg + 1;
+                    }
+                }
+            }
+            label[(uint64_t) jj * size + ii] = v;
+        }
+    }
+}
+
+// moments of all segments, one pass over the label map
+static HEXSEGMOM *
+hexseg_moments(const HEXSEG *hs, uint32_t size, const int32_t *label)
+{
+    HEXSEGMOM *mom;
+
+    mom = (HEXSEGMOM *) calloc(hs->nseg + 1, sizeof(HEXSEGMOM));
+    if(mom == NULL)
+    {
+        PRINT_ERROR("calloc returns NULL pointer");
+        abort();
+    }
+    for(long seg = 0; seg < hs->nseg; seg++)
+    {
+        mom[seg].imin = size;
+        mom[seg].jmin = size;
+        mom[seg].imax = -1;
+        mom[seg].jmax = -1;
+    }
+
+    for(uint32_t jj = 0; jj < size; jj++)
+        for(uint32_t ii = 0; ii < size; ii++)
+        {
+            int32_t v = label[(uint64_t) jj * size + ii];
+            if(v > 0)
+            {
+                HEXSEGMOM *m  = &mom[v - 1];
+                double     dx = ii - (0.5 * size + hs->segx[v - 1]);
+                double     dy = jj - (0.5 * size + hs->segy[v - 1]);
+
+                m->npix++;
+                m->sx += dx;
+                m->sy += dy;
+                m->sxx += dx * dx;
+                m->syy += dy * dy;
+                if(ii < m->imin)
+                {
+                    m->imin = ii;
+                }
+                if(ii > m->imax)
+                {
+                    m->imax = ii;
+                }
+                if(jj < m->jmin)
+                {
+                    m->jmin = jj;
+                }
+                m->jmax = jj;
+            }
+        }
+
+    for(long seg = 0; seg < hs->nseg; seg++)
+    {
+        HEXSEGMOM *m = &mom[seg];
+        if(m->npix > 0)
+        {
+            double rmsx = m->sxx - m->sx * m->sx / m->npix;
+            double rmsy = m->syy - m->sy * m->sy / m->npix;
+
+            m->xc = 0.5 * size + hs->segx[seg] + m->sx / m->npix;
+            m->yc = 0.5 * size + hs->segy[seg] + m->sy / m->npix;
+            m->gx = (rmsx > 0.0) ? sqrt(m->npix / rmsx) : 0.0;
+            m->gy = (rmsy > 0.0) ? sqrt(m->npix / rmsy) : 0.0;
+        }
+    }
+
+    return mom;
+}
+
+typedef struct
+{
+    char     magic[8];
+    uint32_t size;
+    uint32_t version; // HEXSEGCACHE_VERSION
+    double   radius;
+    double   gap;
+    double   step;
+    // above : cache key
+    double   rhex;
+    int64_t  nseg;
+    int64_t  ncand;
+} HEXSEGCACHEHDR;
+
+#define HEXSEGCACHE_MAGIC "HEXSEG1"
+
+// bump when lattice, label map or moments computation changes
+#define HEXSEGCACHE_VERSION 2
+
+static size_t hexseg_cache_size(const HEXSEGCACHEHDR *hdr)
+{
+    return sizeof(HEXSEGCACHEHDR) +
+           hdr->nseg * (2 * sizeof(double) + sizeof(HEXSEGMOM)) +
+           hdr->ncand * sizeof(long) +
+           (size_t) hdr->size * hdr->size * sizeof(int32_t);
+}
+
+/**
+ * @brief Check indices read from a cache file
+ *
+ * Candidates map to -1 or a segment, labels to 0 .. nseg, bounding
+ * boxes lie in the frame : callers index arrays with all three. The
+ * label scan is a parallel, branch-free reduction : it faults in the
+ * pages callers read next anyway.
+ */
+static int hexseg_cache_valid(const HEXSEGGEOM *g, uint32_t size)
+{
+    long     nseg = g->hs.nseg;
+    uint64_t npix = (uint64_t) size * size;
+    int      bad  = 0;
+
+    for(long c = 0; c < g->hs.ncand; c++)
+    {
+        if((g->hs.cand[c] < -1) || (g->hs.cand[c] >= nseg))
+        {
+            return 0;
+        }
+    }
+    for(long seg = 0; seg < nseg; seg++)
+    {
+        const HEXSEGMOM *m = &g->mom[seg];
+        if((m->npix > 0) &&
+                ((m->imin < 0) || (m->imax >= (long) size) ||
+                 (m->imin > m->imax) || (m->jmin < 0) ||
+                 (m->jmax >= (long) size) || (m->jmin > m->jmax)))
+        {
+            return 0;
+        }
+    }
+    // negative labels wrap above nseg
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for reduction(| : bad) schedule(static)
+#endif
+    for(uint64_t ii = 0; ii < npix; ii++)
+    {
+        bad |= ((uint32_t) g->label[ii] > (uint64_t) nseg);
+    }
+    return (bad == 0);
+}
+
+// point geometry into cache mapping, 0 if mapping does not match
+static int hexseg_cache_attach(HEXSEGGEOM           *g,
+                               void                 *map,
+                               size_t                mapsize,
+                               const HEXSEGCACHEHDR *key)
+{
+    const HEXSEGCACHEHDR *hdr = (const HEXSEGCACHEHDR *) map;
+    char                 *p   = (char *) map + sizeof(HEXSEGCACHEHDR);
+
+    if((mapsize < sizeof(HEXSEGCACHEHDR)) ||
+            (memcmp(hdr, key, offsetof(HEXSEGCACHEHDR, rhex)) != 0) ||
+            (hdr->nseg < 0) || (hdr->ncand < hdr->nseg) ||
+            (hexseg_cache_size(hdr) != mapsize))
+    {
+        return 0;
+    }
+
+    memset(&g->hs, 0, sizeof(HEXSEG));
+    g->hs.nseg  = hdr->nseg;
+    g->hs.ncand = hdr->ncand;
+    g->hs.step  = hdr->step;
+    g->hs.rhex  = hdr->rhex;
+    g->hs.segx  = (double *) p;
+    p += hdr->nseg * sizeof(double);
+    g->hs.segy = (double *) p;
+    p += hdr->nseg * sizeof(double);
+    g->hs.cand = (long *) p;
+    p += hdr->ncand * sizeof(long);
+    g->mom = (HEXSEGMOM *) p;
+    p += hdr->nseg * sizeof(HEXSEGMOM);
+    g->label   = (int32_t *) p;
+    g->map     = map;
+    g->mapsize = mapsize;
+
+    return hexseg_cache_valid(g, hdr->size);
+}
+
+void hexseg_geom(HEXSEGGEOM *g,
+                 uint32_t    size,
+                 double      radius,
+                 double      gap,
+                 double      step)
+{
+    HEXSEGCACHEHDR hdr;
+    char           fname[STRINGMAXLEN_FULLFILENAME];
+    int            cache = (variable_ID("hexsegcache") != -1);
+
+    memset(&hdr, 0, sizeof(hdr));
+    strcpy(hdr.magic, HEXSEGCACHE_MAGIC);
+    hdr.size    = size;
+    hdr.version = HEXSEGCACHE_VERSION;
+    hdr.radius  = radius;
+    hdr.gap     = gap;
+    hdr.step    = step;
+
+    if(cache == 1)
+    {
+        uint64_t key = geomcache_fnv1a(GEOMCACHE_FNV_OFFSET,
+                                       &hdr,
+                                       offsetof(HEXSEGCACHEHDR, rhex));
+        void    *map;
+        size_t   mapsize;
+
+        geomcache_path(fname, sizeof(fname), "hexseg", key);
+        map = geomcache_map(fname, &mapsize);
+        if(map != NULL)
+        {
+            if(hexseg_cache_attach(g, map, mapsize, &hdr) == 1)
+            {
+                printf("hexseg geometry from cache %s\n", fname);
+                return;
+            }
+            // stale or corrupt : rebuilt and replaced below
+            printf("WARNING: invalid hexseg cache %s\n", fname);
+            geomcache_unmap(map, mapsize);
+        }
+    }
+
+    hexseg_init(&g->hs, size, radius, gap, step);
+    g->label = (int32_t *) malloc(sizeof(int32_t) * size * size);
+    if(g->label == NULL)
+    {
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
+    }
+    hexseg_label(&g->hs, size, g->label);
+    g->mom     = hexseg_moments(&g->hs, size, g->label);
+    g->map     = NULL;
+    g->mapsize = 0;
+
+    if(cache == 1)
+    {
+        const void *blk[6];
+        size_t      blksize[6];
+
+        hdr.rhex   = g->hs.rhex;
+        hdr.nseg   = g->hs.nseg;
+        hdr.ncand  = g->hs.ncand;
+        blk[0]     = &hdr;
+        blksize[0] = sizeof(hdr);
+        blk[1]     = g->hs.segx;
+        blksize[1] = hdr.nseg * sizeof(double);
+        blk[2]     = g->hs.segy;
+        blksize[2] = hdr.nseg * sizeof(double);
+        blk[3]     = g->hs.cand;
+        blksize[3] = hdr.ncand * sizeof(long);
+        blk[4]     = g->mom;
+        blksize[4] = hdr.nseg * sizeof(HEXSEGMOM);
+        blk[5]     = g->label;
+        blksize[5] = (size_t) size * size * sizeof(int32_t);
+        if(geomcache_write(fname, 6, blk, blksize) != RETURN_SUCCESS)
+        {
+            printf("WARNING: cannot write hexseg cache %s\n", fname);
+        }
+    }
+}
+
+void hexseg_geom_free(HEXSEGGEOM *g)
+{
+    if(g->map != NULL)
+    {
+        geomcache_unmap(g->map, g->mapsize);
+    }
+    else
+    {
+        hexseg_free(&g->hs);
+        free(g->label);
+        free(g->mom);
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef IMAGE_GEN_HEXSEG_H
+#define IMAGE_GEN_HEXSEG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @file hexseg.h
+ * @brief Geometry of hexagonal segmented pupils
+ */
+
+/**
+ * @brief Hexagonal segment lattice
+ *
+ * Segment centers form a hex lattice of pitch sqrt(3) step, with flat
+ * cell sides along x. In axial coordinates (q, r) the center offset from
+ * the frame center is x = 1.5 step q, y = sqrt(3) step (r + q / 2).
+ * Candidates (center within radius) are enumerated in the legacy scan
+ * order; a candidate is a segment if none of its hexagon pixels lies
+ * outside the pupil disk.
+ */
+typedef struct
+{
+    long    nseg;
+    double  step;
+    double  rhex;  // hexagon inner radius
+    double *segx;  // segment center offset from frame center
+    double *segy;
+    long    ncand;
+    long   *cand;  // candidate -> segment index, -1 if rejected
+    long    qmax;  // cell table : q in [-qmax, qmax], r in [-rmax, rmax]
+    long    rmax;
+    long   *cell;  // cell -> segment index + 1, 0 if none
+} HEXSEG;
+
+/**
+ * @brief Segment moments, one pass over the label map
+ *
+ * Pixel count, bounding box, centroid (xc, yc) and tip / tilt gains
+ * sqrt(npix / sum (x - xc)^2) of each segment. Sums are taken about the
+ * lattice centers to limit cancellation in the second moments.
+ */
+typedef struct
+{
+    long   npix;
+    long   imin, imax;
+    long   jmin, jmax;
+    double sx, sy;
+    double sxx, syy;
+    double xc, yc;
+    double gx, gy;
+} HEXSEGMOM;
+
+/**
+ * @brief Segment geometry of a pupil : lattice, label map and moments
+ *
+ * label : size x size, segment index + 1, 0 outside segments. mom :
+ * one entry per segment.
+ */
+typedef struct
+{
+    HEXSEG     hs;
+    int32_t   *label;
+    HEXSEGMOM *mom;
+    void      *map; // cache file mapping, NULL if built
+    size_t     mapsize;
+} HEXSEGGEOM;
+
+/** @brief Segment geometry of pupil (size, radius, gap, step)
+ *
+ * If variable hexsegcache exists, kept in a geomcache file, mapped
+ * read-only by later calls with the same parameters. Requires gap >= 0.
+ */
+void hexseg_geom(HEXSEGGEOM *g,
+                 uint32_t    size,
+                 double      radius,
+                 double      gap,
+                 double      step);
+
+void hexseg_geom_free(HEXSEGGEOM *g);
+
+#endif
@@ -26,6 +26,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
 #include <fitsio.h> /* required by every program that uses CFITSIO  */
 
@@ -39,7 +40,16 @@
 
 #include "image_gen/image_gen.h"
 
+#include "cbrng.h"
+#include "diskbatch.h"
+#include "hexseg.h"
+#include "imgenaccuracy.h"
+#include "imgenbench.h"
+#include "mkhexsegphase.h"
+#include "mkphasescreen.h"
 #include "mkrandomim.h"
+#include "pixcoverage.h"
+#include "sdfraster.h"
 
 #define OMP_NELEMENT_LIMIT 1000000
 
@@ -109,6 +119,29 @@ errno_t make_subpixdisk_cli()
     }
 }
 
+errno_t make_subpixdisk_mode_cli()
+{
+    if(CLI_checkarg(1, CLIARG_STR_NOT_IMG) + CLI_checkarg(2, CLIARG_INT64) +
+            CLI_checkarg(3, CLIARG_INT64) + CLI_checkarg(4, CLIARG_FLOAT64) +
+            CLI_checkarg(5, CLIARG_FLOAT64) + CLI_checkarg(6, CLIARG_FLOAT64) +
+            CLI_checkarg(7, CLIARG_INT64) ==
+            0)
+    {
+        make_subpixdisk_mode(data.cmdargtoken[1].val.string,
+                             data.cmdargtoken[2].val.numl,
+                             data.cmdargtoken[3].val.numl,
+                             data.cmdargtoken[4].val.numf,
+                             data.cmdargtoken[5].val.numf,
+                             data.cmdargtoken[6].val.numf,
+                             (int) data.cmdargtoken[7].val.numl);
+        return CLICMD_SUCCESS;
+    }
+    else
+    {
+        return CLICMD_INVALID_ARG;
+    }
+}
+
 errno_t make_gauss_cli()
 {
     if(CLI_checkarg(1, CLIARG_STR_NOT_IMG) + CLI_checkarg(2, CLIARG_INT64) +
@@ -202,6 +235,26 @@ errno_t make_hexsegpupil_cli()
     }
 }
 
+errno_t make_hexseglabel_cli()
+{
+    if(CLI_checkarg(1, CLIARG_STR_NOT_IMG) + CLI_checkarg(2, CLIARG_INT64) +
+            CLI_checkarg(3, CLIARG_FLOAT64) + CLI_checkarg(4, CLIARG_FLOAT64) +
+            CLI_checkarg(5, CLIARG_FLOAT64) ==
+            0)
+    {
+        make_hexseglabel(data.cmdargtoken[1].val.string,
+                         data.cmdargtoken[2].val.numl,
+                         data.cmdargtoken[3].val.numf,
+                         data.cmdargtoken[4].val.numf,
+                         data.cmdargtoken[5].val.numf);
+        return CLICMD_SUCCESS;
+    }
+    else
+    {
+        return CLICMD_INVALID_ARG;
+    }
+}
+
 errno_t IMAGE_gen_segments2WFmodes_cli()
 {
     if(CLI_checkarg(1, CLIARG_STR_NOT_IMG) + CLI_checkarg(2, CLIARG_INT64) +
@@ -266,6 +319,280 @@ errno_t make_line_cli()
     }
 }
 
+errno_t image_gen_set_datatype_cli()
+{
+    if(CLI_checkarg(1, CLIARG_STR) + CLI_checkarg(2, CLIARG_FLOAT64) == 0)
+    {
+        const char *name  = data.cmdargtoken[1].val.string;
+        double      scale = data.cmdargtoken[2].val.numf;
+        uint8_t     datatype;
+
+        if(strcasecmp(name, "MASK") == 0)
+        {
+            datatype = IMAGE_GEN_DATATYPE_MASK;
+            scale    = 1.0;
+        }
+        else
+        {
+            datatype = image_gen_datatype_from_name(name);
+        }
+
+        if(image_gen_set_datatype(datatype, scale) != RETURN_SUCCESS)
+        {
+            return CLICMD_INVALID_ARG;
+        }
+        return CLICMD_SUCCESS;
+    }
+    else
+    {
+        return CLICMD_INVALID_ARG;
+    }
+}
+
+errno_t image_gen_set_inplace_cli()
+{
+    if(CLI_checkarg(1, CLIARG_INT64) == 0)
+    {
+        image_gen_set_inplace((int) data.cmdargtoken[1].val.numl);
+        return CLICMD_SUCCESS;
+    }
+    else
+    {
+        return CLICMD_INVALID_ARG;
+    }
+}
+
+errno_t make_aashape_cli()
+{
+    if(CLI_checkarg(1, CLIARG_STR_NOT_IMG) + CLI_checkarg(2, CLIARG_INT64) +
+            CLI_checkarg(3, CLIARG_INT64) + CLI_checkarg(4, CLIARG_STR) +
+            CLI_checkarg(5, CLIARG_FLOAT64) + CLI_checkarg(6, CLIARG_FLOAT64) +
+            CLI_checkarg(7, CLIARG_FLOAT64) + CLI_checkarg(8, CLIARG_FLOAT64) +
+            CLI_checkarg(9, CLIARG_FLOAT64) ==
+            0)
+    {
+        if(make_aashape(data.cmdargtoken[1].val.string,
+                        data.cmdargtoken[2].val.numl,
+                        data.cmdargtoken[3].val.numl,
+                        data.cmdargtoken[4].val.string,
+                        data.cmdargtoken[5].val.numf,
+                        data.cmdargtoken[6].val.numf,
+                        data.cmdargtoken[7].val.numf,
+                        data.cmdargtoken[8].val.numf,
+                        data.cmdargtoken[9].val.numf) == -1)
+        {
+            return CLICMD_INVALID_ARG;
+        }
+        return CLICMD_SUCCESS;
+    }
+    else
+    {
+        return CLICMD_INVALID_ARG;
+    }
+}
+
+errno_t make_pupil_cli()
+{
+    if(CLI_checkarg(1, CLIARG_STR_NOT_IMG) + CLI_checkarg(2, CLIARG_INT64) +
+            CLI_checkarg(3, CLIARG_INT64) + CLI_checkarg(4, CLIARG_FLOAT64) +
+            CLI_checkarg(5, CLIARG_FLOAT64) + CLI_checkarg(6, CLIARG_FLOAT64) +
+            CLI_checkarg(7, CLIARG_FLOAT64) + CLI_checkarg(8, CLIARG_INT64) +
+            CLI_checkarg(9, CLIARG_FLOAT64) +
+            CLI_checkarg(10, CLIARG_FLOAT64) +
+            CLI_checkarg(11, CLIARG_FLOAT64) ==
+            0)
+    {
+        // evenly spaced identical vanes
+        long    nvane = data.cmdargtoken[8].val.numl;
+        double *vane  = NULL;
+
+        if(nvane < 0)
+        {
+            return CLICMD_INVALID_ARG;
+        }
+        if(nvane > 0)
+        {
+            vane = (double *) malloc(sizeof(double) * 3 * nvane);
+            if(vane == NULL)
+            {
+                PRINT_ERROR("malloc returns NULL pointer");
+                abort();
+            }
+        }
+        for(long k = 0; k < nvane; k++)
+        {
+            double angle0 = data.cmdargtoken[9].val.numf;
+
+            vane[k]             = angle0 + 2.0 * PI * k / nvane;
+            vane[nvane + k]     = data.cmdargtoken[10].val.numf;
+            vane[2 * nvane + k] = data.cmdargtoken[11].val.numf;
+        }
+
+        make_pupil(data.cmdargtoken[1].val.string,
+                   data.cmdargtoken[2].val.numl,
+                   data.cmdargtoken[3].val.numl,
+                   data.cmdargtoken[4].val.numf,
+                   data.cmdargtoken[5].val.numf,
+                   data.cmdargtoken[6].val.numf,
+                   data.cmdargtoken[7].val.numf,
+                   nvane,
+                   vane,
+                   vane + nvane,
+                   vane + 2 * nvane);
+        free(vane);
+        return CLICMD_SUCCESS;
+    }
+    else
+    {
+        return CLICMD_INVALID_ARG;
+    }
+}
+
+errno_t make_disks_file_cli()
+{
+    if(CLI_checkarg(1, CLIARG_STR_NOT_IMG) + CLI_checkarg(2, CLIARG_INT64) +
+            CLI_checkarg(3, CLIARG_INT64) + CLI_checkarg(4, CLIARG_STR) ==
+            0)
+    {
+        if(make_disks_file(data.cmdargtoken[1].val.string,
+                           data.cmdargtoken[2].val.numl,
+                           data.cmdargtoken[3].val.numl,
+                           data.cmdargtoken[4].val.string) == -1)
+        {
+            return CLICMD_INVALID_ARG;
+        }
+        return CLICMD_SUCCESS;
+    }
+    else
+    {
+        return CLICMD_INVALID_ARG;
+    }
+}
+
+// nslice values linearly spaced from v0 to v1
+static void sweep_linear(long nslice, double v0, double v1, double *v)
+{
+    for(long k = 0; k < nslice; k++)
+    {
+        v[k] = (nslice > 1) ? v0 + (v1 - v0) * k / (nslice - 1) : v0;
+    }
+}
+
+errno_t make_subpixdisk_sweep_cli()
+{
+    if(CLI_checkarg(1, CLIARG_STR_NOT_IMG) + CLI_checkarg(2, CLIARG_INT64) +
+            CLI_checkarg(3, CLIARG_INT64) + CLI_checkarg(4, CLIARG_INT64) +
+            CLI_checkarg(5, CLIARG_FLOAT64) + CLI_checkarg(6, CLIARG_FLOAT64) +
+            CLI_checkarg(7, CLIARG_FLOAT64) + CLI_checkarg(8, CLIARG_FLOAT64) +
+            CLI_checkarg(9, CLIARG_FLOAT64) +
+            CLI_checkarg(10, CLIARG_FLOAT64) +
+            CLI_checkarg(11, CLIARG_INT64) ==
+            0)
+    {
+        long nslice = data.cmdargtoken[4].val.numl;
+        if(nslice < 1)
+        {
+            return CLICMD_INVALID_ARG;
+        }
+
+        double *v = (double *) malloc(sizeof(double) * 3 * nslice);
+        if(v == NULL)
+        {
+            PRINT_ERROR("malloc returns NULL pointer");
+            abort();
+        }
+        for(int p = 0; p < 3; p++)
+        {
+            sweep_linear(nslice,
+                         data.cmdargtoken[5 + p].val.numf,
+                         data.cmdargtoken[8 + p].val.numf,
+                         v + p * nslice);
+        }
+
+        make_subpixdisk_sweep(data.cmdargtoken[1].val.string,
+                              data.cmdargtoken[2].val.numl,
+                              data.cmdargtoken[3].val.numl,
+                              nslice,
+                              v,
+                              v + nslice,
+                              v + 2 * nslice,
+                              (int) data.cmdargtoken[11].val.numl);
+        free(v);
+        return CLICMD_SUCCESS;
+    }
+    else
+    {
+        return CLICMD_INVALID_ARG;
+    }
+}
+
+errno_t make_pupil_sweep_cli()
+{
+    if(CLI_checkarg(1, CLIARG_STR_NOT_IMG) + CLI_checkarg(2, CLIARG_INT64) +
+            CLI_checkarg(3, CLIARG_INT64) + CLI_checkarg(4, CLIARG_INT64) +
+            CLI_checkarg(5, CLIARG_FLOAT64) + CLI_checkarg(6, CLIARG_FLOAT64) +
+            CLI_checkarg(7, CLIARG_FLOAT64) + CLI_checkarg(8, CLIARG_FLOAT64) +
+            CLI_checkarg(9, CLIARG_FLOAT64) +
+            CLI_checkarg(10, CLIARG_FLOAT64) +
+            CLI_checkarg(11, CLIARG_FLOAT64) +
+            CLI_checkarg(12, CLIARG_INT64) +
+            CLI_checkarg(13, CLIARG_FLOAT64) +
+            CLI_checkarg(14, CLIARG_FLOAT64) ==
+            0)
+    {
+        long nslice = data.cmdargtoken[4].val.numl;
+        long nvane  = data.cmdargtoken[12].val.numl;
+        if((nslice < 1) || (nvane < 0))
+        {
+            return CLICMD_INVALID_ARG;
+        }
+
+        double *v =
+            (double *) malloc(sizeof(double) * (3 * nslice + 3 * nvane));
+        if(v == NULL)
+        {
+            PRINT_ERROR("malloc returns NULL pointer");
+            abort();
+        }
+        for(int p = 0; p < 3; p++)
+        {
+            sweep_linear(nslice,
+                         data.cmdargtoken[5 + p].val.numf,
+                         data.cmdargtoken[8 + p].val.numf,
+                         v + p * nslice);
+        }
+        // evenly spaced identical vanes
+        double *vane = v + 3 * nslice;
+        for(long k = 0; k < nvane; k++)
+        {
+            double angle0 = data.cmdargtoken[13].val.numf;
+
+            vane[k]             = angle0 + 2.0 * PI * k / nvane;
+            vane[nvane + k]     = data.cmdargtoken[14].val.numf;
+            vane[2 * nvane + k] = 0.0;
+        }
+
+        make_pupil_sweep(data.cmdargtoken[1].val.string,
+                         data.cmdargtoken[2].val.numl,
+                         data.cmdargtoken[3].val.numl,
+                         nslice,
+                         v,
+                         v + nslice,
+                         v + 2 * nslice,
+                         data.cmdargtoken[11].val.numf,
+                         nvane,
+                         vane,
+                         vane + nvane,
+                         vane + 2 * nvane);
+        free(v);
+        return CLICMD_SUCCESS;
+    }
+    else
+    {
+        return CLICMD_INVALID_ARG;
+    }
+}
+
 errno_t make_lincoordinate_cli()
 {
     if(CLI_checkarg(1, CLIARG_STR_NOT_IMG) + CLI_checkarg(2, CLIARG_INT64) +
@@ -350,6 +677,52 @@ errno_t make_rndgauss_cli()
     }
 }
 
+errno_t make_rnd_cbrng_cli()
+{
+    if(CLI_checkarg(1, CLIARG_STR_NOT_IMG) + CLI_checkarg(2, CLIARG_INT64) +
+            CLI_checkarg(3, CLIARG_INT64) + CLI_checkarg(4, CLIARG_INT64) +
+            CLI_checkarg(5, CLIARG_INT64) ==
+            0)
+    {
+        make_rnd_cbrng(data.cmdargtoken[1].val.string,
+                       data.cmdargtoken[2].val.numl,
+                       data.cmdargtoken[3].val.numl,
+                       data.cmdargtoken[4].val.numl,
+                       data.cmdargtoken[5].val.numl);
+
+        return CLICMD_SUCCESS;
+    }
+    else
+    {
+        return CLICMD_INVALID_ARG;
+    }
+}
+
+errno_t make_rnd_cbrng_frame_cli()
+{
+    if(CLI_checkarg(1, CLIARG_STR_NOT_IMG) + CLI_checkarg(2, CLIARG_INT64) +
+            CLI_checkarg(3, CLIARG_INT64) + CLI_checkarg(4, CLIARG_INT64) +
+            CLI_checkarg(5, CLIARG_FLOAT64) + CLI_checkarg(6, CLIARG_FLOAT64) +
+            CLI_checkarg(7, CLIARG_INT64) + CLI_checkarg(8, CLIARG_INT64) ==
+            0)
+    {
+        make_rnd_cbrng_frame(data.cmdargtoken[1].val.string,
+                             data.cmdargtoken[2].val.numl,
+                             data.cmdargtoken[3].val.numl,
+                             data.cmdargtoken[4].val.numl,
+                             data.cmdargtoken[5].val.numf,
+                             data.cmdargtoken[6].val.numf,
+                             data.cmdargtoken[7].val.numl,
+                             data.cmdargtoken[8].val.numl);
+
+        return CLICMD_SUCCESS;
+    }
+    else
+    {
+        return CLICMD_INVALID_ARG;
+    }
+}
+
 errno_t image_gen_im2coord_cli()
 {
     if(CLI_checkarg(1, CLIARG_IMG) + CLI_checkarg(2, CLIARG_INT64) +
@@ -392,6 +765,51 @@ errno_t image_gen_make_voronoi_map_cli()
     }
 }
 
+errno_t image_gen_benchmark_cli()
+{
+    if(CLI_checkarg(1, CLIARG_STR) + CLI_checkarg(2, CLIARG_INT64) +
+            CLI_checkarg(3, CLIARG_INT64) + CLI_checkarg(4, CLIARG_INT64) +
+            CLI_checkarg(5, CLIARG_FLOAT64) + CLI_checkarg(6, CLIARG_FLOAT64) ==
+            0)
+    {
+        if(image_gen_benchmark(data.cmdargtoken[1].val.string,
+                               data.cmdargtoken[2].val.numl,
+                               data.cmdargtoken[3].val.numl,
+                               data.cmdargtoken[4].val.numl,
+                               data.cmdargtoken[5].val.numf,
+                               data.cmdargtoken[6].val.numf) !=
+                RETURN_SUCCESS)
+        {
+            return CLICMD_INVALID_ARG;
+        }
+        return CLICMD_SUCCESS;
+    }
+    else
+    {
+        return CLICMD_INVALID_ARG;
+    }
+}
+
+errno_t image_gen_accuracy_cli()
+{
+    if(CLI_checkarg(1, CLIARG_STR) + CLI_checkarg(2, CLIARG_INT64) +
+            CLI_checkarg(3, CLIARG_INT64) ==
+            0)
+    {
+        if(image_gen_accuracy(data.cmdargtoken[1].val.string,
+                              data.cmdargtoken[2].val.numl,
+                              data.cmdargtoken[3].val.numl) != RETURN_SUCCESS)
+        {
+            return CLICMD_INVALID_ARG;
+        }
+        return CLICMD_SUCCESS;
+    }
+    else
+    {
+        return CLICMD_INVALID_ARG;
+    }
+}
+
 static errno_t init_module_CLI()
 {
 
@@ -415,6 +833,18 @@ static errno_t init_module_CLI()
         "long make_subpixdisk(const char *ID_name, long l1, long l2, double "
         "x_center, double y_center, double radius)");
 
+    RegisterCLIcommand(
+        "mkspdiskm",
+        __FILE__,
+        make_subpixdisk_mode_cli,
+        "make disk image with sub-pixel coverage, mode 0: 55x55 subgrid, "
+        "1: exact area",
+        "<output image name> <xsize> <yize> <xcenter> <ycenter> <radius> "
+        "<mode>",
+        "mkspdiskm imdisk 512 512 256.0 256.0 100.0 1",
+        "long make_subpixdisk_mode(const char *ID_name, long l1, long l2, "
+        "double x_center, double y_center, double radius, int mode)");
+
     RegisterCLIcommand("mkgauss",
                        __FILE__,
                        make_gauss_cli,
@@ -461,6 +891,15 @@ static errno_t init_module_CLI()
                        "long make_hexsegpupil(const char *IDname, long size, "
                        "double radius, double gap, double step)");
 
+    RegisterCLIcommand("mkhexseglabel",
+                       __FILE__,
+                       make_hexseglabel_cli,
+                       "make INT32 label map of hexagonal pupil segments",
+                       "<output image name> <size> <radius> <gap> <step>",
+                       "mkhexseglabel hexlabel 4096 2000 2.0 46.3",
+                       "long make_hexseglabel(const char *IDname, long size, "
+                       "double radius, double gap, double step)");
+
     RegisterCLIcommand(
         "segs2wfmodes",
         __FILE__,
@@ -492,15 +931,99 @@ static errno_t init_module_CLI()
         "long make_line(const char *IDname, long l1, long l2, double x1, "
         "double y1, double x2, double y2, double t)");
 
-    RegisterCLIcommand("mklincoord",
-                       __FILE__,
-                       make_lincoordinate_cli,
-                       "make linear coordinate",
-                       "<output image name> <xsize> <ysize> <xc> <yc> <angle>",
-                       "mklincoord lim 512 512 256.0 256.0 1.42",
-                       "long make_lincoordinate(const char *IDname, long l1, "
-                       "long l2, double x_center, double "
-                       "y_center, double angle)");
+    RegisterCLIcommand(
+        "imgendatatype",
+        __FILE__,
+        image_gen_set_datatype_cli,
+        "output datatype and value scale of shape generators: UINT8, "
+        "INT16, UINT16, FLOAT, DOUBLE, ..., MASK (UINT8 0/1)",
+        "<datatype> <scale>",
+        "imgendatatype MASK 1",
+        "errno_t image_gen_set_datatype(uint8_t datatype, double scale)");
+
+    RegisterCLIcommand(
+        "imgeninplace",
+        __FILE__,
+        image_gen_set_inplace_cli,
+        "shape generators draw into existing image of same size and "
+        "datatype: clear previous shape bounding box, draw, post semaphores "
+        "(1: on, 0: off)",
+        "<mode>",
+        "imgeninplace 1",
+        "void image_gen_set_inplace(int mode)");
+
+    RegisterCLIcommand(
+        "mkaashape",
+        __FILE__,
+        make_aashape_cli,
+        "make anti-aliased shape: disk, square, rect, hex, line",
+        "<output image name> <xsize> <ysize> <shape> <p1> <p2> <p3> <p4> "
+        "<p5>",
+        "mkaashape him 512 512 hex 256.0 256.0 100.0 0.0 0.1",
+        "long make_aashape(const char *ID_name, long l1, long l2, const "
+        "char *shape, double p1, double p2, double p3, double p4, double p5)");
+
+    RegisterCLIcommand(
+        "mkpupil",
+        __FILE__,
+        make_pupil_cli,
+        "make anti-aliased annular pupil with evenly spaced spider vanes",
+        "<output image name> <xsize> <ysize> <xcenter> <ycenter> <rout> "
+        "<rin> <nvane> <angle0> <vanewidth> <vaneoffset>",
+        "mkpupil pup 512 512 256.0 256.0 200.0 60.0 4 0.785 3.0 0.0",
+        "long make_pupil(const char *ID_name, long l1, long l2, double "
+        "x_center, double y_center, double radius_out, double radius_in, "
+        "long nvane, const double *vane_angle, const double *vane_width, "
+        "const double *vane_offset)");
+
+    RegisterCLIcommand(
+        "mkdisks",
+        __FILE__,
+        make_disks_file_cli,
+        "make image of many sub-pixel disks listed in file, one "
+        "\"x y r [amplitude]\" per line",
+        "<output image name> <xsize> <ysize> <file>",
+        "mkdisks lenslets 1024 1024 lenslets.txt",
+        "long make_disks_file(const char *ID_name, long l1, long l2, const "
+        "char *fname)");
+
+    RegisterCLIcommand(
+        "mkspdisksweep",
+        __FILE__,
+        make_subpixdisk_sweep_cli,
+        "make cube of sub-pixel disks, center and radius linearly swept "
+        "from first to last slice, mode 0: 55x55 subgrid, 1: exact area",
+        "<output image name> <xsize> <ysize> <nslice> <x0> <y0> <r0> <x1> "
+        "<y1> <r1> <mode>",
+        "mkspdisksweep pupwander 256 256 10000 128 128 100 130 127 100 1",
+        "long make_subpixdisk_sweep(const char *ID_name, long l1, long l2, "
+        "long nslice, const double *x_center, const double *y_center, "
+        "const double *radius, int mode)");
+
+    RegisterCLIcommand(
+        "mkpupilsweep",
+        __FILE__,
+        make_pupil_sweep_cli,
+        "make cube of anti-aliased pupils, center and outer radius linearly "
+        "swept, inner radius = obstruction x outer radius",
+        "<output image name> <xsize> <ysize> <nslice> <x0> <y0> <r0> <x1> "
+        "<y1> <r1> <obstruction> <nvane> <angle0> <vanewidth>",
+        "mkpupilsweep pupsw 256 256 1000 128 128 100 130 127 100 0.3 4 0.785 "
+        "2.0",
+        "long make_pupil_sweep(const char *ID_name, long l1, long l2, long "
+        "nslice, const double *x_center, const double *y_center, const "
+        "double *radius_out, double obstruction, long nvane, const double "
+        "*vane_angle, const double *vane_width, const double *vane_offset)");
+
+    RegisterCLIcommand("mklincoord",
+                       __FILE__,
+                       make_lincoordinate_cli,
+                       "make linear coordinate",
+                       "<output image name> <xsize> <ysize> <xc> <yc> <angle>",
+                       "mklincoord lim 512 512 256.0 256.0 1.42",
+                       "long make_lincoordinate(const char *IDname, long l1, "
+                       "long l2, double x_center, double "
+                       "y_center, double angle)");
 
     RegisterCLIcommand("mkgridpix",
                        __FILE__,
@@ -531,6 +1054,28 @@ static errno_t init_module_CLI()
                        "long make_rnd(const char *ID_name, long l1, long l2, "
                        "const char *options)");
 
+    RegisterCLIcommand(
+        "mkrndimcb",
+        __FILE__,
+        make_rnd_cbrng_cli,
+        "make random image, parallel counter-based generator",
+        "<name> <xsize> <ysize> "
+        "<distrib (0:uniform 1:gauss 2:trgauss 4-8:see cbrng.h)> <seed>",
+        "mkrndimcb im 512 512 1 42",
+        "imageID make_rnd_cbrng(const char *ID_name, uint32_t l1, uint32_t l2, "
+        "int distrib, uint64_t seed)");
+
+    RegisterCLIcommand(
+        "mkrndimframe",
+        __FILE__,
+        make_rnd_cbrng_frame_cli,
+        "regenerate frame of counter-based random sequence (mkrnd replay)",
+        "<name> <xsize> <ysize> <distrib> <p1> <p2> <seed> <frame>",
+        "mkrndimframe im 512 512 4 20.0 1.0 42 100000",
+        "imageID make_rnd_cbrng_frame(const char *ID_name, uint32_t l1, "
+        "uint32_t l2, int distrib, double p1, double p2, uint64_t seed, "
+        "uint64_t frame)");
+
     RegisterCLIcommand("im2coord",
                        __FILE__,
                        image_gen_im2coord_cli,
@@ -552,7 +1097,32 @@ static errno_t init_module_CLI()
         "*IDout_name, uint32_t xsize, uint32_t ysize, "
         "float radius, float maxsep)");
 
+    RegisterCLIcommand(
+        "imgenbench",
+        __FILE__,
+        image_gen_benchmark_cli,
+        "benchmark image_gen generators over frame sizes and thread "
+        "counts, results to JSON file",
+        "<output file [JSON]> <sizemin> <sizemax> <nthreadmax> <tmin [s]> "
+        "<tmax [s]>",
+        "imgenbench imgenbench.json 256 8192 8 0.5 10.0",
+        "errno_t image_gen_benchmark(const char *fname, uint32_t sizemin, "
+        "uint32_t sizemax, int nthreadmax, double tmin, double tmax)");
+
+    RegisterCLIcommand(
+        "imgenaccuracy",
+        __FILE__,
+        image_gen_accuracy_cli,
+        "check anti-aliased shape modes and random sampler kernels against "
+        "high precision references, fails if an error limit is exceeded",
+        "<output file [JSON]> <size> <nsub>",
+        "imgenaccuracy imgenacc.json 256 256",
+        "errno_t image_gen_accuracy(const char *fname, uint32_t size, long "
+        "nsub)");
+
     CLIADDCMD_image_gen__mkrandomim();
+    CLIADDCMD_image_gen__mkphasescreen();
+    CLIADDCMD_image_gen__mkhexsegphase();
 
     //long make_rnd(const char *ID_name, long l1, long l2, const char *options)
 
@@ -589,190 +1159,464 @@ imageID make_double_star(const char *ID_name,
     return (ID);
 }
 
-/** @brief creates a disk */
-imageID make_disk(const char *ID_name,
-                  uint32_t    l1,
-                  uint32_t    l2,
-                  double      x_center,
-                  double      y_center,
-                  double      radius)
+/* ================================================================== */
+/*            SHAPE OUTPUT : DATATYPE, IN-PLACE REDRAW                */
+/* ================================================================== */
+
+// Shape generators compute float values within the shape bounding box,
+// into an IMAGE_GEN_WORK window of that box. FLOAT output is drawn in
+// the image. Other datatypes draw into a zeroed float array of the box
+// only, converted by the typed store kernels of cbrng.c. In-place
+// redraws reuse one such array across calls.
+//
+// In in-place mode, shape generators draw into an existing image of
+// matching size and datatype instead of creating it. The bounding box
+// written by the previous draw is recorded together with the image
+// counter, so the next draw only clears that box. An image written by
+// anyone else since (counter mismatch), or not recorded, is cleared
+// entirely.
+
+#define IMAGE_GEN_NDIRTY 16
+
+typedef struct
 {
     imageID  ID;
-    uint32_t ii, jj;
-    uint32_t naxes[2];
-    long     x1, x2, y1, y2;
-    long     x1i, x2i, y1i, y2i;
-    double   r2;
-    /*
-      int i,j;
-      double r;
-      double tot;
-      int subgrid=100;
-      double x,y;
-    */
+    void    *array; // detects deleted / re-created image
+    uint64_t cnt0;
+    long     i0, i1, j0, j1;
+} IMAGE_GEN_DIRTY;
+
+// float drawing window of box [i0, i1) x [j0, j1) : pixel (ii, jj) at
+// array[(jj - j0) * stride + ii - i0]
+typedef struct
+{
+    float   *array;
+    uint64_t stride;
+    long     i0, i1, j0, j1;
+    int      alloc; // array allocated by image_gen_open
+} IMAGE_GEN_WORK;
+
+// output of the shape generators without _dt suffix, set from the CLI
+static IMAGE_GEN_OUTPUT image_gen_output = {_DATATYPE_FLOAT, 1.0, 0};
+static IMAGE_GEN_DIRTY  image_gen_dirty[IMAGE_GEN_NDIRTY];
+static int              image_gen_ndirty    = 0;
+static int              image_gen_dirtynext = 0;
+
+// work array of in-place redraws to non-FLOAT images, kept across calls
+static float   *image_gen_scratch     = NULL;
+static uint64_t image_gen_scratchsize = 0;
+
+// row jj of window, pixel ii at [ii - w->i0]
+static inline float *image_gen_row(const IMAGE_GEN_WORK *w, long jj)
+{
+    return w->array + (uint64_t)(jj - w->j0) * w->stride;
+}
 
-    create_2Dimage_ID(ID_name, l1, l2, &ID);
-    naxes[0] = data.image[ID].md[0].size[0];
-    naxes[1] = data.image[ID].md[0].size[1];
+errno_t image_gen_set_datatype(uint8_t datatype, double scale)
+{
+    if(cbrng_datatype_size(datatype) == 0)
+    {
+        PRINT_ERROR("unsupported datatype %d", (int) datatype);
+        return RETURN_FAILURE;
+    }
+    image_gen_output.datatype = datatype;
+    image_gen_output.scale    = scale;
 
-    x1  = (long)(x_center - radius - 2);
-    x2  = (long)(x_center + radius + 2);
-    y1  = (long)(y_center - radius - 2);
-    y2  = (long)(y_center + radius + 2);
-    x1i = (long)(x_center - 0.707106781 * radius + 2);
-    x2i = (long)(x_center + 0.707106781 * radius - 2);
-    y1i = (long)(y_center - 0.707106781 * radius + 2);
-    y2i = (long)(y_center + 0.707106781 * radius - 2);
+    return RETURN_SUCCESS;
+}
+
+uint8_t image_gen_get_datatype()
+{
+    return image_gen_output.datatype;
+}
+
+double image_gen_get_datatype_scale()
+{
+    return image_gen_output.scale;
+}
 
-    if(x1 < 0)
+void image_gen_set_inplace(int mode)
+{
+    image_gen_output.inplace = mode;
+}
+
+int image_gen_get_inplace()
+{
+    return image_gen_output.inplace;
+}
+
+static IMAGE_GEN_DIRTY *image_gen_dirty_find(imageID ID)
+{
+    for(int k = 0; k < image_gen_ndirty; k++)
     {
-        x1 = 0;
+        if((image_gen_dirty[k].ID == ID) &&
+                (image_gen_dirty[k].array == data.image[ID].array.raw))
+        {
+            return &image_gen_dirty[k];
+        }
     }
-    if(x1 > naxes[0])
+    return NULL;
+}
+
+/** @brief Output image of shape generator
+ *
+ * In-place mode with existing image: clears the previous bounding box
+ * and returns the image, -1 if its size or datatype does not match.
+ * Otherwise creates the image with the output datatype. Returns -1 if
+ * the datatype is not supported.
+ *
+ * work : box set by the caller (within l1 x l2), array and stride set
+ * here. The window is zero outside of what the generator writes.
+ */
+static imageID image_gen_open(const char             *ID_name,
+                              uint32_t                l1,
+                              uint32_t                l2,
+                              const IMAGE_GEN_OUTPUT *out,
+                              IMAGE_GEN_WORK         *work)
+{
+    imageID  ID       = -1;
+    uint8_t  datatype = out->datatype;
+    size_t   esize    = cbrng_datatype_size(datatype);
+    uint64_t npix;
+
+    if(esize == 0)
     {
-        x1 = naxes[0];
+        PRINT_ERROR("unsupported datatype %d", (int) datatype);
+        return -1;
     }
 
-    if(x2 < 0)
+    if(out->inplace)
     {
-        x2 = 0;
+        ID = image_ID(ID_name);
     }
-    if(x2 > naxes[0])
+
+    if(ID == -1)
     {
-        x2 = naxes[0];
+        if(datatype == _DATATYPE_FLOAT)
+        {
+            create_2Dimage_ID(ID_name, l1, l2, &ID);
+        }
+        else
+        {
+            uint32_t naxes[2] = {l1, l2};
+            create_image_ID(ID_name,
+                            2,
+                            naxes,
+                            datatype,
+                            data.SHARED_DFT,
+                            data.NBKEYWORD_DFT,
+                            0,
+                            &ID);
+        }
     }
-
-    if(y1 < 0)
+    else
     {
-        y1 = 0;
+        IMAGE_METADATA *md = data.image[ID].md;
+        if((md->datatype != datatype) || (md->naxis != 2) ||
+                (md->size[0] != l1) || (md->size[1] != l2))
+        {
+            PRINT_ERROR("image %s is not %u x %u of datatype %d",
+                        ID_name,
+                        l1,
+                        l2,
+                        (int) datatype);
+            return -1;
+        }
+
+        md->write = 1;
+
+        IMAGE_GEN_DIRTY *dirty = image_gen_dirty_find(ID);
+        char            *raw   = (char *) data.image[ID].array.raw;
+        if((dirty == NULL) || (dirty->cnt0 != md->cnt0))
+        {
+            memset(raw, 0, esize * l1 * l2);
+        }
+        else
+        {
+            for(long jj = dirty->j0; jj < dirty->j1; jj++)
+            {
+                memset(raw + esize * ((uint64_t) jj * l1 + dirty->i0),
+                       0,
+                       esize * (dirty->i1 - dirty->i0));
+            }
+        }
     }
-    if(y1 > naxes[1])
+
+    if((work->i0 >= work->i1) || (work->j0 >= work->j1))
     {
-        y1 = naxes[1];
+        // nothing drawn
+        work->i0 = 0;
+        work->i1 = 0;
+        work->j0 = 0;
+        work->j1 = 0;
     }
+    npix        = (uint64_t)(work->i1 - work->i0) * (work->j1 - work->j0);
+    work->alloc = 0;
 
-    if(y2 > naxes[1])
+    if(datatype == _DATATYPE_FLOAT)
+    {
+        work->array =
+            data.image[ID].array.F + (uint64_t) work->j0 * l1 + work->i0;
+        work->stride = l1;
+    }
+    else if(out->inplace)
+    {
+        if(npix > image_gen_scratchsize)
+        {
+            free(image_gen_scratch);
+            image_gen_scratch = (float *) malloc(sizeof(float) * npix);
+            if(image_gen_scratch == NULL)
+            {
+                PRINT_ERROR("malloc returns NULL pointer");
+                abort();
+            }
+            image_gen_scratchsize = npix;
+        }
+        memset(image_gen_scratch, 0, sizeof(float) * npix);
+        work->array  = image_gen_scratch;
+        work->stride = work->i1 - work->i0;
+    }
+    else
     {
-        y2 = naxes[1];
+        work->array = (float *) calloc((npix > 0) ? npix : 1, sizeof(float));
+        if(work->array == NULL)
+        {
+            PRINT_ERROR("calloc returns NULL pointer");
+            abort();
+        }
+        work->stride = work->i1 - work->i0;
+        work->alloc  = 1;
     }
 
-    if(x1i < 0)
+    return ID;
+}
+
+/** @brief Store window drawn by shape generator
+ *
+ * Converts to output datatype and scale, frees work array, records the
+ * box for in-place redraw. In-place mode: also posts the image update.
+ */
+static void image_gen_close(imageID                 ID,
+                            const IMAGE_GEN_OUTPUT *out,
+                            IMAGE_GEN_WORK         *work)
+{
+    IMAGE_GEN_DIRTY *dirty    = image_gen_dirty_find(ID);
+    uint8_t          datatype = data.image[ID].md[0].datatype;
+    uint32_t         xsize    = data.image[ID].md[0].size[0];
+    long             i0       = work->i0;
+    long             i1       = work->i1;
+    long             j0       = work->j0;
+    long             j1       = work->j1;
+
+    if((datatype != _DATATYPE_FLOAT) || (out->scale != 1.0))
     {
-        x1i = 0;
+        for(long jj = j0; jj < j1; jj++)
+        {
+            cbrng_store_typed(data.image[ID].array.raw,
+                              datatype,
+                              (uint64_t) jj * xsize + i0,
+                              image_gen_row(work, jj),
+                              i1 - i0,
+                              out->scale,
+                              0.0);
+        }
     }
-    if(x1i > naxes[0])
+    if(work->alloc)
     {
-        x1i = naxes[0];
+        free(work->array);
     }
 
-    if(x2i < 0)
+    if(out->inplace)
     {
-        x2i = 0;
+        ImageStreamIO_UpdateIm(&data.image[ID]);
     }
-    if(x2i > naxes[0])
+
+    if(dirty == NULL)
     {
-        x2i = naxes[0];
+        dirty = &image_gen_dirty[image_gen_dirtynext];
+        image_gen_dirtynext = (image_gen_dirtynext + 1) % IMAGE_GEN_NDIRTY;
+        if(image_gen_ndirty < IMAGE_GEN_NDIRTY)
+        {
+            image_gen_ndirty++;
+        }
     }
+    dirty->ID    = ID;
+    dirty->array = data.image[ID].array.raw;
+    dirty->cnt0  = data.image[ID].md[0].cnt0;
+    dirty->i0    = i0;
+    dirty->i1    = i1;
+    dirty->j0    = j0;
+    dirty->j1    = j1;
+}
 
-    if(y1i < 0)
+static long image_gen_clamp(double v, uint32_t n)
+{
+    if(v < 0.0)
+    {
+        return 0;
+    }
+    if(v > n)
     {
-        y1i = 0;
+        return n;
     }
-    if(y1i > naxes[1])
+    return (long) v;
+}
+
+// pixel box [*i0, *i1) x [*j0, *j1) containing [xmin, xmax] x [ymin, ymax]
+static void image_gen_box(double   xmin,
+                          double   xmax,
+                          double   ymin,
+                          double   ymax,
+                          uint32_t xsize,
+                          uint32_t ysize,
+                          long    *i0,
+                          long    *i1,
+                          long    *j0,
+                          long    *j1)
+{
+    *i0 = image_gen_clamp(floor(xmin), xsize);
+    *i1 = image_gen_clamp(ceil(xmax) + 1.0, xsize);
+    *j0 = image_gen_clamp(floor(ymin), ysize);
+    *j1 = image_gen_clamp(ceil(ymax) + 1.0, ysize);
+}
+
+/**
+ * @brief Pixel span [*i0, *i1) of row at distance dy from disk center
+ *
+ * Pixels with |ii - x_center| < sqrt(radius^2 - dy^2), widened by margin
+ * pixels on each side (narrowed if margin < 0), clamped to [0, n). Span
+ * is empty (*i0 == *i1) if the row does not intersect the disk.
+ */
+static void disk_row_span(double   x_center,
+                          double   dy,
+                          double   radius,
+                          long     margin,
+                          uint32_t n,
+                          long    *i0,
+                          long    *i1)
+{
+    double s2 = radius * radius - dy * dy;
+
+    *i0 = 0;
+    *i1 = 0;
+    if((radius <= 0.0) || (s2 <= 0.0))
     {
-        y1i = naxes[1];
+        return;
     }
 
-    if(y2i < 0)
+    double w = sqrt(s2);
+    long   a = (long) ceil(x_center - w) - margin;
+    long   b = (long) floor(x_center + w) + margin + 1;
+
+    if(a < 0)
+    {
+        a = 0;
+    }
+    if(b > (long) n)
     {
-        y2i = 0;
+        b = n;
     }
-    if(y2i > naxes[1])
+    if(a < b)
     {
-        y2i = naxes[1];
+        *i0 = a;
+        *i1 = b;
     }
+}
+
+/**
+ * @brief creates a disk
+ *
+ * Pixels closer than radius to the center are set to 1. Each row is
+ * rasterized as a span: the run safely inside the circle is filled, only
+ * the pixels near the two span ends are tested.
+ */
+imageID make_disk_dt(const char             *ID_name,
+                     uint32_t                l1,
+                     uint32_t                l2,
+                     double                  x_center,
+                     double                  y_center,
+                     double                  radius,
+                     const IMAGE_GEN_OUTPUT *out)
+{
+    imageID        ID;
+    IMAGE_GEN_WORK work;
+    double         r2;
 
     r2 = radius * radius;
 
-    for(ii = x1i; ii < x2i; ii++)
-        for(jj = y1i; jj < y2i; jj++)
+    image_gen_box(x_center - radius - 1.0,
+                  x_center + radius + 1.0,
+                  y_center - radius - 1.0,
+                  y_center + radius + 1.0,
+                  l1,
+                  l2,
+                  &work.i0,
+                  &work.i1,
+                  &work.j0,
+                  &work.j1);
+
+    ID = image_gen_open(ID_name, l1, l2, out, &work);
+    if(ID == -1)
+    {
+        return -1;
+    }
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for(long jj = work.j0; jj < work.j1; jj++)
+    {
+        double dy = jj - y_center;
+        long   o0, o1, n0, n1;
+
+        disk_row_span(x_center, dy, radius, 1, l1, &o0, &o1);
+        disk_row_span(x_center, dy, radius, -1, l1, &n0, &n1);
+        if(n0 >= n1)
         {
-            data.image[ID].array.F[jj * naxes[0] + ii] = 1;
+            n0 = o1;
+            n1 = o1;
         }
 
-    for(ii = x1; ii < x1i; ii++)
-        for(jj = y1; jj < y2; jj++)
-            if(((ii - x_center) * (ii - x_center) +
-                    (jj - y_center) * (jj - y_center)) < r2)
-            {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 1;
-            }
-
-    for(ii = x2i; ii < x2; ii++)
-        for(jj = y1; jj < y2; jj++)
-            if(((ii - x_center) * (ii - x_center) +
-                    (jj - y_center) * (jj - y_center)) < r2)
+        float *row = image_gen_row(&work, jj) - work.i0;
+        for(long ii = n0; ii < n1; ii++)
+        {
+            row[ii] = 1;
+        }
+        for(long ii = o0; ii < o1; ii++)
+        {
+            if(ii == n0)
             {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 1;
+                ii = n1 - 1;
+                continue;
             }
-
-    for(ii = x1i; ii < x2i; ii++)
-        for(jj = y1; jj < y1i; jj++)
-            if(((ii - x_center) * (ii - x_center) +
-                    (jj - y_center) * (jj - y_center)) < r2)
+            if(((ii - x_center) * (ii - x_center) + dy * dy) < r2)
             {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 1;
+                row[ii] = 1;
             }
+        }
+    }
 
-    for(ii = x1i; ii < x2i; ii++)
-        for(jj = y2i; jj < y2; jj++)
-            if(((ii - x_center) * (ii - x_center) +
-                    (jj - y_center) * (jj - y_center)) < r2)
-            {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 1;
-            }
+    image_gen_close(ID, out, &work);
 
-    /*
-    for (jj = x1; jj < x2; jj++)
-      for (ii = y1; ii < y2; ii++)
-        {
-    if (((ii-x_center)*(ii-x_center)+(jj-y_center)*(jj-y_center))<r2)
-      data.image[ID].array.F[jj*naxes[0]+ii] = 1;
-        }
-    */
-    /*
-      for (jj = 0; jj < naxes[1]; jj++)
-      for (ii = 0; ii < naxes[0]; ii++)
-      {
-      r = sqrt(((ii-x_center)*(ii-x_center)+(jj-y_center)*(jj-y_center)));
-
-      if (r<radius)
-      data.image[ID].array.F[jj*naxes[0]+ii] = 1.0;
-      else
-      data.image[ID].array.F[jj*naxes[0]+ii] = 0.0;
-
-      if(((radius-r)*(radius-r))<1.5)
-      {
-      tot = 0;
-      for (j = 0; j < subgrid; j++)
-      for (i = 0; i < subgrid; i++)
-      {
-      x = 1.0*ii-0.5+0.5/subgrid+1.0*i/subgrid;
-      y = 1.0*jj-0.5+0.5/subgrid+1.0*j/subgrid;
-      r = sqrt((x-1.0*x_center)*(x-1.0*x_center)+(y-1.0*y_center)*(y-1.0*y_center));
-      if (r < radius)
-      tot = tot + 1.0;
-      else
-      tot = tot + 0.0;
-      }
-      tot = tot/subgrid/subgrid;
-      data.image[ID].array.F[jj*naxes[0]+ii] = tot;
-      }
-      }
-    */
     return (ID);
 }
 
+imageID make_disk(const char *ID_name,
+                  uint32_t    l1,
+                  uint32_t    l2,
+                  double      x_center,
+                  double      y_center,
+                  double      radius)
+{
+    return make_disk_dt(ID_name,
+                        l1,
+                        l2,
+                        x_center,
+                        y_center,
+                        radius,
+                        &image_gen_output);
+}
+
 imageID make_subpixdisk(const char *ID_name,
                         uint32_t    l1,
                         uint32_t    l2,
@@ -780,565 +1624,541 @@ imageID make_subpixdisk(const char *ID_name,
                         double      y_center,
                         double      radius)
 {
-    imageID  ID;
-    uint32_t ii, jj;
-    uint32_t naxes[2];
-    int      i, j;
-    double   r;
-    double   tot;
-    int      subgrid = 55;
-    double   grid[55]; // same number of points as subgrid
-    double   x, y;
-    long     x1, x2, y1, y2;
-    long     x1i, x2i, y1i, y2i;
-    double   r2, r2ref;
-    double   xdiff, ydiff;
-    double   subgrid2;
-
-    create_2Dimage_ID(ID_name, l1, l2, &ID);
-    naxes[0] = data.image[ID].md[0].size[0];
-    naxes[1] = data.image[ID].md[0].size[1];
+    return make_subpixdisk_mode(ID_name,
+                                l1,
+                                l2,
+                                x_center,
+                                y_center,
+                                radius,
+                                SUBPIXDISK_MODE_GRID);
+}
 
-    x1  = (long)(x_center - radius - 2);
-    x2  = (long)(x_center + radius + 2);
-    y1  = (long)(y_center - radius - 2);
-    y2  = (long)(y_center + radius + 2);
-    x1i = (long)(x_center - 0.707106781 * radius + 2);
-    x2i = (long)(x_center + 0.707106781 * radius - 2);
-    y1i = (long)(y_center - 0.707106781 * radius + 2);
-    y2i = (long)(y_center + 0.707106781 * radius - 2);
+/**
+ * @brief Pixel value of subgrid mode
+ *
+ * Pixels within 1.5 pixel of the edge are sampled on a subgrid x subgrid
+ * grid, others are 1 inside the disk, 0 outside.
+ */
+static float subpixdisk_grid_pixel(double        xdiff,
+                                   double        ydiff,
+                                   double        r2ref,
+                                   const double *grid,
+                                   int           subgrid)
+{
+    double r2 = xdiff * xdiff + ydiff * ydiff;
 
-    if(x1 < 0)
-    {
-        x1 = 0;
-    }
-    if(x1 > naxes[0])
+    if(fabs(sqrt(r2) - sqrt(r2ref)) < 1.5)
     {
-        x1 = naxes[0];
-    }
-    if(x2 < 0)
-    {
-        x2 = 0;
-    }
-    if(x2 > naxes[0])
-    {
-        x2 = naxes[0];
+        double tot = 0;
+        for(int j = 0; j < subgrid; j++)
+            for(int i = 0; i < subgrid; i++)
+            {
+                double x = xdiff + grid[i];
+                double y = ydiff + grid[j];
+                if(x * x + y * y < r2ref)
+                {
+                    tot += 1.0;
+                }
+            }
+        return (float)(tot / (subgrid * subgrid));
     }
+    return (r2 < r2ref) ? 1.0f : 0.0f;
+}
 
-    if(y1 < 0)
-    {
-        y1 = 0;
-    }
-    if(y1 > naxes[1])
-    {
-        y1 = naxes[1];
-    }
-    if(y2 < 0)
-    {
-        y2 = 0;
-    }
-    if(y2 > naxes[1])
-    {
-        y2 = naxes[1];
-    }
+// half-width of sub-pixel disk edge band
+// exact : pixel half-diagonal, grid : 1.5 pixel sampling band
+static double subpixdisk_band(int mode)
+{
+    return (mode == SUBPIXDISK_MODE_EXACT) ? 0.70710679 : 1.5;
+}
 
-    if(x1i < 0)
-    {
-        x1i = 0;
-    }
-    if(x1i > naxes[0] - 1)
-    {
-        x1i = naxes[0] - 1;
-    }
-    if(x2i < 0)
-    {
-        x2i = 0;
-    }
-    if(x2i > naxes[0] - 1)
-    {
-        x2i = naxes[0] - 1;
-    }
+/** @brief Box [*i0, *i1) x [*j0, *j1) written by subpixdisk_draw
+ */
+static void subpixdisk_box(double   x_center,
+                           double   y_center,
+                           double   radius,
+                           int      mode,
+                           uint32_t xsize,
+                           uint32_t ysize,
+                           long    *i0,
+                           long    *i1,
+                           long    *j0,
+                           long    *j1)
+{
+    double band = subpixdisk_band(mode);
+
+    image_gen_box(x_center - radius - band - 1.0,
+                  x_center + radius + band + 1.0,
+                  y_center - radius - band - 1.0,
+                  y_center + radius + band + 1.0,
+                  xsize,
+                  ysize,
+                  i0,
+                  i1,
+                  j0,
+                  j1);
+}
 
-    if(y1i < 0)
-    {
-        y1i = 0;
-    }
-    if(y1i > naxes[1] - 1)
-    {
-        y1i = naxes[1] - 1;
-    }
-    if(y2i < 0)
-    {
-        y2i = 0;
-    }
-    if(y2i > naxes[1] - 1)
+/** @brief Draw sub-pixel disk into zeroed window of image width xsize
+ *
+ * The window box must be set by subpixdisk_box.
+ * rowpar : parallelize over rows. If run is not NULL, the run of pixels
+ * fully inside the disk on row jj is not written but returned as
+ * [run[2 jj], run[2 jj + 1]), empty if both are equal.
+ */
+static void subpixdisk_draw(const IMAGE_GEN_WORK *work,
+                            uint32_t              xsize,
+                            double                x_center,
+                            double                y_center,
+                            double                radius,
+                            int                   mode,
+                            int                   rowpar,
+                            long                 *run)
+{
+    int    subgrid = 55;
+    double grid[55]; // same number of points as subgrid
+    double r2ref;
+    double band;
+
+    for(int i = 0; i < subgrid; i++)
     {
-        y2i = naxes[1] - 1;
+        grid[i] = (0.5 - 0.5 / subgrid - 1.0 * i / subgrid);
     }
+    r2ref = radius * radius;
+    band  = subpixdisk_band(mode);
 
-    r2ref    = radius * radius;
-    subgrid2 = subgrid * subgrid;
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for schedule(dynamic, 16) if(rowpar)
+#else
+    (void) rowpar;
+#endif
+    for(long jj = work->j0; jj < work->j1; jj++)
+    {
+        double dy = jj - y_center;
+        long   o0, o1, n0, n1;
 
-    for(ii = x1i; ii < x2i; ii++)
-        for(jj = y1i; jj < y2i; jj++)
+        disk_row_span(x_center, dy, radius + band, 1, xsize, &o0, &o1);
+        disk_row_span(x_center, dy, radius - band, -1, xsize, &n0, &n1);
+        if(n0 >= n1)
         {
-            data.image[ID].array.F[jj * naxes[0] + ii] = 1;
+            n0 = o1;
+            n1 = o1;
         }
 
-    for(i = 0; i < subgrid; i++)
-    {
-        grid[i] = (0.5 - 0.5 / subgrid - 1.0 * i / subgrid);
-    }
-
-    for(ii = x1; ii < x1i; ii++)
-        for(jj = y1; jj < y2; jj++)
+        float *row = image_gen_row(work, jj) - work->i0;
+        if(run != NULL)
         {
-            xdiff = x_center - ii;
-            ydiff = y_center - jj;
-            r2    = xdiff * xdiff + ydiff * ydiff;
-            if(r2 < r2ref)
-            {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 1.0;
-            }
-            if(fabs(sqrt(r2) - sqrt(r2ref)) < 1.5)
-            {
-                tot = 0;
-                for(j = 0; j < subgrid; j++)
-                    for(i = 0; i < subgrid; i++)
-                    {
-                        x = xdiff + grid[i];
-                        y = ydiff + grid[j];
-                        r = x * x + y * y;
-                        if(r < r2ref)
-                        {
-                            tot += 1.0;
-                        }
-                    }
-                tot                                        = tot / subgrid2;
-                data.image[ID].array.F[jj * naxes[0] + ii] = tot;
-            }
+            run[2 * jj]     = n0;
+            run[2 * jj + 1] = n1;
         }
-
-    for(ii = x2i; ii < x2; ii++)
-        for(jj = y1; jj < y2; jj++)
+        else
         {
-            xdiff = x_center - ii;
-            ydiff = y_center - jj;
-            r2    = xdiff * xdiff + ydiff * ydiff;
-            if(r2 < r2ref)
-            {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 1.0;
-            }
-            if(fabs(sqrt(r2) - sqrt(r2ref)) < 1.5)
+            for(long ii = n0; ii < n1; ii++)
             {
-                tot = 0;
-                for(j = 0; j < subgrid; j++)
-                    for(i = 0; i < subgrid; i++)
-                    {
-                        x = xdiff + grid[i];
-                        y = ydiff + grid[j];
-                        r = x * x + y * y;
-                        if(r < r2ref)
-                        {
-                            tot += 1.0;
-                        }
-                    }
-                tot                                        = tot / subgrid2;
-                data.image[ID].array.F[jj * naxes[0] + ii] = tot;
+                row[ii] = 1;
             }
         }
-
-    for(ii = x1i; ii < x2i; ii++)
-        for(jj = y1; jj < y1i; jj++)
+        for(long ii = o0; ii < o1; ii++)
         {
-            xdiff = x_center - ii;
-            ydiff = y_center - jj;
-            r2    = xdiff * xdiff + ydiff * ydiff;
-            if(r2 < r2ref)
-            {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 1.0;
-            }
-            if(fabs(sqrt(r2) - sqrt(r2ref)) < 1.5)
+            if(ii == n0)
             {
-                tot = 0;
-                for(j = 0; j < subgrid; j++)
-                    for(i = 0; i < subgrid; i++)
-                    {
-                        x = xdiff + grid[i];
-                        y = ydiff + grid[j];
-                        r = x * x + y * y;
-                        if(r < r2ref)
-                        {
-                            tot += 1.0;
-                        }
-                    }
-                tot                                        = tot / subgrid2;
-                data.image[ID].array.F[jj * naxes[0] + ii] = tot;
+                ii = n1 - 1;
+                continue;
             }
-        }
-
-    for(ii = x1i; ii < x2i; ii++)
-        for(jj = y2i; jj < y2; jj++)
-        {
-            xdiff = x_center - ii;
-            ydiff = y_center - jj;
-            r2    = xdiff * xdiff + ydiff * ydiff;
-            if(r2 < r2ref)
+            if(mode == SUBPIXDISK_MODE_EXACT)
             {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 1.0;
+                row[ii] = (float) pixcoverage_disk(ii - x_center, dy, radius);
             }
-            if(fabs(sqrt(r2) - sqrt(r2ref)) < 1.5)
+            else
             {
-                tot = 0;
-                for(j = 0; j < subgrid; j++)
-                    for(i = 0; i < subgrid; i++)
-                    {
-                        x = xdiff + grid[i];
-                        y = ydiff + grid[j];
-                        r = x * x + y * y;
-                        if(r < r2ref)
-                        {
-                            tot += 1.0;
-                        }
-                    }
-                tot                                        = tot / subgrid2;
-                data.image[ID].array.F[jj * naxes[0] + ii] = tot;
+                row[ii] = subpixdisk_grid_pixel(x_center - ii,
+                                                y_center - jj,
+                                                r2ref,
+                                                grid,
+                                                subgrid);
             }
         }
-
-    return (ID);
+    }
 }
 
-// creates a shape with contour described by sum of sine waves
-//
-// r = radius + SUM[ ra[i] * cos( ka[i]*PA/2.0/PI + pa[i]) ]
-
-imageID make_subpixdisk_perturb(const char *ID_name,
-                                uint32_t    l1,
-                                uint32_t    l2,
-                                double      x_center,
-                                double      y_center,
-                                double      radius,
-                                long        n,
-                                double     *ra,
-                                double     *ka,
-                                double     *pa)
+/**
+ * @brief creates a disk with sub-pixel coverage
+ *
+ * Pixel (ii, jj) covers [ii-0.5, ii+0.5] x [jj-0.5, jj+0.5]. Rows are
+ * rasterized as spans: the run of pixels entirely inside the disk is
+ * filled with 1, coverage is only evaluated in the edge band at both
+ * ends of the span.
+ */
+imageID make_subpixdisk_mode_dt(const char             *ID_name,
+                                uint32_t                l1,
+                                uint32_t                l2,
+                                double                  x_center,
+                                double                  y_center,
+                                double                  radius,
+                                int                     mode,
+                                const IMAGE_GEN_OUTPUT *out)
 {
-    imageID  ID;
-    uint32_t ii, jj;
-    uint32_t naxes[2];
-    int      i, j;
-    double   r;
-    double   tot;
-    int      subgrid = 55;
-    double   grid[55]; // same number of points as subgrid
-    double   x, y;
-    long     x1, x2, y1, y2;
-    long     x1i, x2i, y1i, y2i;
-    double   r2, r2ref;
-    double   xdiff, ydiff;
-    double   subgrid2;
-    double   PA;
-    double   v0;
-    long     k;
+    imageID        ID;
+    IMAGE_GEN_WORK work;
 
-    double radius1, radius2;
+    subpixdisk_box(x_center,
+                   y_center,
+                   radius,
+                   mode,
+                   l1,
+                   l2,
+                   &work.i0,
+                   &work.i1,
+                   &work.j0,
+                   &work.j1);
 
-    radius1 = radius;
-    radius2 = radius;
-    for(k = 0; k < n; k++)
-    {
-        radius1 += radius * fabs(ra[k]);
-    }
-    for(k = 0; k < n; k++)
+    ID = image_gen_open(ID_name, l1, l2, out, &work);
+    if(ID == -1)
     {
-        radius2 -= radius * fabs(ra[k]);
-    }
-    if(radius2 < 0.0)
-    {
-        radius2 = 0.0;
+        return -1;
     }
 
-    create_2Dimage_ID(ID_name, l1, l2, &ID);
-    naxes[0] = data.image[ID].md[0].size[0];
-    naxes[1] = data.image[ID].md[0].size[1];
+    subpixdisk_draw(&work, l1, x_center, y_center, radius, mode, 1, NULL);
 
-    x1  = (long)(x_center - radius1 - 2);
-    x2  = (long)(x_center + radius1 + 2);
-    y1  = (long)(y_center - radius1 - 2);
-    y2  = (long)(y_center + radius1 + 2);
-    x1i = (long)(x_center - 0.707106781 * radius2 + 2);
-    x2i = (long)(x_center + 0.707106781 * radius2 - 2);
-    y1i = (long)(y_center - 0.707106781 * radius2 + 2);
-    y2i = (long)(y_center + 0.707106781 * radius2 - 2);
+    image_gen_close(ID, out, &work);
 
-    if(x1 < 0)
-    {
-        x1 = 0;
-    }
-    if(x1 > naxes[0])
-    {
-        x1 = naxes[0];
-    }
-    if(x2 < 0)
-    {
-        x2 = 0;
-    }
-    if(x2 > naxes[0])
-    {
-        x2 = naxes[0];
-    }
+    return (ID);
+}
 
-    if(y1 < 0)
-    {
-        y1 = 0;
-    }
-    if(y1 > naxes[1])
-    {
-        y1 = naxes[1];
-    }
-    if(y2 < 0)
-    {
-        y2 = 0;
-    }
-    if(y2 > naxes[1])
+imageID make_subpixdisk_mode(const char *ID_name,
+                             uint32_t    l1,
+                             uint32_t    l2,
+                             double      x_center,
+                             double      y_center,
+                             double      radius,
+                             int         mode)
+{
+    return make_subpixdisk_mode_dt(ID_name,
+                                   l1,
+                                   l2,
+                                   x_center,
+                                   y_center,
+                                   radius,
+                                   mode,
+                                   &image_gen_output);
+}
+
+/**
+ * @brief Contour radius lookup table of make_subpixdisk_perturb
+ *
+ * The angle is split in 8 octants, each tabulated against
+ * q = min(|x|, |y|) / max(|x|, |y|) in [0, 1], so that evaluation only
+ * takes a division and a linear interpolation, without atan2 or cos.
+ */
+typedef struct
+{
+    long    nq;     // intervals per octant
+    double *r;      // 8 x (nq + 1) contour radii
+    double  rmin;   // contour radius range, including errmax
+    double  rmax;
+    double  errmax; // interpolation error bound [pixel]
+} CONTOUR_LUT;
+
+// table tolerance [pixel], well below 55x55 subgrid resolution
+#define CONTOUR_LUT_TOL 1.0e-4
+
+// octant o = 2 * quadrant + (|y| > |x|), angle as in atan2(y, x)
+static double contour_lut_angle(int o, double q)
+{
+    double phi = (o & 1) ? 0.5 * M_PI - atan(q) : atan(q);
+
+    switch(o >> 1)
     {
-        y2 = naxes[1];
+        case 0:
+            return phi;
+        case 1:
+            return M_PI - phi;
+        case 2:
+            return phi - M_PI;
+        default:
+            return -phi;
     }
+}
 
-    if(x1i < 0)
+/**
+ * Linear interpolation error is below h^2/8 max|r''(q)|, with h = 1/nq.
+ * With theta(q) = atan(q), |theta'| <= 1 and |theta''| <= 0.65, so
+ * |r''(q)| <= M2 + 0.65 M1, where M1 = radius sum |ra ka| and
+ * M2 = radius sum |ra| ka^2.
+ */
+static void contour_lut_init(CONTOUR_LUT *lut,
+                             double       radius,
+                             long         n,
+                             const double *ra,
+                             const double *ka,
+                             const double *pa)
+{
+    double m1 = 0.0;
+    double m2 = 0.0;
+    for(long k = 0; k < n; k++)
     {
-        x1i = 0;
+        m1 += fabs(radius * ra[k] * ka[k]);
+        m2 += fabs(radius * ra[k]) * ka[k] * ka[k];
     }
-    if(x1i > naxes[0] - 1)
+    double d2 = m2 + 0.65 * m1;
+
+    lut->nq = (long) ceil(sqrt(d2 / (8.0 * CONTOUR_LUT_TOL)));
+    if(lut->nq < 64)
     {
-        x1i = naxes[0] - 1;
+        lut->nq = 64;
     }
-    if(x2i < 0)
+    if(lut->nq > (1L << 20))
     {
-        x2i = 0;
+        lut->nq = 1L << 20;
     }
-    if(x2i > naxes[0] - 1)
+    lut->errmax = d2 / (8.0 * lut->nq * lut->nq);
+
+    lut->r = (double *) malloc(sizeof(double) * 8 * (lut->nq + 1));
+    if(lut->r == NULL)
     {
-        x2i = naxes[0] - 1;
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
     }
 
-    if(y1i < 0)
+    double rmin = fabs(radius);
+    double rmax = fabs(radius);
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for reduction(min:rmin) reduction(max:rmax)
+#endif
+    for(long i = 0; i < 8 * (lut->nq + 1); i++)
     {
-        y1i = 0;
+        double PA = contour_lut_angle((int)(i / (lut->nq + 1)),
+                                      1.0 * (i % (lut->nq + 1)) / lut->nq);
+        double v0 = radius;
+        for(long k = 0; k < n; k++)
+        {
+            v0 += radius * ra[k] * cos(ka[k] * PA + pa[k]);
+        }
+        lut->r[i] = v0;
+        rmin      = fmin(rmin, fabs(v0));
+        rmax      = fmax(rmax, fabs(v0));
     }
-    if(y1i > naxes[1] - 1)
+    lut->rmin = rmin - lut->errmax;
+    lut->rmax = rmax + lut->errmax;
+}
+
+// contour radius in direction atan2(y, x)
+static inline double contour_lut_eval(const CONTOUR_LUT *lut,
+                                      double             x,
+                                      double             y)
+{
+    double ax = fabs(x);
+    double ay = fabs(y);
+    int    o  = (x < 0.0) ? ((y < 0.0) ? 4 : 2) : ((y < 0.0) ? 6 : 0);
+    double q  = 0.0;
+
+    if(ay > ax)
     {
-        y1i = naxes[1] - 1;
+        o += 1;
+        q = ax / ay;
     }
-    if(y2i < 0)
+    else if(ax > 0.0)
     {
-        y2i = 0;
+        q = ay / ax;
     }
-    if(y2i > naxes[1] - 1)
+
+    double t = q * lut->nq;
+    long   i = (long) t;
+    if(i >= lut->nq)
     {
-        y2i = naxes[1] - 1;
+        i = lut->nq - 1;
     }
+    const double *r = lut->r + o * (lut->nq + 1) + i;
 
-    r2ref    = radius * radius;
-    subgrid2 = subgrid * subgrid;
+    return r[0] + (t - i) * (r[1] - r[0]);
+}
 
-    for(ii = x1i; ii < x2i; ii++)
-        for(jj = y1i; jj < y2i; jj++)
-        {
-            data.image[ID].array.F[jj * naxes[0] + ii] = 1;
-        }
+// creates a shape with contour described by sum of sine waves
+//
+// r = radius + SUM[ radius * ra[i] * cos( ka[i]*PA + pa[i]) ]
+//
+// PA = atan2(y_center - y, x_center - x). The contour is tabulated once
+// (error bound CONTOUR_LUT_TOL pixel). Rows are rasterized as spans
+// between the true minimum and maximum contour radius; pixels within 1.5
+// pixel of the contour are sampled on a 55x55 subgrid.
+
+imageID make_subpixdisk_perturb_dt(const char             *ID_name,
+                                   uint32_t                l1,
+                                   uint32_t                l2,
+                                   double                  x_center,
+                                   double                  y_center,
+                                   double                  radius,
+                                   long                    n,
+                                   double                 *ra,
+                                   double                 *ka,
+                                   double                 *pa,
+                                   const IMAGE_GEN_OUTPUT *out)
+{
+    imageID        ID;
+    IMAGE_GEN_WORK work;
+    int            subgrid = 55;
+    double         grid[55]; // same number of points as subgrid
+    double         subgrid2;
+    CONTOUR_LUT    lut;
 
-    for(i = 0; i < subgrid; i++)
+    for(int i = 0; i < subgrid; i++)
     {
         grid[i] = (0.5 - 0.5 / subgrid - 1.0 * i / subgrid);
     }
+    subgrid2 = subgrid * subgrid;
 
-    for(ii = x1; ii < x1i; ii++)
-        for(jj = y1; jj < y2; jj++)
-        {
-            xdiff = x_center - ii;
-            ydiff = y_center - jj;
-            PA    = atan2(ydiff, xdiff);
-            r2    = xdiff * xdiff + ydiff * ydiff;
+    contour_lut_init(&lut, radius, n, ra, ka, pa);
 
-            v0 = radius;
-            for(k = 0; k < n; k++)
-            {
-                v0 += radius * ra[k] * cos(ka[k] * PA + pa[k]);
-            }
-            r2ref = v0 * v0;
+    image_gen_box(x_center - lut.rmax - 2.5,
+                  x_center + lut.rmax + 2.5,
+                  y_center - lut.rmax - 2.5,
+                  y_center + lut.rmax + 2.5,
+                  l1,
+                  l2,
+                  &work.i0,
+                  &work.i1,
+                  &work.j0,
+                  &work.j1);
 
-            if(r2 < r2ref)
-            {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 1.0;
-            }
-            if(fabs(sqrt(r2) - sqrt(r2ref)) < 1.5)
-            {
-                tot = 0;
-                for(j = 0; j < subgrid; j++)
-                    for(i = 0; i < subgrid; i++)
-                    {
-                        x  = xdiff + grid[i];
-                        y  = ydiff + grid[j];
-                        PA = atan2(y, x);
-                        r  = x * x + y * y;
+    ID = image_gen_open(ID_name, l1, l2, out, &work);
+    if(ID == -1)
+    {
+        free(lut.r);
+        return -1;
+    }
 
-                        v0 = radius;
-                        for(k = 0; k < n; k++)
-                        {
-                            v0 += radius * ra[k] * cos(ka[k] * PA + pa[k]);
-                        }
-                        r2ref = v0 * v0;
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for schedule(dynamic, 4)
+#endif
+    for(long jj = work.j0; jj < work.j1; jj++)
+    {
+        double ydiff = y_center - jj;
+        long   o0, o1, n0, n1;
 
-                        if(r < r2ref)
-                        {
-                            tot += 1.0;
-                        }
-                    }
-                tot                                        = tot / subgrid2;
-                data.image[ID].array.F[jj * naxes[0] + ii] = tot;
-            }
+        disk_row_span(x_center, ydiff, lut.rmax + 1.5, 1, l1, &o0, &o1);
+        disk_row_span(x_center, ydiff, lut.rmin - 1.5, -1, l1, &n0, &n1);
+        if(n0 >= n1)
+        {
+            n0 = o1;
+            n1 = o1;
         }
 
-    for(ii = x2i; ii < x2; ii++)
-        for(jj = y1; jj < y2; jj++)
+        float *row = image_gen_row(&work, jj) - work.i0;
+        for(long ii = n0; ii < n1; ii++)
         {
-            xdiff = x_center - ii;
-            ydiff = y_center - jj;
-            PA    = atan2(ydiff, xdiff);
-            r2    = xdiff * xdiff + ydiff * ydiff;
-
-            v0 = radius;
-            for(k = 0; k < n; k++)
-            {
-                v0 += radius * ra[k] * cos(ka[k] * PA + pa[k]);
-            }
-            r2ref = v0 * v0;
-
-            if(r2 < r2ref)
-            {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 1.0;
-            }
-            if(fabs(sqrt(r2) - sqrt(r2ref)) < 1.5)
-            {
-                tot = 0;
-                for(j = 0; j < subgrid; j++)
-                    for(i = 0; i < subgrid; i++)
-                    {
-                        x  = xdiff + grid[i];
-                        y  = ydiff + grid[j];
-                        r  = x * x + y * y;
-                        PA = atan2(y, x);
-                        v0 = radius;
-                        for(k = 0; k < n; k++)
-                        {
-                            v0 += radius * ra[k] * cos(ka[k] * PA + pa[k]);
-                        }
-                        r2ref = v0 * v0;
-
-                        if(r < r2ref)
-                        {
-                            tot += 1.0;
-                        }
-                    }
-                tot                                        = tot / subgrid2;
-                data.image[ID].array.F[jj * naxes[0] + ii] = tot;
-            }
+            row[ii] = 1;
         }
-
-    for(ii = x1i; ii < x2i; ii++)
-        for(jj = y1; jj < y1i; jj++)
+        for(long ii = o0; ii < o1; ii++)
         {
-            xdiff = x_center - ii;
-            ydiff = y_center - jj;
-            PA    = atan2(ydiff, xdiff);
-            r2    = xdiff * xdiff + ydiff * ydiff;
-            v0    = radius;
-            for(k = 0; k < n; k++)
+            if(ii == n0)
             {
-                v0 += radius * ra[k] * cos(ka[k] * PA + pa[k]);
+                ii = n1 - 1;
+                continue;
             }
-            r2ref = v0 * v0;
 
-            if(r2 < r2ref)
-            {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 1.0;
-            }
-            if(fabs(sqrt(r2) - sqrt(r2ref)) < 1.5)
+            double xdiff = x_center - ii;
+            double r2    = xdiff * xdiff + ydiff * ydiff;
+            double v0    = contour_lut_eval(&lut, xdiff, ydiff);
+
+            if(fabs(sqrt(r2) - fabs(v0)) < 1.5)
             {
-                tot = 0;
-                for(j = 0; j < subgrid; j++)
-                    for(i = 0; i < subgrid; i++)
+                double tot = 0;
+                for(int j = 0; j < subgrid; j++)
+                    for(int i = 0; i < subgrid; i++)
                     {
-                        x  = xdiff + grid[i];
-                        y  = ydiff + grid[j];
-                        PA = atan2(y, x);
-                        r  = x * x + y * y;
-                        v0 = radius;
-                        for(k = 0; k < n; k++)
-                        {
-                            v0 += radius * ra[k] * cos(ka[k] * PA + pa[k]);
-                        }
-                        r2ref = v0 * v0;
-                        if(r < r2ref)
+                        double x = xdiff + grid[i];
+                        double y = ydiff + grid[j];
+                        double v = contour_lut_eval(&lut, x, y);
+                        if(x * x + y * y < v * v)
                         {
                             tot += 1.0;
                         }
                     }
-                tot                                        = tot / subgrid2;
-                data.image[ID].array.F[jj * naxes[0] + ii] = tot;
+                row[ii] = (float)(tot / subgrid2);
             }
-        }
-
-    for(ii = x1i; ii < x2i; ii++)
-        for(jj = y2i; jj < y2; jj++)
-        {
-            xdiff = x_center - ii;
-            ydiff = y_center - jj;
-            PA    = atan2(ydiff, xdiff);
-            r2    = xdiff * xdiff + ydiff * ydiff;
-            v0    = radius;
-            for(k = 0; k < n; k++)
+            else if(r2 < v0 * v0)
             {
-                v0 += radius * ra[k] * cos(ka[k] * PA + pa[k]);
+                row[ii] = 1.0;
             }
-            r2ref = v0 * v0;
+        }
+    }
 
-            if(r2 < r2ref)
+    free(lut.r);
+
+    image_gen_close(ID, out, &work);
+
+    return (ID);
+}
+
+imageID make_subpixdisk_perturb(const char *ID_name,
+                                uint32_t    l1,
+                                uint32_t    l2,
+                                double      x_center,
+                                double      y_center,
+                                double      radius,
+                                long        n,
+                                double     *ra,
+                                double     *ka,
+                                double     *pa)
+{
+    return make_subpixdisk_perturb_dt(ID_name,
+                                      l1,
+                                      l2,
+                                      x_center,
+                                      y_center,
+                                      radius,
+                                      n,
+                                      ra,
+                                      ka,
+                                      pa,
+                                      &image_gen_output);
+}
+
+/* creates a square */
+imageID make_square_dt(const char             *ID_name,
+                       uint32_t                l1,
+                       uint32_t                l2,
+                       double                  x_center,
+                       double                  y_center,
+                       double                  radius,
+                       const IMAGE_GEN_OUTPUT *out)
+{
+    imageID        ID;
+    IMAGE_GEN_WORK work;
+
+
+    image_gen_box(x_center - radius,
+                  x_center + radius,
+                  y_center - radius,
+                  y_center + radius,
+                  l1,
+                  l2,
+                  &work.i0,
+                  &work.i1,
+                  &work.j0,
+                  &work.j1);
+
+    ID = image_gen_open(ID_name, l1, l2, out, &work);
+    if(ID == -1)
+    {
+        return -1;
+    }
+
+    for(long jj = work.j0; jj < work.j1; jj++)
+        for(long ii = work.i0; ii < work.i1; ii++)
+        {
+            if((((ii - x_center) * (ii - x_center)) < (radius * radius)) &&
+                    (((jj - y_center) * (jj - y_center)) < (radius * radius)))
             {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 1.0;
-            }
-            if(fabs(sqrt(r2) - sqrt(r2ref)) < 1.5)
-            {
-                tot = 0;
-                for(j = 0; j < subgrid; j++)
-                    for(i = 0; i < subgrid; i++)
-                    {
-                        x  = xdiff + grid[i];
-                        y  = ydiff + grid[j];
-                        PA = atan2(y, x);
-                        r  = x * x + y * y;
-                        v0 = radius;
-                        for(k = 0; k < n; k++)
-                        {
-                            v0 += radius * ra[k] * cos(ka[k] * PA + pa[k]);
-                        }
-                        r2ref = v0 * v0;
-                        if(r < r2ref)
-                        {
-                            tot += 1.0;
-                        }
-                    }
-                tot                                        = tot / subgrid2;
-                data.image[ID].array.F[jj * naxes[0] + ii] = tot;
+                image_gen_row(&work, jj)[ii - work.i0] = 1;
             }
         }
 
+    image_gen_close(ID, out, &work);
+
     return (ID);
 }
 
-/* creates a square */
 imageID make_square(const char *ID_name,
                     uint32_t    l1,
                     uint32_t    l2,
@@ -1346,23 +2166,57 @@ imageID make_square(const char *ID_name,
                     double      y_center,
                     double      radius)
 {
-    imageID  ID;
-    uint32_t naxes[2];
+    return make_square_dt(ID_name,
+                          l1,
+                          l2,
+                          x_center,
+                          y_center,
+                          radius,
+                          &image_gen_output);
+}
 
-    create_2Dimage_ID(ID_name, l1, l2, &ID);
-    naxes[0] = data.image[ID].md[0].size[0];
-    naxes[1] = data.image[ID].md[0].size[1];
+imageID make_rectangle_dt(const char             *ID_name,
+                          uint32_t                l1,
+                          uint32_t                l2,
+                          double                  x_center,
+                          double                  y_center,
+                          double                  radius1,
+                          double                  radius2,
+                          const IMAGE_GEN_OUTPUT *out)
+{
+    imageID        ID;
+    IMAGE_GEN_WORK work;
 
-    for(uint32_t jj = 0; jj < naxes[1]; jj++)
-        for(uint32_t ii = 0; ii < naxes[0]; ii++)
+
+    image_gen_box(x_center - radius1,
+                  x_center + radius1,
+                  y_center - radius2,
+                  y_center + radius2,
+                  l1,
+                  l2,
+                  &work.i0,
+                  &work.i1,
+                  &work.j0,
+                  &work.j1);
+
+    ID = image_gen_open(ID_name, l1, l2, out, &work);
+    if(ID == -1)
+    {
+        return -1;
+    }
+
+    for(long jj = work.j0; jj < work.j1; jj++)
+        for(long ii = work.i0; ii < work.i1; ii++)
         {
-            if((((ii - x_center) * (ii - x_center)) < (radius * radius)) &&
-                    (((jj - y_center) * (jj - y_center)) < (radius * radius)))
+            if((((ii - x_center) * (ii - x_center)) < (radius1 * radius1)) &&
+                    (((jj - y_center) * (jj - y_center)) < (radius2 * radius2)))
             {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 1;
+                image_gen_row(&work, jj)[ii - work.i0] = 1;
             }
         }
 
+    image_gen_close(ID, out, &work);
+
     return (ID);
 }
 
@@ -1374,49 +2228,55 @@ imageID make_rectangle(const char *ID_name,
                        double      radius1,
                        double      radius2)
 {
-    imageID  ID;
-    uint32_t naxes[2];
-
-    create_2Dimage_ID(ID_name, l1, l2, &ID);
-    naxes[0] = data.image[ID].md[0].size[0];
-    naxes[1] = data.image[ID].md[0].size[1];
-
-    for(uint32_t jj = 0; jj < naxes[1]; jj++)
-        for(uint32_t ii = 0; ii < naxes[0]; ii++)
-        {
-            if((((ii - x_center) * (ii - x_center)) < (radius1 * radius1)) &&
-                    (((jj - y_center) * (jj - y_center)) < (radius2 * radius2)))
-            {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 1;
-            }
-        }
-
-    return (ID);
+    return make_rectangle_dt(ID_name,
+                             l1,
+                             l2,
+                             x_center,
+                             y_center,
+                             radius1,
+                             radius2,
+                             &image_gen_output);
 }
 
-// line of thickness t from (x1,y1) to (x2,y2)
-imageID make_line(const char *IDname,
-                  uint32_t    l1,
-                  uint32_t    l2,
-                  double      x1,
-                  double      y1,
-                  double      x2,
-                  double      y2,
-                  double      t)
-{
-    imageID  ID;
-    double   x, y, xr, yr, r0;
-    double   PA0;
-    uint32_t naxes[2];
-
-    create_2Dimage_ID(IDname, l1, l2, &ID);
-    naxes[0] = data.image[ID].md[0].size[0];
-    naxes[1] = data.image[ID].md[0].size[1];
-
+// line of thickness t from (x1,y1) to (x2,y2)
+imageID make_line_dt(const char             *IDname,
+                     uint32_t                l1,
+                     uint32_t                l2,
+                     double                  x1,
+                     double                  y1,
+                     double                  x2,
+                     double                  y2,
+                     double                  t,
+                     const IMAGE_GEN_OUTPUT *out)
+{
+    imageID        ID;
+    IMAGE_GEN_WORK work;
+    double         x, y, xr, yr, r0;
+    double         PA0;
+
     r0  = sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
     PA0 = atan2((y2 - y1), (x2 - x1));
-    for(uint32_t jj = 0; jj < naxes[1]; jj++)
-        for(uint32_t ii = 0; ii < naxes[0]; ii++)
+
+    // pixels outside the segment end points +/- t/2 are 0
+    image_gen_box(fmin(x1, x2) - 0.5 * t - 1.0,
+                  fmax(x1, x2) + 0.5 * t + 1.0,
+                  fmin(y1, y2) - 0.5 * t - 1.0,
+                  fmax(y1, y2) + 0.5 * t + 1.0,
+                  l1,
+                  l2,
+                  &work.i0,
+                  &work.i1,
+                  &work.j0,
+                  &work.j1);
+
+    ID = image_gen_open(IDname, l1, l2, out, &work);
+    if(ID == -1)
+    {
+        return -1;
+    }
+
+    for(long jj = work.j0; jj < work.j1; jj++)
+        for(long ii = work.i0; ii < work.i1; ii++)
         {
             x = 1.0 * ii;
             y = 1.0 * jj;
@@ -1430,17 +2290,31 @@ imageID make_line(const char *IDname,
             if((xr > 0) && (xr < 1.0) && (yr < 0.5 * t / r0) &&
                     (yr > -0.5 * t / r0))
             {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 1.0;
+                image_gen_row(&work, jj)[ii - work.i0] = 1.0;
             }
             else
             {
-                data.image[ID].array.F[jj * naxes[0] + ii] = 0.0;
+                image_gen_row(&work, jj)[ii - work.i0] = 0.0;
             }
         }
 
+    image_gen_close(ID, out, &work);
+
     return (ID);
 }
 
+imageID make_line(const char *IDname,
+                  uint32_t    l1,
+                  uint32_t    l2,
+                  double      x1,
+                  double      y1,
+                  double      x2,
+                  double      y2,
+                  double      t)
+{
+    return make_line_dt(IDname, l1, l2, x1, y1, x2, y2, t, &image_gen_output);
+}
+
 // draw line crossing point xc, yc with angle, pixel value is coordinate axis perp to line
 imageID make_lincoordinate(const char *IDname,
                            uint32_t    l1,
@@ -1470,18 +2344,19 @@ imageID make_lincoordinate(const char *IDname,
     return (ID);
 }
 
-imageID make_hexagon(const char *IDname,
-                     uint32_t    l1,
-                     uint32_t    l2,
-                     double      x_center,
-                     double      y_center,
-                     double      radius)
+imageID make_hexagon_dt(const char             *IDname,
+                        uint32_t                l1,
+                        uint32_t                l2,
+                        double                  x_center,
+                        double                  y_center,
+                        double                  radius,
+                        const IMAGE_GEN_OUTPUT *out)
 {
-    imageID  ID;
-    uint32_t ii, jj;
-    uint32_t naxes[2];
-    float    x, y, r;
-    float    value;
+    imageID        ID;
+    IMAGE_GEN_WORK work;
+    uint32_t       ii, jj;
+    float          x, y, r;
+    float          value;
 
     long  iimin, iimax, jjmin, jjmax;
     float radius1, radius0sq;
@@ -1491,10 +2366,6 @@ imageID make_hexagon(const char *IDname,
 
     printf("Making hexagon at %f x %f\n", x_center, y_center);
 
-    create_2Dimage_ID(IDname, l1, l2, &ID);
-    naxes[0] = data.image[ID].md[0].size[0];
-    naxes[1] = data.image[ID].md[0].size[1];
-
     iimin = (long)(x_center - radius1 - 1.0);
     if(iimin < 0)
     {
@@ -1535,6 +2406,17 @@ imageID make_hexagon(const char *IDname,
         jjmax = l2 - 1;
     }
 
+    work.i0 = iimin;
+    work.i1 = iimax;
+    work.j0 = jjmin;
+    work.j1 = jjmax;
+
+    ID = image_gen_open(IDname, l1, l2, out, &work);
+    if(ID == -1)
+    {
+        return -1;
+    }
+
 #ifdef HAVE_LIBGOMP
     #pragma omp parallel default(shared) private(ii, jj, value, x, y, r)
     {
@@ -1572,65 +2454,735 @@ imageID make_hexagon(const char *IDname,
                         }
                     }
                 }
-                data.image[ID].array.F[jj * naxes[0] + ii] = value;
+                image_gen_row(&work, jj)[ii - iimin] = value;
             }
 #ifdef HAVE_LIBGOMP
     }
 #endif
 
+    image_gen_close(ID, out, &work);
+
+    return (ID);
+}
+
+imageID make_hexagon(const char *IDname,
+                     uint32_t    l1,
+                     uint32_t    l2,
+                     double      x_center,
+                     double      y_center,
+                     double      radius)
+{
+    return make_hexagon_dt(IDname,
+                           l1,
+                           l2,
+                           x_center,
+                           y_center,
+                           radius,
+                           &image_gen_output);
+}
+
+imageID make_sdfshape_dt(const char             *ID_name,
+                         uint32_t                l1,
+                         uint32_t                l2,
+                         const SDF_SHAPE        *shape,
+                         const IMAGE_GEN_OUTPUT *out)
+{
+    imageID        ID;
+    IMAGE_GEN_WORK work;
+
+    sdf_shape_bbox(shape, l1, l2, &work.i0, &work.i1, &work.j0, &work.j1);
+
+    ID = image_gen_open(ID_name, l1, l2, out, &work);
+    if(ID == -1)
+    {
+        return -1;
+    }
+    sdf_raster_holes_box(work.array,
+                         work.stride,
+                         work.i0,
+                         work.i1,
+                         work.j0,
+                         work.j1,
+                         shape,
+                         NULL,
+                         0,
+                         SDF_RASTER_SET);
+
+    image_gen_close(ID, out, &work);
+
+    return (ID);
+}
+
+imageID make_sdfshape(const char      *ID_name,
+                      uint32_t         l1,
+                      uint32_t         l2,
+                      const SDF_SHAPE *shape)
+{
+    return make_sdfshape_dt(ID_name, l1, l2, shape, &image_gen_output);
+}
+
+imageID make_aashape_dt(const char             *ID_name,
+                        uint32_t                l1,
+                        uint32_t                l2,
+                        const char             *shape,
+                        double                  p1,
+                        double                  p2,
+                        double                  p3,
+                        double                  p4,
+                        double                  p5,
+                        const IMAGE_GEN_OUTPUT *out)
+{
+    SDF_SHAPE sdfshape;
+
+    sdfshape.xc    = p1;
+    sdfshape.yc    = p2;
+    sdfshape.a     = p3;
+    sdfshape.b     = p3;
+    sdfshape.angle = p5;
+
+    if(strcasecmp(shape, "disk") == 0)
+    {
+        sdfshape.type  = SDF_SHAPE_DISK;
+        sdfshape.angle = 0.0;
+    }
+    else if(strcasecmp(shape, "square") == 0)
+    {
+        sdfshape.type = SDF_SHAPE_RECT;
+    }
+    else if(strcasecmp(shape, "rect") == 0)
+    {
+        sdfshape.type = SDF_SHAPE_RECT;
+        sdfshape.b    = p4;
+    }
+    else if(strcasecmp(shape, "hex") == 0)
+    {
+        sdfshape.type = SDF_SHAPE_HEXAGON;
+    }
+    else if(strcasecmp(shape, "line") == 0)
+    {
+        sdf_shape_line(&sdfshape, p1, p2, p3, p4, p5);
+    }
+    else
+    {
+        PRINT_ERROR("unknown shape \"%s\"", shape);
+        return -1;
+    }
+
+    return make_sdfshape_dt(ID_name, l1, l2, &sdfshape, out);
+}
+
+imageID make_aashape(const char *ID_name,
+                     uint32_t    l1,
+                     uint32_t    l2,
+                     const char *shape,
+                     double      p1,
+                     double      p2,
+                     double      p3,
+                     double      p4,
+                     double      p5)
+{
+    return make_aashape_dt(ID_name,
+                           l1,
+                           l2,
+                           shape,
+                           p1,
+                           p2,
+                           p3,
+                           p4,
+                           p5,
+                           &image_gen_output);
+}
+
+/** @brief Pupil outline and holes (central obstruction, vanes)
+ *
+ * holes : room for nvane + 1 shapes. Returns number of holes.
+ */
+static long pupil_shapes(double        x_center,
+                         double        y_center,
+                         double        radius_out,
+                         double        radius_in,
+                         long          nvane,
+                         const double *vane_angle,
+                         const double *vane_width,
+                         const double *vane_offset,
+                         SDF_SHAPE    *pupil,
+                         SDF_SHAPE    *holes)
+{
+    long nhole = 0;
+    // vanes extend past the outer edge
+    double vlen = radius_out + 2.0;
+
+    pupil->type  = SDF_SHAPE_DISK;
+    pupil->xc    = x_center;
+    pupil->yc    = y_center;
+    pupil->angle = 0.0;
+    pupil->a     = radius_out;
+    pupil->b     = radius_out;
+
+    if(radius_in > 0.0)
+    {
+        holes[nhole]   = *pupil;
+        holes[nhole].a = radius_in;
+        holes[nhole].b = radius_in;
+        nhole++;
+    }
+
+    for(long k = 0; k < nvane; k++)
+    {
+        double ca = cos(vane_angle[k]);
+        double sa = sin(vane_angle[k]);
+
+        holes[nhole].type  = SDF_SHAPE_RECT;
+        holes[nhole].xc    = x_center + 0.5 * vlen * ca - vane_offset[k] * sa;
+        holes[nhole].yc    = y_center + 0.5 * vlen * sa + vane_offset[k] * ca;
+        holes[nhole].angle = vane_angle[k];
+        holes[nhole].a     = 0.5 * vlen;
+        holes[nhole].b     = 0.5 * vane_width[k];
+        nhole++;
+    }
+
+    return nhole;
+}
+
+// vane count and arrays of make_pupil, 0 and error message if invalid
+static int pupil_vanes_valid(long          nvane,
+                             const double *vane_angle,
+                             const double *vane_width,
+                             const double *vane_offset)
+{
+    if(nvane < 0)
+    {
+        PRINT_ERROR("nvane = %ld must be >= 0", nvane);
+        return 0;
+    }
+    if((nvane > 0) &&
+            ((vane_angle == NULL) || (vane_width == NULL) ||
+             (vane_offset == NULL)))
+    {
+        PRINT_ERROR("vane arrays must not be NULL");
+        return 0;
+    }
+    return 1;
+}
+
+imageID make_pupil_dt(const char             *ID_name,
+                      uint32_t                l1,
+                      uint32_t                l2,
+                      double                  x_center,
+                      double                  y_center,
+                      double                  radius_out,
+                      double                  radius_in,
+                      long                    nvane,
+                      const double           *vane_angle,
+                      const double           *vane_width,
+                      const double           *vane_offset,
+                      const IMAGE_GEN_OUTPUT *out)
+{
+    imageID        ID;
+    IMAGE_GEN_WORK work;
+    SDF_SHAPE      pupil;
+    SDF_SHAPE     *holes;
+    long           nhole;
+
+    if(!pupil_vanes_valid(nvane, vane_angle, vane_width, vane_offset))
+    {
+        return -1;
+    }
+
+    holes = (SDF_SHAPE *) malloc(sizeof(SDF_SHAPE) * (nvane + 1));
+    if(holes == NULL)
+    {
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
+    }
+    nhole = pupil_shapes(x_center,
+                         y_center,
+                         radius_out,
+                         radius_in,
+                         nvane,
+                         vane_angle,
+                         vane_width,
+                         vane_offset,
+                         &pupil,
+                         holes);
+
+    sdf_shape_bbox(&pupil, l1, l2, &work.i0, &work.i1, &work.j0, &work.j1);
+
+    ID = image_gen_open(ID_name, l1, l2, out, &work);
+    if(ID == -1)
+    {
+        free(holes);
+        return -1;
+    }
+    sdf_raster_holes_box(work.array,
+                         work.stride,
+                         work.i0,
+                         work.i1,
+                         work.j0,
+                         work.j1,
+                         &pupil,
+                         holes,
+                         nhole,
+                         SDF_RASTER_SET);
+
+    free(holes);
+
+    image_gen_close(ID, out, &work);
+
     return (ID);
 }
 
+imageID make_pupil(const char   *ID_name,
+                   uint32_t      l1,
+                   uint32_t      l2,
+                   double        x_center,
+                   double        y_center,
+                   double        radius_out,
+                   double        radius_in,
+                   long          nvane,
+                   const double *vane_angle,
+                   const double *vane_width,
+                   const double *vane_offset)
+{
+    return make_pupil_dt(ID_name,
+                         l1,
+                         l2,
+                         x_center,
+                         y_center,
+                         radius_out,
+                         radius_in,
+                         nvane,
+                         vane_angle,
+                         vane_width,
+                         vane_offset,
+                         &image_gen_output);
+}
+
+/* ================================================================== */
+/*            PARAMETER SWEEP CUBES                                   */
+/* ================================================================== */
+
+// draw slice k into zeroed float array, return box written
+// run : interior runs of value 1 per row, left to the caller (see
+// subpixdisk_draw), initialized empty
+typedef void (*IMAGE_GEN_SLICEFUNC)(float      *array,
+                                    uint32_t    xsize,
+                                    uint32_t    ysize,
+                                    long        k,
+                                    const void *param,
+                                    long       *run,
+                                    long       *i0,
+                                    long       *i1,
+                                    long       *j0,
+                                    long       *j1);
+
+/** @brief Cube of nslice frames in output datatype, parallel over slices
+ *
+ * FLOAT output (scale 1) is drawn in place. Other datatypes use one
+ * float frame per thread, converted and cleared over the slice box.
+ *
+ * Interior runs reported by the slice function are copied from one row
+ * of 1 x scale, converted once for the whole cube : per slice, only
+ * edge pixels are computed, converted and cleared.
+ */
+static imageID image_gen_sweep(const char             *ID_name,
+                               uint32_t                l1,
+                               uint32_t                l2,
+                               uint32_t                nslice,
+                               IMAGE_GEN_SLICEFUNC     func,
+                               const void             *param,
+                               const IMAGE_GEN_OUTPUT *out)
+{
+    imageID  ID;
+    uint8_t  datatype  = out->datatype;
+    double   scale     = out->scale;
+    uint64_t framesize = (uint64_t) l1 * l2;
+    int      direct    = (datatype == _DATATYPE_FLOAT) && (scale == 1.0);
+
+    if(cbrng_datatype_size(datatype) == 0)
+    {
+        PRINT_ERROR("unsupported datatype %d", (int) datatype);
+        return -1;
+    }
+
+    if(datatype == _DATATYPE_FLOAT)
+    {
+        create_3Dimage_ID(ID_name, l1, l2, nslice, &ID);
+    }
+    else
+    {
+        uint32_t naxes[3] = {l1, l2, nslice};
+        create_image_ID(ID_name,
+                        3,
+                        naxes,
+                        datatype,
+                        data.SHARED_DFT,
+                        data.NBKEYWORD_DFT,
+                        0,
+                        &ID);
+    }
+    void  *raw   = data.image[ID].array.raw;
+    size_t esize = cbrng_datatype_size(datatype);
+
+    // interior row : 1 x scale in output datatype
+    char  *inrow = (char *) malloc(esize * l1);
+    float *one   = (float *) malloc(sizeof(float) * l1);
+    if((inrow == NULL) || (one == NULL))
+    {
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
+    }
+    for(uint32_t ii = 0; ii < l1; ii++)
+    {
+        one[ii] = 1.0f;
+    }
+    cbrng_store_typed(inrow, datatype, 0, one, l1, scale, 0.0);
+    free(one);
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel
+    {
+#endif
+        float *buff = NULL;
+        long  *run  = (long *) malloc(sizeof(long) * 2 * l2);
+        if(run == NULL)
+        {
+            PRINT_ERROR("malloc returns NULL pointer");
+            abort();
+        }
+        if(!direct)
+        {
+            buff = (float *) calloc(framesize, sizeof(float));
+            if(buff == NULL)
+            {
+                PRINT_ERROR("calloc returns NULL pointer");
+                abort();
+            }
+        }
+
+#ifdef HAVE_LIBGOMP
+        #pragma omp for schedule(dynamic, 1)
+#endif
+        for(long k = 0; k < (long) nslice; k++)
+        {
+            long   i0, i1, j0, j1;
+            float *slice = direct ? (float *) raw + k * framesize : buff;
+
+            memset(run, 0, sizeof(long) * 2 * l2);
+            func(slice, l1, l2, k, param, run, &i0, &i1, &j0, &j1);
+
+            for(long jj = j0; jj < j1; jj++)
+            {
+                uint64_t rowoff = k * framesize + jj * l1;
+                long     n0     = run[2 * jj];
+                long     n1     = run[2 * jj + 1];
+                // edge segments [e0, n0) and [n1, e1)
+                long     seg[4] = {i0, n0, n1, i1};
+
+                if(n0 >= n1)
+                {
+                    seg[1] = i0;
+                    seg[2] = i0;
+                }
+                else
+                {
+                    memcpy((char *) raw + esize * (rowoff + n0),
+                           inrow + esize * n0,
+                           esize * (n1 - n0));
+                }
+                if(direct)
+                {
+                    continue;
+                }
+                for(int e = 0; e < 4; e += 2)
+                {
+                    float *row = buff + (uint64_t) jj * l1;
+                    long   a   = seg[e];
+                    long   b   = seg[e + 1];
+
+                    if(a < b)
+                    {
+                        cbrng_store_typed(raw,
+                                          datatype,
+                                          rowoff + a,
+                                          row + a,
+                                          b - a,
+                                          scale,
+                                          0.0);
+                        memset(row + a, 0, sizeof(float) * (b - a));
+                    }
+                }
+            }
+        }
+
+        free(buff);
+        free(run);
+#ifdef HAVE_LIBGOMP
+    }
+#endif
+    free(inrow);
+
+    return ID;
+}
+
+typedef struct
+{
+    const double *x_center;
+    const double *y_center;
+    const double *radius;
+    int           mode;
+} SUBPIXDISK_SWEEP;
+
+static void subpixdisk_sweep_slice(float      *array,
+                                   uint32_t    xsize,
+                                   uint32_t    ysize,
+                                   long        k,
+                                   const void *param,
+                                   long       *run,
+                                   long       *i0,
+                                   long       *i1,
+                                   long       *j0,
+                                   long       *j1)
+{
+    const SUBPIXDISK_SWEEP *sw = (const SUBPIXDISK_SWEEP *) param;
+    IMAGE_GEN_WORK          work;
+
+    subpixdisk_box(sw->x_center[k],
+                   sw->y_center[k],
+                   sw->radius[k],
+                   sw->mode,
+                   xsize,
+                   ysize,
+                   i0,
+                   i1,
+                   j0,
+                   j1);
+
+    // window over full frame
+    work.array  = array + (uint64_t)(*j0) * xsize + *i0;
+    work.stride = xsize;
+    work.i0     = *i0;
+    work.i1     = *i1;
+    work.j0     = *j0;
+    work.j1     = *j1;
+    work.alloc  = 0;
+
+    subpixdisk_draw(&work,
+                    xsize,
+                    sw->x_center[k],
+                    sw->y_center[k],
+                    sw->radius[k],
+                    sw->mode,
+                    0,
+                    run);
+}
+
+imageID make_subpixdisk_sweep_dt(const char             *ID_name,
+                                 uint32_t                l1,
+                                 uint32_t                l2,
+                                 uint32_t                nslice,
+                                 const double           *x_center,
+                                 const double           *y_center,
+                                 const double           *radius,
+                                 int                     mode,
+                                 const IMAGE_GEN_OUTPUT *out)
+{
+    SUBPIXDISK_SWEEP sw = {x_center, y_center, radius, mode};
+
+    return image_gen_sweep(ID_name,
+                           l1,
+                           l2,
+                           nslice,
+                           subpixdisk_sweep_slice,
+                           &sw,
+                           out);
+}
+
+imageID make_subpixdisk_sweep(const char   *ID_name,
+                              uint32_t      l1,
+                              uint32_t      l2,
+                              uint32_t      nslice,
+                              const double *x_center,
+                              const double *y_center,
+                              const double *radius,
+                              int           mode)
+{
+    return make_subpixdisk_sweep_dt(ID_name,
+                                    l1,
+                                    l2,
+                                    nslice,
+                                    x_center,
+                                    y_center,
+                                    radius,
+                                    mode,
+                                    &image_gen_output);
+}
+
+typedef struct
+{
+    const double *x_center;
+    const double *y_center;
+    const double *radius_out;
+    double        obstruction;
+    long          nvane;
+    const double *vane_angle;
+    const double *vane_width;
+    const double *vane_offset;
+} PUPIL_SWEEP;
+
+static void pupil_sweep_slice(float      *array,
+                              uint32_t    xsize,
+                              uint32_t    ysize,
+                              long        k,
+                              const void *param,
+                              long       *run,
+                              long       *i0,
+                              long       *i1,
+                              long       *j0,
+                              long       *j1)
+{
+    const PUPIL_SWEEP *sw = (const PUPIL_SWEEP *) param;
+    SDF_SHAPE          pupil;
+    SDF_SHAPE         *holes;
+    long               nhole;
+
+    holes = (SDF_SHAPE *) malloc(sizeof(SDF_SHAPE) * (sw->nvane + 1));
+    if(holes == NULL)
+    {
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
+    }
+    nhole = pupil_shapes(sw->x_center[k],
+                         sw->y_center[k],
+                         sw->radius_out[k],
+                         sw->obstruction * sw->radius_out[k],
+                         sw->nvane,
+                         sw->vane_angle,
+                         sw->vane_width,
+                         sw->vane_offset,
+                         &pupil,
+                         holes);
+
+    sdf_shape_bbox(&pupil, xsize, ysize, i0, i1, j0, j1);
+    sdf_raster_holes(array, xsize, ysize, &pupil, holes, nhole, SDF_RASTER_SET);
+
+    free(holes);
+}
+
+imageID make_pupil_sweep_dt(const char             *ID_name,
+                            uint32_t                l1,
+                            uint32_t                l2,
+                            uint32_t                nslice,
+                            const double           *x_center,
+                            const double           *y_center,
+                            const double           *radius_out,
+                            double                  obstruction,
+                            long                    nvane,
+                            const double           *vane_angle,
+                            const double           *vane_width,
+                            const double           *vane_offset,
+                            const IMAGE_GEN_OUTPUT *out)
+{
+    PUPIL_SWEEP sw = {x_center,
+                      y_center,
+                      radius_out,
+                      obstruction,
+                      nvane,
+                      vane_angle,
+                      vane_width,
+                      vane_offset
+                     };
+
+    if(!pupil_vanes_valid(nvane, vane_angle, vane_width, vane_offset))
+    {
+        return -1;
+    }
+
+    return image_gen_sweep(ID_name,
+                           l1,
+                           l2,
+                           nslice,
+                           pupil_sweep_slice,
+                           &sw,
+                           out);
+}
+
+imageID make_pupil_sweep(const char   *ID_name,
+                         uint32_t      l1,
+                         uint32_t      l2,
+                         uint32_t      nslice,
+                         const double *x_center,
+                         const double *y_center,
+                         const double *radius_out,
+                         double        obstruction,
+                         long          nvane,
+                         const double *vane_angle,
+                         const double *vane_width,
+                         const double *vane_offset)
+{
+    return make_pupil_sweep_dt(ID_name,
+                               l1,
+                               l2,
+                               nslice,
+                               x_center,
+                               y_center,
+                               radius_out,
+                               obstruction,
+                               nvane,
+                               vane_angle,
+                               vane_width,
+                               vane_offset,
+                               &image_gen_output);
+}
+
 imageID IMAGE_gen_segments2WFmodes(const char *prefix,
                                    long        ndigit,
                                    const char *IDout_name)
 {
-    imageID IDout = -1;
-    long    NBseg;
-    long    seg;
-    int     OK;
-    char    imname[200];
-    imageID IDarray[10000];
-    long    ii, jj, kk, xsize, ysize, xysize;
-    double  x, y;
-    imageID IDmask;
-    double *segxc;
-    double *segyc;
-    double *segsum;
+    imageID  IDout = -1;
+    long     NBseg;
+    long     NBsegmax = 100;
+    long     seg;
+    int      OK;
+    char     imname[200];
+    imageID *IDarray;
+    long     xsize, ysize, xysize;
+    imageID  IDmask;
+    long    *segbox; // ii range, jj range of each segment, inclusive
+
+    if((ndigit < 1) || (ndigit > 6))
+    {
+        printf("ERROR: Invalid number of didits\n");
+        exit(0);
+    }
+
+    IDarray = (imageID *) malloc(sizeof(imageID) * NBsegmax);
+    if(IDarray == NULL)
+    {
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
+    }
 
     seg = 0;
     OK  = 1;
     while(OK == 1)
     {
-        switch(ndigit)
-        {
-
-            case 1:
-                sprintf(imname, "%s%01ld", prefix, seg);
-                break;
-            case 2:
-                sprintf(imname, "%s%02ld", prefix, seg);
-                break;
-            case 3:
-                sprintf(imname, "%s%03ld", prefix, seg);
-                break;
-            case 4:
-                sprintf(imname, "%s%04ld", prefix, seg);
-                break;
-            case 5:
-                sprintf(imname, "%s%05ld", prefix, seg);
-                break;
-            case 6:
-                sprintf(imname, "%s%06ld", prefix, seg);
-                break;
-
-            default:
-                printf("ERROR: Invalid number of didits\n");
-                exit(0);
-        }
-        IDarray[seg] = image_ID(imname);
-        if(IDarray[seg] != -1)
+        snprintf(imname, sizeof(imname), "%s%0*ld", prefix, (int) ndigit, seg);
+        imageID ID = image_ID(imname);
+        if(ID != -1)
         {
+            if(seg == NBsegmax)
+            {
+                NBsegmax *= 2;
+                IDarray =
+                    (imageID *) realloc(IDarray, sizeof(imageID) * NBsegmax);
+                if(IDarray == NULL)
+                {
+                    PRINT_ERROR("realloc returns NULL pointer");
+                    abort();
+                }
+            }
+            IDarray[seg] = ID;
             seg++;
         }
         else
@@ -1646,112 +3198,146 @@ imageID IMAGE_gen_segments2WFmodes(const char *prefix,
         ysize  = data.image[IDarray[0]].md[0].size[1];
         xysize = xsize * ysize;
 
-        segxc = (double *) malloc(sizeof(double) * NBseg);
-        if(segxc == NULL)
+        for(seg = 0; seg < NBseg; seg++)
         {
-            PRINT_ERROR("malloc returns NULL pointer");
-            abort();
+            if((data.image[IDarray[seg]].md[0].nelement != (uint64_t) xysize) ||
+                    (data.image[IDarray[seg]].md[0].size[0] != xsize))
+            {
+                PRINT_ERROR("segment %ld size differs from segment 0", seg);
+                free(IDarray);
+                return (IDout);
+            }
         }
 
-        segyc = (double *) malloc(sizeof(double) * NBseg);
-        if(segyc == NULL)
+        segbox = (long *) malloc(sizeof(long) * 4 * NBseg);
+        if(segbox == NULL)
         {
             PRINT_ERROR("malloc returns NULL pointer");
             abort();
         }
 
-        segsum = (double *) malloc(sizeof(double) * NBseg);
-        if(segsum == NULL)
-        {
-            PRINT_ERROR("malloc returns NULL pointer");
-            abort();
+        create_2Dimage_ID("_pupmask", xsize, ysize, &IDmask);
+        create_3Dimage_ID(IDout_name, xsize, ysize, 3 * NBseg, &IDout);
+
+        // per segment : centroid and bounding box in one row-major pass,
+        // then piston, tip and tilt written within the bounding box only
+#ifdef HAVE_LIBGOMP
+        #pragma omp parallel for schedule(dynamic)
+#endif
+        for(long sg = 0; sg < NBseg; sg++)
+        {
+            float *segF = data.image[IDarray[sg]].array.F;
+            float *outF = data.image[IDout].array.F + 3 * sg * xysize;
+            long  *box  = segbox + 4 * sg;
+            double sx   = 0.0;
+            double sy   = 0.0;
+            double sum  = 0.0;
+            double xc, yc;
+
+            box[0] = xsize;
+            box[1] = -1;
+            box[2] = ysize;
+            box[3] = -1;
+            for(long jj = 0; jj < ysize; jj++)
+                for(long ii = 0; ii < xsize; ii++)
+                {
+                    float v = segF[jj * xsize + ii];
+                    if(v != 0.0)
+                    {
+                        sx += 1.0 * ii * v;
+                        sy += 1.0 * jj * v;
+                        sum += v;
+                        if(ii < box[0])
+                        {
+                            box[0] = ii;
+                        }
+                        if(ii > box[1])
+                        {
+                            box[1] = ii;
+                        }
+                        if(jj < box[2])
+                        {
+                            box[2] = jj;
+                        }
+                        box[3] = jj;
+                    }
+                }
+            xc = sx / sum;
+            yc = sy / sum;
+
+            for(long jj = box[2]; jj <= box[3]; jj++)
+                for(long ii = box[0]; ii <= box[1]; ii++)
+                {
+                    long  pix = jj * xsize + ii;
+                    float v   = segF[pix];
+
+                    outF[pix]              = v;
+                    outF[xysize + pix]     = v * (1.0 * ii - xc);
+                    outF[2 * xysize + pix] = v * (1.0 * jj - yc);
+                }
         }
 
-        create_2Dimage_ID("_pupmask", xsize, ysize, &IDmask);
-
         for(seg = 0; seg < NBseg; seg++)
         {
-            segxc[seg]  = 0.0;
-            segyc[seg]  = 0.0;
-            segsum[seg] = 0.0;
+            float *segF = data.image[IDarray[seg]].array.F;
+            long  *box  = segbox + 4 * seg;
 
-            for(ii = 0; ii < xsize; ii++)
-                for(jj = 0; jj < ysize; jj++)
+            for(long jj = box[2]; jj <= box[3]; jj++)
+                for(long ii = box[0]; ii <= box[1]; ii++)
                 {
-                    x = 1.0 * ii;
-                    y = 1.0 * jj;
-                    segxc[seg] +=
-                        x * data.image[IDarray[seg]].array.F[jj * xsize + ii];
-                    segyc[seg] +=
-                        y * data.image[IDarray[seg]].array.F[jj * xsize + ii];
-                    segsum[seg] +=
-                        data.image[IDarray[seg]].array.F[jj * xsize + ii];
-
                     data.image[IDmask].array.F[jj * xsize + ii] +=
-                        (1.0 + seg) *
-                        data.image[IDarray[seg]].array.F[jj * xsize + ii];
+                        (1.0 + seg) * segF[jj * xsize + ii];
                 }
-            segxc[seg] /= segsum[seg];
-            segyc[seg] /= segsum[seg];
         }
 
-        save_fits("_pupmask", "_pupmask.fits");
-
-        //IDtmp = create_2Dimage_ID("_seg2wfm_tmp", xsize, ysize);
-        create_3Dimage_ID(IDout_name, xsize, ysize, 3 * NBseg, &IDout);
-        kk = 0;
-        for(seg = 0; seg < NBseg; seg++)  // create modes one at a time
+        if(variable_ID("seg2wfmnosave") == -1)
         {
-            // piston seg
-            for(ii = 0; ii < xsize; ii++)
-                for(jj = 0; jj < xsize; jj++)
-                {
-                    data.image[IDout].array.F[kk * xysize + jj * xsize + ii] =
-                        data.image[IDarray[seg]].array.F[jj * xsize + ii];
-                }
-            kk++;
-
-            // Tip
-            for(ii = 0; ii < xsize; ii++)
-                for(jj = 0; jj < xsize; jj++)
-                {
-                    data.image[IDout].array.F[kk * xysize + jj * xsize + ii] =
-                        data.image[IDarray[seg]].array.F[jj * xsize + ii] *
-                        (1.0 * ii - segxc[seg]);
-                }
-            kk++;
-
-            // Tilt
-            for(ii = 0; ii < xsize; ii++)
-                for(jj = 0; jj < xsize; jj++)
-                {
-                    data.image[IDout].array.F[kk * xysize + jj * xsize + ii] =
-                        data.image[IDarray[seg]].array.F[jj * xsize + ii] *
-                        (1.0 * jj - segyc[seg]);
-                }
-            kk++;
+            save_fits("_pupmask", "_pupmask.fits");
         }
 
-        //delete_image_ID("_seg2wfm_tmp", DELETE_IMAGE_ERRMODE_WARNING);
-
-        free(segxc);
-        free(segyc);
-        free(segsum);
+        free(segbox);
     }
+    free(IDarray);
 
     return (IDout);
 }
 
+imageID make_hexseglabel(
+    const char *IDname, uint32_t size, double radius, double gap, double step)
+{
+    imageID    ID;
+    uint32_t   naxes[2] = {size, size};
+    HEXSEGGEOM geom;
+
+    create_image_ID(IDname,
+                    2,
+                    naxes,
+                    _DATATYPE_INT32,
+                    data.SHARED_DFT,
+                    data.NBKEYWORD_DFT,
+                    0,
+                    &ID);
+
+    hexseg_geom(&geom, size, radius, gap, step);
+    memcpy(data.image[ID].array.SI32,
+           geom.label,
+           sizeof(int32_t) * size * size);
+    printf("%ld segments\n", geom.hs.nseg);
+    hexseg_geom_free(&geom);
+
+    return (ID);
+}
+
 imageID make_hexsegpupil(
     const char *IDname, uint32_t size, double radius, double gap, double step)
 {
-    imageID  ID, ID1, IDp;
-    long     x1, y1;
+    imageID  ID, IDp;
     double   x2, y2;
-    imageID  IDdisk;
-    uint32_t ii;
-    double   tot = 0.0;
-    long     size2;
+    uint32_t   ii;
+    long       size2;
+    HEXSEGGEOM geom;
+    double    *segpiston;
+    int32_t   *label;
 
     int    PISTONerr   = 0;
     int    errSEGindex = -1;
@@ -1760,10 +3346,10 @@ imageID make_hexsegpupil(
     long   SEGcnt = 0;
 
     int   mkInfluenceFunctions = 1;
+    int   IFcompact            = 0;
     long  IDif;
     int   seg;
-    long  kk, jj;
-    float xc, yc, tc;
+    long  jj;
 
     int    WriteCIF = 0;
     FILE  *fpmlevel;
@@ -1789,8 +3375,6 @@ imageID make_hexsegpupil(
     int *bitval;       // 0 or 1
     int  bitindex = 4; // 0 = MSB
 
-    double vx, vy, rmsx, rmsy;
-
     if(WriteCIF == 1)
     {
         fp  = fopen("hexcoord.txt", "w");
@@ -1881,7 +3465,7 @@ imageID make_hexsegpupil(
     }
 
     IDmap1 = image_ID("indexmap");
-    size1  = data.image[IDmap1].md[0].size[0];
+    size1  = (IDmap1 != -1) ? data.image[IDmap1].md[0].size[0] : 0;
 
     size2 = size * size;
 
@@ -1891,6 +3475,12 @@ imageID make_hexsegpupil(
         mkInfluenceFunctions = 0;
     }
 
+    ID = variable_ID("hexpupifcompact");
+    if(ID != -1)
+    {
+        IFcompact = 1;
+    }
+
     ID = variable_ID("HEXPISTONerr");
     if(ID != -1)
     {
@@ -1916,227 +3506,88 @@ imageID make_hexsegpupil(
         create_2Dimage_ID("hexpupPha", size, size, &IDp);
     }
 
-    IDdisk = make_disk("_TMPdisk", size, size, size / 2, size / 2, radius);
-    for(ii = 0; ii < size2; ii++)
+    hexseg_geom(&geom, size, radius, gap, step);
+    SEGcnt = geom.hs.nseg;
+    label  = geom.label;
+
+    // piston drawn for each candidate, in scan order
+    segpiston = (double *) calloc(SEGcnt + 1, sizeof(double));
+    if(segpiston == NULL)
     {
-        data.image[IDdisk].array.F[ii] = 1.0 - data.image[IDdisk].array.F[ii];
+        PRINT_ERROR("calloc returns NULL pointer");
+        abort();
     }
-
-    SEGcnt = 0;
-    for(x1 = -(long)(2 * size / step); x1 < (long)(2 * size / step); x1++)
-        for(y1 = -(long)(2 * size / step); y1 < (long)(2 * size / step);
-                y1++)
+    for(long c = 0; c < geom.hs.ncand; c++)
+    {
+        seg = geom.hs.cand[c];
+        if(errSEGindex == -1)
+        {
+            piston = pampl * (1.0 - 2.0 * ran1());
+        }
+        else
+        {
+            piston = (seg == errSEGindex) ? pampl : 0.0;
+        }
+        if(seg >= 0)
         {
-            x2 = step * x1 * 3;
-            y2 = step * sqrt(3.0) * y1;
+            segpiston[seg + 1] = piston;
+        }
+    }
 
-            if(sqrt(x2 * x2 + y2 * y2) < radius)
+    if(WriteCIF == 1)
+    {
+        for(seg = 0; seg < SEGcnt; seg++)
+        {
+            x2 = geom.hs.segx[seg];
+            y2 = geom.hs.segy[seg];
+            ii = (long)(0.5 * size1 + x2 * (0.5 * size1 / radius) *
+                        mapscalefactor);
+            jj = (long)(0.5 * size1 + y2 * (0.5 * size1 / radius) *
+                        mapscalefactor);
+            index = 0;
+            if(IDmap1 != -1)
             {
-                if(errSEGindex == -1)
-                {
-                    piston = pampl * (1.0 - 2.0 * ran1());
-                }
-                else
-                {
-                    if(errSEGindex == SEGcnt)
-                    {
-                        piston = pampl;
-                    }
-                    else
-                    {
-                        piston = 0.0;
-                    }
-                }
-                printf("Hexagon %ld: ", SEGcnt);
-                ID1 = make_hexagon("_TMPhex",
-                                   size,
-                                   size,
-                                   0.5 * size + x2,
-                                   0.5 * size + y2,
-                                   (step - gap) * (sqrt(3.0) / 2.0));
-
-                tot = 0.0;
-                for(ii = 0; ii < size2; ii++)
-                {
-                    tot += data.image[ID1].array.F[ii] *
-                           data.image[IDdisk].array.F[ii];
-                }
-                if(tot < 0.1)
-                {
-                    SEGcnt++;
-                    if(WriteCIF == 1)
-                    {
-                        ii = (long)(0.5 * size1 + x2 * (0.5 * size1 / radius) *
-                                    mapscalefactor);
-                        jj = (long)(0.5 * size1 + y2 * (0.5 * size1 / radius) *
-                                    mapscalefactor);
-                        index = 0;
-                        if(IDmap1 != -1)
-                        {
-                            index =
-                                data.image[IDmap1].array.UI16[jj * size1 + ii];
-                        }
-
-                        //  fprintf(fp, "# hex%03ld     index%03ld   [ %f %f ] -> [ %f %f ]     [%4ld %4ld] %f\n", SEGcnt, index, x2, y2, 0.5*size+x2, 0.5*size+y2, ii, jj, radius);
-                        if(bitval[index - 1] == 1)
-                        {
-                            fprintf(fp, "L %ld;\n", seglevel[index - 1]);
-                            fprintf(fp, "P");
-                            for(pt = 0; pt < 6; pt++)
-                            {
-                                x = pixscale *
-                                    (x2 + 1.0 * cos(2.0 * M_PI * pt / 6) *
-                                     (step - gap));
-                                y = pixscale *
-                                    (y2 + 1.0 * sin(2.0 * M_PI * pt / 6) *
-                                     (step - gap));
-                                fprintf(fp,
-                                        " %ld,%ld",
-                                        (long)(100.0 * x),
-                                        (long)(100.0 * y));
-                                fprintf(fp1,
-                                        "%ld %ld\n",
-                                        (long)(100.0 * x),
-                                        (long)(100.0 * y));
-                            }
-                            fprintf(fp, ";\n");
-                        }
-                    }
-
-                    if(PISTONerr == 1)
-                    {
-                        for(ii = 0; ii < size2; ii++)
-                        {
-                            data.image[ID].array.F[ii] +=
-                                data.image[ID1].array.F[ii];
-                        }
-                    }
-                    else
-                    {
-                        for(ii = 0; ii < size2; ii++)
-                        {
-                            data.image[ID].array.F[ii] +=
-                                1.0 * SEGcnt * data.image[ID1].array.F[ii];
-                        }
-                    }
-
-                    if(PISTONerr == 1)
-                    {
-                        for(ii = 0; ii < size2; ii++)
-                        {
-                            data.image[IDp].array.F[ii] +=
-                                data.image[ID1].array.F[ii] * piston;
-                        }
-                    }
-                }
-                delete_image_ID("_TMPhex", DELETE_IMAGE_ERRMODE_WARNING);
+                index = data.image[IDmap1].array.UI16[jj * size1 + ii];
             }
 
-            x2 += step * 1.5;
-            y2 += step * sqrt(3.0) / 2.0;
-            if(sqrt(x2 * x2 + y2 * y2) < radius)
+            if(bitval[index - 1] == 1)
             {
-                // piston = pampl*(1.0-2.0*ran1());
-                if(errSEGindex == -1)
-                {
-                    piston = pampl * (1.0 - 2.0 * ran1());
-                }
-                else
-                {
-                    if(errSEGindex == SEGcnt)
-                    {
-                        piston = pampl;
-                    }
-                    else
-                    {
-                        piston = 0.0;
-                    }
-                }
-                printf("Hexagon %ld: ", SEGcnt);
-                ID1 = make_hexagon("_TMPhex",
-                                   size,
-                                   size,
-                                   0.5 * size + x2,
-                                   0.5 * size + y2,
-                                   (step - gap) * (sqrt(3.0) / 2.0));
-                tot = 0.0;
-                for(ii = 0; ii < size2; ii++)
-                {
-                    tot += data.image[ID1].array.F[ii] *
-                           data.image[IDdisk].array.F[ii];
-                }
-                if(tot < 0.1)
+                fprintf(fp, "L %ld;\n", seglevel[index - 1]);
+                fprintf(fp, "P");
+                for(pt = 0; pt < 6; pt++)
                 {
-                    SEGcnt++;
-
-                    if(WriteCIF == 1)
-                    {
-                        ii = (long)(0.5 * size1 + x2 * (0.5 * size1 / radius) *
-                                    mapscalefactor);
-                        jj = (long)(0.5 * size1 + y2 * (0.5 * size1 / radius) *
-                                    mapscalefactor);
-                        index = 0;
-                        if(IDmap1 != -1)
-                        {
-                            index =
-                                data.image[IDmap1].array.UI16[jj * size1 + ii];
-                        }
-
-                        // fprintf(fp, "# hex%03ld     index%03ld   [ %f %f ] -> [ %f %f ]   [%4ld %4ld] %f\n", SEGcnt, index, x2, y2, 0.5*size+x2, 0.5*size+y2, ii, jj, radius);
-
-                        if(bitval[index - 1] == 1)
-                        {
-                            fprintf(fp, "L %ld;\n", seglevel[index - 1]);
-                            fprintf(fp, "P");
-                            for(pt = 0; pt < 6; pt++)
-                            {
-                                x = pixscale *
-                                    (x2 + 1.0 * cos(2.0 * M_PI * pt / 6) *
-                                     (step - gap));
-                                y = pixscale *
-                                    (y2 + 1.0 * sin(2.0 * M_PI * pt / 6) *
-                                     (step - gap));
-                                fprintf(fp,
-                                        " %ld,%ld",
-                                        (long)(100.0 * x),
-                                        (long)(100.0 * y));
-                                fprintf(fp1,
-                                        "%ld %ld\n",
-                                        (long)(100.0 * x),
-                                        (long)(100.0 * y));
-                            }
-                            fprintf(fp, ";\n");
-                        }
-                    }
-
-                    if(PISTONerr == 1)
-                    {
-                        for(ii = 0; ii < size2; ii++)
-                        {
-                            data.image[ID].array.F[ii] +=
-                                data.image[ID1].array.F[ii];
-                        }
-                    }
-                    else
-                        for(ii = 0; ii < size2; ii++)
-                        {
-                            data.image[ID].array.F[ii] +=
-                                1.0 * SEGcnt * data.image[ID1].array.F[ii];
-                        }
-
-                    if(PISTONerr == 1)
-                    {
-                        for(ii = 0; ii < size2; ii++)
-                        {
-                            data.image[IDp].array.F[ii] +=
-                                data.image[ID1].array.F[ii] * piston;
-                        }
-                    }
+                    x = pixscale *
+                        (x2 + 1.0 * cos(2.0 * M_PI * pt / 6) * (step - gap));
+                    y = pixscale *
+                        (y2 + 1.0 * sin(2.0 * M_PI * pt / 6) * (step - gap));
+                    fprintf(fp,
+                            " %ld,%ld",
+                            (long)(100.0 * x),
+                            (long)(100.0 * y));
+                    fprintf(fp1,
+                            "%ld %ld\n",
+                            (long)(100.0 * x),
+                            (long)(100.0 * y));
                 }
-                delete_image_ID("_TMPhex", DELETE_IMAGE_ERRMODE_WARNING);
+                fprintf(fp, ";\n");
             }
         }
-    delete_image_ID("_TMPdisk", DELETE_IMAGE_ERRMODE_WARNING);
+    }
+
+    // with piston error, output is the segment mask
+    for(ii = 0; ii < size2; ii++)
+    {
+        if(PISTONerr == 1)
+        {
+            data.image[ID].array.F[ii] = (label[ii] > 0) ? 1.0 : 0.0;
+            data.image[IDp].array.F[ii] = segpiston[label[ii]];
+        }
+        else
+        {
+            data.image[ID].array.F[ii] = label[ii];
+        }
+    }
+    free(segpiston);
 
     printf("%ld segments\n", SEGcnt);
 
@@ -2151,64 +3602,86 @@ imageID make_hexsegpupil(
     free(seglevel);
     free(bitval);
 
-    if(mkInfluenceFunctions == 1)  // TT and focus for each segment
+    if(mkInfluenceFunctions == 1)  // piston, tip and tilt for each segment
     {
+        HEXSEGMOM *mom = geom.mom;
+        uint32_t   bw  = size;
+        uint32_t   bh  = size;
+        uint64_t   sstride;
 
-        create_3Dimage_ID("hexpupif", size, size, 3 * SEGcnt, &IDif);
-        for(seg = 0; seg < SEGcnt; seg++)
+        if(IFcompact == 1)
         {
+            // slices cover the largest segment bounding box
+            imageID  IDoff;
+            uint32_t naxes[2] = {2, SEGcnt};
 
-            // piston
-            kk = 3 * seg;
-            xc = 0.0;
-            yc = 0.0;
-            tc = 0.0;
-            for(ii = 0; ii < size; ii++)
-                for(jj = 0; jj < size; jj++)
+            bw = 1;
+            bh = 1;
+            for(seg = 0; seg < SEGcnt; seg++)
+            {
+                if(mom[seg].imax - mom[seg].imin + 1 > bw)
                 {
-                    if(fabs(data.image[ID].array.F[jj * size + ii] -
-                            (seg + 1.0)) < 0.01)
-                    {
-                        data.image[IDif].array.F[kk * size2 + jj * size + ii] =
-                            1.0;
-                        xc += 1.0 * ii;
-                        yc += 1.0 * jj;
-                        tc += 1.0;
-                    }
+                    bw = mom[seg].imax - mom[seg].imin + 1;
+                }
+                if(mom[seg].jmax - mom[seg].jmin + 1 > bh)
+                {
+                    bh = mom[seg].jmax - mom[seg].jmin + 1;
                 }
-            xc /= tc;
-            yc /= tc;
+            }
+            create_3Dimage_ID("hexpupifc", bw, bh, 3 * SEGcnt, &IDif);
+
+            create_image_ID("hexpupifoff",
+                            2,
+                            naxes,
+                            _DATATYPE_INT32,
+                            data.SHARED_DFT,
+                            data.NBKEYWORD_DFT,
+                            0,
+                            &IDoff);
+            for(seg = 0; seg < SEGcnt; seg++)
+            {
+                data.image[IDoff].array.SI32[2 * seg] =
+                    (mom[seg].npix > 0) ? mom[seg].imin : 0;
+                data.image[IDoff].array.SI32[2 * seg + 1] =
+                    (mom[seg].npix > 0) ? mom[seg].jmin : 0;
+            }
+        }
+        else
+        {
+            create_3Dimage_ID("hexpupif", size, size, 3 * SEGcnt, &IDif);
+        }
+        sstride = (uint64_t) bw * bh;
 
-            // tip and tilt
-            rmsx = 0.0;
-            rmsy = 0.0;
+#ifdef HAVE_LIBGOMP
+        #pragma omp parallel for private(ii) schedule(static)
+#endif
+        for(jj = 0; jj < size; jj++)
             for(ii = 0; ii < size; ii++)
-                for(jj = 0; jj < size; jj++)
+            {
+                int32_t v = label[jj * size + ii];
+                if(v > 0)
                 {
-                    if(fabs(data.image[ID].array.F[jj * size + ii] -
-                            (seg + 1.0)) < 0.01)
+                    HEXSEGMOM *m = &mom[v - 1];
+                    uint64_t   k = 3 * sstride * (v - 1);
+                    float     *F = data.image[IDif].array.F;
+
+                    if(IFcompact == 1)
                     {
-                        vx = 1.0 * ii - xc;
-                        data.image[IDif]
-                        .array.F[(kk + 1) * size2 + jj * size + ii] = vx;
-                        rmsx += vx * vx;
-
-                        vy = 1.0 * jj - yc;
-                        data.image[IDif]
-                        .array.F[(kk + 2) * size2 + jj * size + ii] = vy;
-                        rmsy += vy * vy;
+                        k += (jj - m->jmin) * bw + (ii - m->imin);
                     }
+                    else
+                    {
+                        k += jj * size + ii;
+                    }
+                    F[k]               = 1.0;
+                    F[k + sstride]     = (ii - m->xc) * m->gx;
+                    F[k + 2 * sstride] = (jj - m->yc) * m->gy;
                 }
-            for(ii = 0; ii < size2; ii++)
-            {
-                data.image[IDif].array.F[(kk + 1) * size2 + ii] *=
-                    sqrt(tc / rmsx);
-                data.image[IDif].array.F[(kk + 2) * size2 + ii] *=
-                    sqrt(tc / rmsy);
             }
-        }
     }
 
+    hexseg_geom_free(&geom);
+
     return (ID);
 }
 
@@ -2271,13 +3744,59 @@ imageID make_sectors(const char *ID_name,
     return (ID);
 }
 
-imageID
-make_rnd(const char *ID_name, uint32_t l1, uint32_t l2, const char *options)
+/**
+ * @brief Parse counter-based generator options
+ *
+ * "cbrng" selects the parallel counter-based generator (see cbrng.h),
+ * "-seed <N>" sets its seed (default 0).
+ *
+ * @return 1 if the counter-based generator is selected, 0 otherwise
+ */
+static int make_rnd_parse_cbrng(const char *options, uint64_t *seed)
 {
-    imageID  ID;
-    uint32_t naxes[2];
-    int      distrib;
-    uint64_t nelement;
+    const char *seedstr;
+
+    *seed = 0;
+    if((seedstr = strstr(options, "-seed ")) != NULL)
+    {
+        *seed = strtoull(seedstr + strlen("-seed "), NULL, 10);
+    }
+
+    if(strstr(options, "cbrng") != NULL)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Random image of native datatype
+ *
+ * options : "gauss", "trgauss", "cbrng" and "-seed <N>" as for make_rnd,
+ * "-scale <x>" and "-offset <x>" set the stored value
+ * (value * scale + offset, saturated and rounded for integer types).
+ * Without "cbrng", the generator is seeded from the ran1() state.
+ */
+imageID make_rnd_datatype(const char *ID_name,
+                          uint32_t    l1,
+                          uint32_t    l2,
+                          const char *options,
+                          uint8_t     datatype)
+{
+    imageID     ID;
+    uint32_t    naxes[2];
+    int         distrib;
+    uint64_t    nelement;
+    uint64_t    seed;
+    double      scale  = 1.0;
+    double      offset = 0.0;
+    const char *str;
+
+    if(cbrng_datatype_size(datatype) == 0)
+    {
+        PRINT_ERROR("unsupported datatype %d", (int) datatype);
+        return -1;
+    }
 
     distrib = 0; /* uniform */
     if(strstr(options, "gauss") != NULL)
@@ -2292,97 +3811,140 @@ make_rnd(const char *ID_name, uint32_t l1, uint32_t l2, const char *options)
         printf("truncated gaussian distribution\n");
     }
 
-    if(data.Debug > 1)
+    if(make_rnd_parse_cbrng(options, &seed) == 0)
     {
-        fprintf(stdout, "Image size = %u %u\n", l1, l2);
+        seed = cbrng_seed_ran1();
     }
-
-    create_2Dimage_ID(ID_name, l1, l2, &ID);
-    naxes[0] = data.image[ID].md[0].size[0];
-    naxes[1] = data.image[ID].md[0].size[1];
-    nelement = naxes[0] * naxes[1];
-
-    // openMP is slow when calling gsl random number generator : do not use openMP here
-    if(distrib == 0)
+    if((str = strstr(options, "-scale ")) != NULL)
     {
-        for(uint64_t ii = 0; ii < nelement; ii++)
-        {
-            data.image[ID].array.F[ii] = (double) ran1();
-        }
+        scale = strtod(str + strlen("-scale "), NULL);
     }
-    if(distrib == 1)
+    if((str = strstr(options, "-offset ")) != NULL)
     {
-        for(uint64_t ii = 0; ii < nelement; ii++)
-        {
-            data.image[ID].array.F[ii] = (double) gauss();
-        }
+        offset = strtod(str + strlen("-offset "), NULL);
     }
-    if(distrib == 2)
+
+    if(data.Debug > 1)
     {
-        for(uint64_t ii = 0; ii < nelement; ii++)
-        {
-            data.image[ID].array.F[ii] = (double) gauss_trc();
-        }
+        fprintf(stdout, "Image size = %u %u\n", l1, l2);
     }
 
+    naxes[0] = l1;
+    naxes[1] = l2;
+    create_image_ID(ID_name,
+                    2,
+                    naxes,
+                    datatype,
+                    data.SHARED_DFT,
+                    data.NBKEYWORD_DFT,
+                    0,
+                    &ID);
+    nelement = (uint64_t) l1 * l2;
+
+    cbrng_fill_typed(data.image[ID].array.raw,
+                     datatype,
+                     nelement,
+                     distrib,
+                     NULL,
+                     scale,
+                     offset,
+                     seed,
+                     0);
+
     return (ID);
 }
 
+imageID
+make_rnd(const char *ID_name, uint32_t l1, uint32_t l2, const char *options)
+{
+    return make_rnd_datatype(ID_name, l1, l2, options, _DATATYPE_FLOAT);
+}
+
 imageID make_rnd_double(const char *ID_name,
                         uint32_t    l1,
                         uint32_t    l2,
                         const char *options)
 {
-    imageID  ID;
-    uint32_t naxes[2];
-    int      distrib;
-    uint64_t nelement;
+    return make_rnd_datatype(ID_name, l1, l2, options, _DATATYPE_DOUBLE);
+}
 
-    distrib = 0; /* uniform */
-    if(strstr(options, "gauss") != NULL)
-    {
-        distrib = 1; /* gauss */
-        printf("gaussian distribution\n");
+/**
+ * @brief Datatype code from name
+ *
+ * Accepts UINT8, INT8, UINT16, INT16, UINT32, INT32, HALF, FLOAT, DOUBLE
+ * (case insensitive), the types of cbrng_datatype_size. Returns 0 if
+ * name is not recognized.
+ */
+uint8_t image_gen_datatype_from_name(const char *name)
+{
+    static const struct
+    {
+        const char *name;
+        uint8_t     datatype;
+    } dtnames[] =
+    {
+        {"UINT8", _DATATYPE_UINT8},
+        {"INT8", _DATATYPE_INT8},
+        {"UINT16", _DATATYPE_UINT16},
+        {"INT16", _DATATYPE_INT16},
+        {"UINT32", _DATATYPE_UINT32},
+        {"INT32", _DATATYPE_INT32},
+        {"HALF", _DATATYPE_HALF},
+        {"FLOAT", _DATATYPE_FLOAT},
+        {"DOUBLE", _DATATYPE_DOUBLE}
+    };
+
+    for(size_t i = 0; i < sizeof(dtnames) / sizeof(dtnames[0]); i++)
+    {
+        if(strcasecmp(name, dtnames[i].name) == 0)
+        {
+            return dtnames[i].datatype;
+        }
     }
+    return 0;
+}
 
-    if(strstr(options, "trgauss") != NULL)
-    {
-        distrib = 2; /* truncated gauss */
-        printf("truncated gaussian distribution\n");
-    }
+// random image from the parallel counter-based generator
+// frames are bit-identical for a given seed, independently of thread count
+imageID make_rnd_cbrng(const char *ID_name,
+                       uint32_t    l1,
+                       uint32_t    l2,
+                       int         distrib,
+                       uint64_t    seed)
+{
+    return make_rnd_cbrng_frame(ID_name, l1, l2, distrib, 1.0, 1.0, seed, 0);
+}
 
-    if(data.Debug > 1)
-    {
-        fprintf(stdout, "Image size = %u %u\n", l1, l2);
-    }
+/**
+ * @brief Frame of a counter-based random sequence
+ *
+ * Computed directly from (seed, frame) : identical to frame number frame
+ * of mkrnd run with the same seed, distribution and parameters (RNDSEED,
+ * RNDFRAME, RNDPDF, RNDP1, RNDP2 keywords), without noise bank.
+ */
+imageID make_rnd_cbrng_frame(const char *ID_name,
+                             uint32_t    l1,
+                             uint32_t    l2,
+                             int         distrib,
+                             double      p1,
+                             double      p2,
+                             uint64_t    seed,
+                             uint64_t    frame)
+{
+    imageID     ID;
+    CBRNG_PARAM param;
 
-    create_2Dimage_ID_double(ID_name, l1, l2, &ID);
-    naxes[0] = data.image[ID].md[0].size[0];
-    naxes[1] = data.image[ID].md[0].size[1];
-    nelement = naxes[0] * naxes[1];
+    param.p1    = p1;
+    param.p2    = p2;
+    param.p1map = NULL;
 
-    // openMP is slow when calling gsl random number generator : do not use openMP here
-    if(distrib == 0)
-    {
-        for(uint64_t ii = 0; ii < nelement; ii++)
-        {
-            data.image[ID].array.D[ii] = (double) ran1();
-        }
-    }
-    if(distrib == 1)
-    {
-        for(uint64_t ii = 0; ii < nelement; ii++)
-        {
-            data.image[ID].array.D[ii] = (double) gauss();
-        }
-    }
-    if(distrib == 2)
-    {
-        for(uint64_t ii = 0; ii < nelement; ii++)
-        {
-            data.image[ID].array.D[ii] = (double) gauss_trc();
-        }
-    }
+    create_2Dimage_ID(ID_name, l1, l2, &ID);
+    cbrng_fill_float_param(data.image[ID].array.F,
+                           (uint64_t) l1 * l2,
+                           distrib,
+                           &param,
+                           seed,
+                           frame);
 
     return (ID);
 }
@@ -3436,11 +4998,11 @@ image_gen_make_voronoi_map(const char *filename,
             }
             exit(EXIT_FAILURE);
         }
-        else if(fscanfcnt != 2)
+        else if(fscanfcnt != 1)
         {
             fprintf(stderr,
                     "Error: fscanf successfully matched and assigned %i input "
-                    "items, 2 expected\n",
+                    "items, 1 expected\n",
                     fscanfcnt);
             exit(EXIT_FAILURE);
         }
@@ -1,8 +1,65 @@
 #if !defined(GENIMAGE_H)
 #define GENIMAGE_H
 
+#include "sdfraster.h"
+
 void __attribute__((constructor)) libinit_image_gen();
 
+/** @brief Output of shape generators
+ *
+ * The _dt variants of make_disk, make_subpixdisk_mode,
+ * make_subpixdisk_perturb, make_square, make_rectangle, make_line,
+ * make_hexagon, make_sdfshape, make_aashape, make_pupil and of the
+ * sweep cubes create images of this datatype, storing value x scale
+ * (integer types rounded and saturated). Binary and anti-aliased masks
+ * use IMAGE_GEN_DATATYPE_MASK with scale 1: one byte per pixel,
+ * coverage rounded to 0 / 1. With inplace non-zero, shapes are drawn
+ * into an existing image (see image_gen_set_inplace); sweeps ignore it.
+ * Unsupported datatypes return -1.
+ *
+ * Only these shape generators take an output datatype. The others
+ * (make_double_star, make_lincoordinate, make_hexsegpupil,
+ * make_jacquinot_pupil, make_sectors, make_2axis_gauss, make_cluster,
+ * make_galaxy, make_Egalaxy, make_slopexy, make_PosAngle,
+ * make_offsetHyperGaussian, make_psf_from_profile, make_tile, ...)
+ * create FLOAT images; make_rnd_datatype selects its own datatype.
+ */
+typedef struct
+{
+    uint8_t datatype; // _DATATYPE_*, IMAGE_GEN_DATATYPE_MASK
+    double  scale;
+    int     inplace;
+} IMAGE_GEN_OUTPUT;
+
+/** @brief Output datatype of the shape generators above, no _dt suffix
+ *
+ * Module default for CLI commands, FLOAT with scale 1. Returns
+ * RETURN_FAILURE if datatype is not supported.
+ */
+errno_t image_gen_set_datatype(uint8_t datatype, double scale);
+
+// 1-bit style mask : no packed bit type in image streams
+#define IMAGE_GEN_DATATYPE_MASK _DATATYPE_UINT8
+
+uint8_t image_gen_get_datatype();
+
+double image_gen_get_datatype_scale();
+
+/** @brief In-place mode for shape generators
+ *
+ * Module default for CLI commands, as image_gen_set_datatype. When mode
+ * is non-zero, the shape generators listed above draw into an existing
+ * image of the same size and output datatype instead of creating it:
+ * the bounding box of the previous draw is cleared, the new shape drawn
+ * and the image update posted. Per-call cost scales with the shape
+ * footprint: non-FLOAT output reuses one float buffer of the largest
+ * box drawn so far, nothing frame-sized is allocated. In-place calls
+ * must not run concurrently.
+ */
+void image_gen_set_inplace(int mode);
+
+int image_gen_get_inplace();
+
 /** @brief creates a double star */
 imageID make_double_star(const char *ID_name,
                          uint32_t    l1,
@@ -20,6 +77,14 @@ imageID make_disk(const char *ID_name,
                   double      y_center,
                   double      radius);
 
+imageID make_disk_dt(const char             *ID_name,
+                     uint32_t                l1,
+                     uint32_t                l2,
+                     double                  x_center,
+                     double                  y_center,
+                     double                  radius,
+                     const IMAGE_GEN_OUTPUT *out);
+
 /** @brief  creates a disk */
 imageID make_subpixdisk(const char *ID_name,
                         uint32_t    l1,
@@ -28,6 +93,28 @@ imageID make_subpixdisk(const char *ID_name,
                         double      y_center,
                         double      radius);
 
+// make_subpixdisk_mode modes
+#define SUBPIXDISK_MODE_GRID  0 // 55x55 subgrid on pixels near edge
+#define SUBPIXDISK_MODE_EXACT 1 // exact disk / pixel intersection area
+
+/** @brief  creates a disk with sub-pixel coverage computed per mode */
+imageID make_subpixdisk_mode(const char *ID_name,
+                             uint32_t    l1,
+                             uint32_t    l2,
+                             double      x_center,
+                             double      y_center,
+                             double      radius,
+                             int         mode);
+
+imageID make_subpixdisk_mode_dt(const char             *ID_name,
+                                uint32_t                l1,
+                                uint32_t                l2,
+                                double                  x_center,
+                                double                  y_center,
+                                double                  radius,
+                                int                     mode,
+                                const IMAGE_GEN_OUTPUT *out);
+
 /** @brief creates a shape with contour described by sum of sine waves */
 imageID make_subpixdisk_perturb(const char *ID_name,
                                 uint32_t    l1,
@@ -40,6 +127,18 @@ imageID make_subpixdisk_perturb(const char *ID_name,
                                 double     *ka,
                                 double     *pa);
 
+imageID make_subpixdisk_perturb_dt(const char             *ID_name,
+                                   uint32_t                l1,
+                                   uint32_t                l2,
+                                   double                  x_center,
+                                   double                  y_center,
+                                   double                  radius,
+                                   long                    n,
+                                   double                 *ra,
+                                   double                 *ka,
+                                   double                 *pa,
+                                   const IMAGE_GEN_OUTPUT *out);
+
 /** @brief  creates a square */
 imageID make_square(const char *ID_name,
                     uint32_t    l1,
@@ -48,6 +147,14 @@ imageID make_square(const char *ID_name,
                     double      y_center,
                     double      radius);
 
+imageID make_square_dt(const char             *ID_name,
+                       uint32_t                l1,
+                       uint32_t                l2,
+                       double                  x_center,
+                       double                  y_center,
+                       double                  radius,
+                       const IMAGE_GEN_OUTPUT *out);
+
 imageID make_rectangle(const char *ID_name,
                        uint32_t    l1,
                        uint32_t    l2,
@@ -56,6 +163,15 @@ imageID make_rectangle(const char *ID_name,
                        double      radius1,
                        double      radius2);
 
+imageID make_rectangle_dt(const char             *ID_name,
+                          uint32_t                l1,
+                          uint32_t                l2,
+                          double                  x_center,
+                          double                  y_center,
+                          double                  radius1,
+                          double                  radius2,
+                          const IMAGE_GEN_OUTPUT *out);
+
 imageID make_line(const char *IDname,
                   uint32_t    l1,
                   uint32_t    l2,
@@ -65,6 +181,16 @@ imageID make_line(const char *IDname,
                   double      y2,
                   double      t);
 
+imageID make_line_dt(const char             *IDname,
+                     uint32_t                l1,
+                     uint32_t                l2,
+                     double                  x1,
+                     double                  y1,
+                     double                  x2,
+                     double                  y2,
+                     double                  t,
+                     const IMAGE_GEN_OUTPUT *out);
+
 /** @brief draw line crossing point xc, yc with angle, pixel value is coordinate axis perp to line */
 imageID make_lincoordinate(const char *IDname,
                            uint32_t    l1,
@@ -80,13 +206,187 @@ imageID make_hexagon(const char *IDname,
                      double      y_center,
                      double      radius);
 
+imageID make_hexagon_dt(const char             *IDname,
+                        uint32_t                l1,
+                        uint32_t                l2,
+                        double                  x_center,
+                        double                  y_center,
+                        double                  radius,
+                        const IMAGE_GEN_OUTPUT *out);
+
+/** @brief  creates anti-aliased shape from its signed distance function */
+imageID make_sdfshape(const char      *ID_name,
+                      uint32_t         l1,
+                      uint32_t         l2,
+                      const SDF_SHAPE *shape);
+
+imageID make_sdfshape_dt(const char             *ID_name,
+                         uint32_t                l1,
+                         uint32_t                l2,
+                         const SDF_SHAPE        *shape,
+                         const IMAGE_GEN_OUTPUT *out);
+
+/** @brief  creates anti-aliased shape by name
+ *
+ * shape    p1  p2  p3       p4       p5
+ * disk     xc  yc  radius
+ * square   xc  yc  radius            angle
+ * rect     xc  yc  radius1  radius2  angle
+ * hex      xc  yc  radius            angle
+ * line     x1  y1  x2       y2       thickness
+ */
+imageID make_aashape(const char *ID_name,
+                     uint32_t    l1,
+                     uint32_t    l2,
+                     const char *shape,
+                     double      p1,
+                     double      p2,
+                     double      p3,
+                     double      p4,
+                     double      p5);
+
+imageID make_aashape_dt(const char             *ID_name,
+                        uint32_t                l1,
+                        uint32_t                l2,
+                        const char             *shape,
+                        double                  p1,
+                        double                  p2,
+                        double                  p3,
+                        double                  p4,
+                        double                  p5,
+                        const IMAGE_GEN_OUTPUT *out);
+
+/** @brief  creates annular pupil with spider vanes, anti-aliased
+ *
+ * Vane k starts at the center, points along vane_angle[k] [rad], has
+ * width vane_width[k] and is shifted by vane_offset[k] perpendicular to
+ * its direction (towards increasing angle). All edges are computed in a
+ * single pass over the pupil bounding box. Returns -1 if nvane < 0, or
+ * nvane > 0 with a NULL vane array.
+ */
+imageID make_pupil(const char   *ID_name,
+                   uint32_t      l1,
+                   uint32_t      l2,
+                   double        x_center,
+                   double        y_center,
+                   double        radius_out,
+                   double        radius_in,
+                   long          nvane,
+                   const double *vane_angle,
+                   const double *vane_width,
+                   const double *vane_offset);
+
+imageID make_pupil_dt(const char             *ID_name,
+                      uint32_t                l1,
+                      uint32_t                l2,
+                      double                  x_center,
+                      double                  y_center,
+                      double                  radius_out,
+                      double                  radius_in,
+                      long                    nvane,
+                      const double           *vane_angle,
+                      const double           *vane_width,
+                      const double           *vane_offset,
+                      const IMAGE_GEN_OUTPUT *out);
+
+/** @brief  creates cube of sub-pixel disks, one per slice
+ *
+ * Slice k : disk at (x_center[k], y_center[k]) of radius radius[k], as
+ * make_subpixdisk_mode. Slices are computed in parallel, in the output
+ * datatype (IMAGE_GEN_OUTPUT). Runs of pixels fully inside the disk are
+ * copied from a row converted once per cube, only edge pixels are
+ * evaluated per slice.
+ */
+imageID make_subpixdisk_sweep(const char   *ID_name,
+                              uint32_t      l1,
+                              uint32_t      l2,
+                              uint32_t      nslice,
+                              const double *x_center,
+                              const double *y_center,
+                              const double *radius,
+                              int           mode);
+
+imageID make_subpixdisk_sweep_dt(const char             *ID_name,
+                                 uint32_t                l1,
+                                 uint32_t                l2,
+                                 uint32_t                nslice,
+                                 const double           *x_center,
+                                 const double           *y_center,
+                                 const double           *radius,
+                                 int                     mode,
+                                 const IMAGE_GEN_OUTPUT *out);
+
+/** @brief  creates cube of pupils, one per slice
+ *
+ * Slice k : make_pupil at (x_center[k], y_center[k]), outer radius
+ * radius_out[k], inner radius obstruction x radius_out[k].
+ */
+imageID make_pupil_sweep(const char   *ID_name,
+                         uint32_t      l1,
+                         uint32_t      l2,
+                         uint32_t      nslice,
+                         const double *x_center,
+                         const double *y_center,
+                         const double *radius_out,
+                         double        obstruction,
+                         long          nvane,
+                         const double *vane_angle,
+                         const double *vane_width,
+                         const double *vane_offset);
+
+imageID make_pupil_sweep_dt(const char             *ID_name,
+                            uint32_t                l1,
+                            uint32_t                l2,
+                            uint32_t                nslice,
+                            const double           *x_center,
+                            const double           *y_center,
+                            const double           *radius_out,
+                            double                  obstruction,
+                            long                    nvane,
+                            const double           *vane_angle,
+                            const double           *vane_width,
+                            const double           *vane_offset,
+                            const IMAGE_GEN_OUTPUT *out);
+
+/** @brief  piston, tip and tilt modes of segment images
+ *
+ * Segments are images <prefix><index>, index on ndigit digits, from 0
+ * until the first missing one. Output slices 3k, 3k+1, 3k+2 are segment
+ * k, weighted by 1, x - xc and y - yc about its centroid. Segment index
+ * map is written to _pupmask, and saved to _pupmask.fits unless variable
+ * seg2wfmnosave exists.
+ */
 imageID IMAGE_gen_segments2WFmodes(const char *prefix,
                                    long        ndigit,
                                    const char *IDout_name);
 
+/** @brief  creates hexagonal segmented pupil
+ *
+ * Unless variable hexpupnoif exists, also writes piston, tip and tilt
+ * influence functions of segment k as slices 3k, 3k+1, 3k+2 of cube
+ * hexpupif (size x size). If variable hexpupifcompact exists, the cube is
+ * hexpupifc instead, slices cropped to the largest segment bounding box,
+ * with box origin (ii, jj) of segment k at pixels 2k, 2k+1 of INT32 image
+ * hexpupifoff.
+ *
+ * If variable hexsegcache exists, segment geometry (centers, label map,
+ * bounding boxes, moments) is cached in $MILK_SHM_DIR (/tmp if unset),
+ * keyed by user, size, radius, gap and step, and memory-mapped by later
+ * calls with the same parameters. Cache files take about 4 size^2 bytes
+ * each and are kept until removed.
+ */
 imageID make_hexsegpupil(
     const char *IDname, uint32_t size, double radius, double gap, double step);
 
+/** @brief  creates INT32 label map of hexagonal segments
+ *
+ * Segments as make_hexsegpupil : pixel value is segment index + 1, 0
+ * outside segments. Built in one parallel pass, each pixel rounded to
+ * its lattice cell in axial coordinates. Requires gap >= 0.
+ */
+imageID make_hexseglabel(
+    const char *IDname, uint32_t size, double radius, double gap, double step);
+
 imageID make_jacquinot_pupil(const char *ID_name,
                              uint32_t    l1,
                              uint32_t    l2,
@@ -112,6 +412,33 @@ imageID make_rnd_double(const char *ID_name,
                         const char *options);
 /*int make_rnd1(const char *ID_name, long l1, long l2, const char *options);*/
 
+/** @brief random image of native datatype (_DATATYPE_*) */
+imageID make_rnd_datatype(const char *ID_name,
+                          uint32_t    l1,
+                          uint32_t    l2,
+                          const char *options,
+                          uint8_t     datatype);
+
+/** @brief datatype code from name (FLOAT, UINT16, HALF, ...), 0 if unknown */
+uint8_t image_gen_datatype_from_name(const char *name);
+
+/** @brief random image from parallel counter-based generator */
+imageID make_rnd_cbrng(const char *ID_name,
+                       uint32_t    l1,
+                       uint32_t    l2,
+                       int         distrib,
+                       uint64_t    seed);
+
+/** @brief frame of counter-based random sequence (mkrnd replay) */
+imageID make_rnd_cbrng_frame(const char *ID_name,
+                             uint32_t    l1,
+                             uint32_t    l2,
+                             int         distrib,
+                             double      p1,
+                             double      p2,
+                             uint64_t    seed,
+                             uint64_t    frame);
+
 imageID
 make_gauss(const char *ID_name, uint32_t l1, uint32_t l2, double a, double A);
 
@@ -0,0 +1,1087 @@
+/**
+ * @file    imgenaccuracy.c
+ * @brief   Accuracy of fast generator modes against references
+ *
+ * Shape references are unions of primitives (disks, convex polygons,
+ * perturbed disk contour) minus holes, described independently of the
+ * generator code. A pixel farther than half a diagonal from every
+ * primitive boundary is fully in or out. Other pixels are integrated
+ * over nsub columns: the inside test is sampled at nsub + 1 points along
+ * each column and every change of state is located by bisection, so the
+ * column integral is exact up to features thinner than 1 / nsub. The
+ * remaining midpoint rule error across columns is O(1 / nsub^2) for
+ * straight edges, O(nsub^-1.5) at tangent points.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CommandLineInterface/CLIcore.h"
+
+#include "image_gen/image_gen.h"
+
+#include "cbrng.h"
+#include "diskbatch.h"
+#include "imgenaccuracy.h"
+
+#define IMGENACC_IM "_imgenacc"
+
+// pixel half-diagonal
+#define IMGENACC_DMAX 0.70710679
+
+// samples per sampler kernel check
+#define IMGENACC_NSAMPLE (1L << 22)
+
+#define ACC_PRIM_DISK    0
+#define ACC_PRIM_POLY    1 // convex polygon, counter-clockwise
+#define ACC_PRIM_CONTOUR 2 // make_subpixdisk_perturb contour
+
+#define ACC_POLY_MAXVERTEX 6
+#define ACC_CONTOUR_MAXTERM 4
+
+typedef struct
+{
+    int    type; // ACC_PRIM_*
+    int    hole; // subtracted from union of non-hole primitives
+    int    skip; // not part of the shape : pixels inside (1) or outside
+                 // (-1) are not compared, for limits on interior edges
+    double xc;   // disk, contour : center
+    double yc;
+    double r;    // disk, contour : radius
+
+    // polygon
+    int    nv;
+    double vx[ACC_POLY_MAXVERTEX];
+    double vy[ACC_POLY_MAXVERTEX];
+
+    // contour : r (1 + sum ra cos(ka PA + pa))
+    int    nterm;
+    double ra[ACC_CONTOUR_MAXTERM];
+    double ka[ACC_CONTOUR_MAXTERM];
+    double pa[ACC_CONTOUR_MAXTERM];
+    double lip; // Lipschitz constant of radial distance
+
+    // bounding circle
+    double bx;
+    double by;
+    double br;
+} ACC_PRIM;
+
+static double acc_contour_radius(const ACC_PRIM *p, double dx, double dy)
+{
+    double PA = atan2(dy, dx);
+    double v  = p->r;
+
+    for(int k = 0; k < p->nterm; k++)
+    {
+        v += p->r * p->ra[k] * cos(p->ka[k] * PA + p->pa[k]);
+    }
+    return v;
+}
+
+static int acc_prim_inside(const ACC_PRIM *p, double x, double y)
+{
+    switch(p->type)
+    {
+        case ACC_PRIM_DISK:
+            return (x - p->xc) * (x - p->xc) + (y - p->yc) * (y - p->yc) <
+                   p->r * p->r;
+
+        case ACC_PRIM_POLY:
+            for(int k = 0; k < p->nv; k++)
+            {
+                int    k1 = (k + 1) % p->nv;
+                double ex = p->vx[k1] - p->vx[k];
+                double ey = p->vy[k1] - p->vy[k];
+                if(ex * (y - p->vy[k]) - ey * (x - p->vx[k]) <= 0.0)
+                {
+                    return 0;
+                }
+            }
+            return 1;
+
+        default:
+        {
+            // as make_subpixdisk_perturb : vector from point to center
+            double dx = p->xc - x;
+            double dy = p->yc - y;
+            double v  = acc_contour_radius(p, dx, dy);
+            return dx * dx + dy * dy < v * v;
+        }
+    }
+}
+
+// lower bound of distance from (x, y) to primitive boundary
+static double acc_prim_bound(const ACC_PRIM *p, double x, double y)
+{
+    switch(p->type)
+    {
+        case ACC_PRIM_DISK:
+            return fabs(sqrt((x - p->xc) * (x - p->xc) +
+                             (y - p->yc) * (y - p->yc)) -
+                        p->r);
+
+        case ACC_PRIM_POLY:
+        {
+            double dmin = HUGE_VAL;
+            for(int k = 0; k < p->nv; k++)
+            {
+                int    k1 = (k + 1) % p->nv;
+                double ex = p->vx[k1] - p->vx[k];
+                double ey = p->vy[k1] - p->vy[k];
+                double wx = x - p->vx[k];
+                double wy = y - p->vy[k];
+                double t  = (ex * wx + ey * wy) / (ex * ex + ey * ey);
+                t         = fmin(fmax(t, 0.0), 1.0);
+                wx -= t * ex;
+                wy -= t * ey;
+                dmin = fmin(dmin, sqrt(wx * wx + wy * wy));
+            }
+            return dmin;
+        }
+
+        default:
+        {
+            double dx = p->xc - x;
+            double dy = p->yc - y;
+            double v  = acc_contour_radius(p, dx, dy);
+            return fabs(sqrt(dx * dx + dy * dy) - fabs(v)) / p->lip;
+        }
+    }
+}
+
+static int acc_region_inside(const ACC_PRIM *prim,
+                             const long     *list,
+                             long            n,
+                             double          x,
+                             double          y)
+{
+    int in = 0;
+
+    for(long k = 0; k < n; k++)
+    {
+        const ACC_PRIM *p = &prim[list[k]];
+        if(p->hole && acc_prim_inside(p, x, y))
+        {
+            return 0;
+        }
+        if(!p->hole && !in)
+        {
+            in = acc_prim_inside(p, x, y);
+        }
+    }
+    return in;
+}
+
+// pixel (x, y) excluded from comparison by skip primitives
+static int acc_skipped(const ACC_PRIM *prim, long nprim, double x, double y)
+{
+    for(long k = 0; k < nprim; k++)
+    {
+        const ACC_PRIM *p = &prim[k];
+        if((p->skip == 1) && acc_prim_inside(p, x, y))
+        {
+            return 1;
+        }
+        if((p->skip == -1) && !acc_prim_inside(p, x, y))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// bisection steps locating an edge along a column
+#define IMGENACC_NBISECT 40
+
+/**
+ * @brief Reference coverage of pixel (x, y)
+ *
+ * list : scratch room for nprim indices
+ */
+static double acc_reference(const ACC_PRIM *prim,
+                            long            nprim,
+                            long            nsub,
+                            double          x,
+                            double          y,
+                            long           *list)
+{
+    long   n    = 0;
+    double dmin = HUGE_VAL;
+
+    // primitives whose bounding circle reaches the pixel
+    for(long k = 0; k < nprim; k++)
+    {
+        const ACC_PRIM *p = &prim[k];
+        if(p->skip != 0)
+        {
+            continue;
+        }
+        double bx = x - p->bx;
+        double by = y - p->by;
+        double br = p->br + IMGENACC_DMAX;
+        if(bx * bx + by * by < br * br)
+        {
+            list[n++] = k;
+            dmin      = fmin(dmin, acc_prim_bound(p, x, y));
+        }
+    }
+
+    if(dmin > IMGENACC_DMAX)
+    {
+        return (double) acc_region_inside(prim, list, n, x, y);
+    }
+
+    double h   = 1.0 / nsub;
+    double tot = 0.0;
+    for(long i = 0; i < nsub; i++)
+    {
+        double xs  = x - 0.5 + (i + 0.5) * h;
+        double ya  = y - 0.5;
+        int    ina = acc_region_inside(prim, list, n, xs, ya);
+
+        for(long j = 1; j <= nsub; j++)
+        {
+            double yb  = y - 0.5 + j * h;
+            int    inb = acc_region_inside(prim, list, n, xs, yb);
+
+            if(ina == inb)
+            {
+                tot += ina * h;
+            }
+            else
+            {
+                // edge between ya and yb
+                double y0 = ya;
+                double y1 = yb;
+                for(int it = 0; it < IMGENACC_NBISECT; it++)
+                {
+                    double ym = 0.5 * (y0 + y1);
+                    if(acc_region_inside(prim, list, n, xs, ym) == ina)
+                    {
+                        y0 = ym;
+                    }
+                    else
+                    {
+                        y1 = ym;
+                    }
+                }
+                double ye = 0.5 * (y0 + y1);
+                tot += ina ? (ye - ya) : (yb - ye);
+            }
+            ya  = yb;
+            ina = inb;
+        }
+    }
+    return tot * h;
+}
+
+static void acc_prim_disk(ACC_PRIM *p, double xc, double yc, double r, int hole)
+{
+    memset(p, 0, sizeof(ACC_PRIM));
+    p->type = ACC_PRIM_DISK;
+    p->hole = hole;
+    p->xc   = xc;
+    p->yc   = yc;
+    p->r    = r;
+    p->bx   = xc;
+    p->by   = yc;
+    p->br   = r;
+}
+
+// polygon from vertices (u, v) in frame centered at (xc, yc), rotated
+static void acc_prim_poly(ACC_PRIM     *p,
+                          double        xc,
+                          double        yc,
+                          double        angle,
+                          int           nv,
+                          const double *u,
+                          const double *v,
+                          int           hole)
+{
+    double c = cos(angle);
+    double s = sin(angle);
+
+    memset(p, 0, sizeof(ACC_PRIM));
+    p->type = ACC_PRIM_POLY;
+    p->hole = hole;
+    p->nv   = nv;
+    p->bx   = xc;
+    p->by   = yc;
+    for(int k = 0; k < nv; k++)
+    {
+        p->vx[k] = xc + c * u[k] - s * v[k];
+        p->vy[k] = yc + s * u[k] + c * v[k];
+        p->br    = fmax(p->br, sqrt(u[k] * u[k] + v[k] * v[k]));
+    }
+}
+
+// rectangle [u0, u1] x [v0, v1] in rotated frame
+static void acc_prim_rect(ACC_PRIM *p,
+                          double    xc,
+                          double    yc,
+                          double    angle,
+                          double    u0,
+                          double    u1,
+                          double    v0,
+                          double    v1,
+                          int       hole)
+{
+    double u[4] = {u0, u1, u1, u0};
+    double v[4] = {v0, v0, v1, v1};
+
+    acc_prim_poly(p, xc, yc, angle, 4, u, v, hole);
+}
+
+// shape generators output
+static const IMAGE_GEN_OUTPUT imgenacc_out = {_DATATYPE_FLOAT, 1.0, 0};
+
+/** @brief Shape case : draws IMGENACC_IM, returns reference primitives
+ *
+ * size >= 64. Returns number of primitives written to prim (room for
+ * IMGENACC_MAXPRIM).
+ */
+typedef long (*ACC_SHAPEFUNC)(uint32_t size, ACC_PRIM *prim);
+
+#define IMGENACC_MAXPRIM 64
+
+// disk cases : radius 0.37 size, center off pixel grid
+#define ACC_XC (0.5 * size + 0.23)
+#define ACC_YC (0.5 * size - 0.41)
+#define ACC_R  (0.37 * size)
+
+static long acc_subpixdisk(uint32_t size, ACC_PRIM *prim)
+{
+    make_subpixdisk_mode_dt(IMGENACC_IM,
+                            size,
+                            size,
+                            ACC_XC,
+                            ACC_YC,
+                            ACC_R,
+                            SUBPIXDISK_MODE_GRID,
+                            &imgenacc_out);
+    acc_prim_disk(prim, ACC_XC, ACC_YC, ACC_R, 0);
+    return 1;
+}
+
+static long acc_subpixdisk_exact(uint32_t size, ACC_PRIM *prim)
+{
+    make_subpixdisk_mode_dt(IMGENACC_IM,
+                            size,
+                            size,
+                            ACC_XC,
+                            ACC_YC,
+                            ACC_R,
+                            SUBPIXDISK_MODE_EXACT,
+                            &imgenacc_out);
+    acc_prim_disk(prim, ACC_XC, ACC_YC, ACC_R, 0);
+    return 1;
+}
+
+static long acc_subpixdisk_perturb(uint32_t size, ACC_PRIM *prim)
+{
+    double ra[3] = {0.05, 0.02, 0.01};
+    double ka[3] = {3.0, 7.0, 12.0};
+    double pa[3] = {0.1, 1.2, 2.3};
+    double m1    = 0.0;
+    double asum  = 0.0;
+
+    make_subpixdisk_perturb_dt(IMGENACC_IM,
+                               size,
+                               size,
+                               ACC_XC,
+                               ACC_YC,
+                               ACC_R,
+                               3,
+                               ra,
+                               ka,
+                               pa,
+                               &imgenacc_out);
+
+    memset(prim, 0, sizeof(ACC_PRIM));
+    prim->type  = ACC_PRIM_CONTOUR;
+    prim->xc    = ACC_XC;
+    prim->yc    = ACC_YC;
+    prim->r     = ACC_R;
+    prim->nterm = 3;
+    for(int k = 0; k < 3; k++)
+    {
+        prim->ra[k] = ra[k];
+        prim->ka[k] = ka[k];
+        prim->pa[k] = pa[k];
+        m1 += fabs(ra[k] * ka[k]);
+        asum += fabs(ra[k]);
+    }
+    // |d rho / d PA| / rho <= m1 / (1 - asum), doubled for margin
+    prim->lip = 1.0 + 2.0 * m1 / (1.0 - asum);
+    prim->bx  = ACC_XC;
+    prim->by  = ACC_YC;
+    prim->br  = ACC_R * (1.0 + asum);
+    return 1;
+}
+
+static long acc_aashape_disk(uint32_t size, ACC_PRIM *prim)
+{
+    make_aashape_dt(IMGENACC_IM,
+                    size,
+                    size,
+                    "disk",
+                    ACC_XC,
+                    ACC_YC,
+                    ACC_R,
+                    0,
+                    0,
+                    &imgenacc_out);
+    acc_prim_disk(prim, ACC_XC, ACC_YC, ACC_R, 0);
+    return 1;
+}
+
+static long acc_aashape_smalldisk(uint32_t size, ACC_PRIM *prim)
+{
+    make_aashape_dt(IMGENACC_IM,
+                    size,
+                    size,
+                    "disk",
+                    ACC_XC,
+                    ACC_YC,
+                    2.7,
+                    0,
+                    0,
+                    &imgenacc_out);
+    acc_prim_disk(prim, ACC_XC, ACC_YC, 2.7, 0);
+    return 1;
+}
+
+// pixels within this distance of a corner are not compared
+#define ACC_CORNER_SKIP 2.0
+
+// skip primitive : disk of radius ACC_CORNER_SKIP around (x, y)
+static void acc_prim_corner(ACC_PRIM *p, double x, double y)
+{
+    acc_prim_disk(p, x, y, ACC_CORNER_SKIP, 0);
+    p->skip = 1;
+}
+
+// skip primitives at the vertices of polygon prim, written after it
+static long acc_prim_vertices(ACC_PRIM *prim)
+{
+    for(int k = 0; k < prim->nv; k++)
+    {
+        acc_prim_corner(prim + 1 + k, prim->vx[k], prim->vy[k]);
+    }
+    return 1 + prim->nv;
+}
+
+static long acc_aashape_rect(uint32_t size, ACC_PRIM *prim)
+{
+    double a = 0.3 * size;
+    double b = 0.2 * size;
+
+    make_aashape_dt(IMGENACC_IM,
+                    size,
+                    size,
+                    "rect",
+                    ACC_XC,
+                    ACC_YC,
+                    a,
+                    b,
+                    0.3,
+                    &imgenacc_out);
+    acc_prim_rect(prim, ACC_XC, ACC_YC, 0.3, -a, a, -b, b, 0);
+    return acc_prim_vertices(prim);
+}
+
+static long acc_aashape_hex(uint32_t size, ACC_PRIM *prim)
+{
+    // flat sides at +/- a in shape frame
+    double a = 0.35 * size;
+    double u[6], v[6];
+
+    make_aashape_dt(IMGENACC_IM,
+                    size,
+                    size,
+                    "hex",
+                    ACC_XC,
+                    ACC_YC,
+                    a,
+                    0,
+                    0.1,
+                    &imgenacc_out);
+    for(int k = 0; k < 6; k++)
+    {
+        u[k] = a / cos(M_PI / 6.0) * cos(k * M_PI / 3.0);
+        v[k] = a / cos(M_PI / 6.0) * sin(k * M_PI / 3.0);
+    }
+    acc_prim_poly(prim, ACC_XC, ACC_YC, 0.1, 6, u, v, 0);
+    return acc_prim_vertices(prim);
+}
+
+static long acc_aashape_line(uint32_t size, ACC_PRIM *prim)
+{
+    double x1 = 0.1 * size + 0.3;
+    double y1 = 0.2 * size;
+    double x2 = 0.9 * size;
+    double y2 = 0.7 * size + 0.6;
+    double t  = 2.3;
+    double hl = 0.5 * sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+
+    make_aashape_dt(IMGENACC_IM,
+                    size,
+                    size,
+                    "line",
+                    x1,
+                    y1,
+                    x2,
+                    y2,
+                    t,
+                    &imgenacc_out);
+    acc_prim_rect(prim,
+                  0.5 * (x1 + x2),
+                  0.5 * (y1 + y2),
+                  atan2(y2 - y1, x2 - x1),
+                  -hl,
+                  hl,
+                  -0.5 * t,
+                  0.5 * t,
+                  0);
+    return acc_prim_vertices(prim);
+}
+
+// thin rectangle of width w : ends of the segment are not compared
+static long acc_prim_thinline(ACC_PRIM *prim,
+                              double    x1,
+                              double    y1,
+                              double    x2,
+                              double    y2,
+                              double    w)
+{
+    double hl = 0.5 * sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+
+    acc_prim_rect(prim,
+                  0.5 * (x1 + x2),
+                  0.5 * (y1 + y2),
+                  atan2(y2 - y1, x2 - x1),
+                  -hl,
+                  hl,
+                  -0.5 * w,
+                  0.5 * w,
+                  0);
+    acc_prim_corner(prim + 1, x1, y1);
+    acc_prim_corner(prim + 2, x2, y2);
+    return 3;
+}
+
+static long acc_aashape_thinrect(uint32_t size, ACC_PRIM *prim)
+{
+    double a = 0.3 * size;
+    double b = 0.15;
+    double c = cos(0.3);
+    double s = sin(0.3);
+
+    make_aashape_dt(IMGENACC_IM,
+                    size,
+                    size,
+                    "rect",
+                    ACC_XC,
+                    ACC_YC,
+                    a,
+                    b,
+                    0.3,
+                    &imgenacc_out);
+    return acc_prim_thinline(prim,
+                             ACC_XC - a * c,
+                             ACC_YC - a * s,
+                             ACC_XC + a * c,
+                             ACC_YC + a * s,
+                             2.0 * b);
+}
+
+static long acc_aashape_thinline(uint32_t size, ACC_PRIM *prim)
+{
+    double x1 = 0.1 * size + 0.3;
+    double y1 = 0.2 * size;
+    double x2 = 0.9 * size;
+    double y2 = 0.7 * size + 0.6;
+
+    make_aashape_dt(IMGENACC_IM,
+                    size,
+                    size,
+                    "line",
+                    x1,
+                    y1,
+                    x2,
+                    y2,
+                    0.7,
+                    &imgenacc_out);
+    return acc_prim_thinline(prim, x1, y1, x2, y2, 0.7);
+}
+
+/**
+ * @brief Pupil with 4 vanes, vane k from center along va[k], width
+ * vw[k], shifted by vo[k] across
+ *
+ * Pixels near the corners where vanes meet the rim and the central
+ * obstruction are not compared.
+ */
+static long acc_pupil_vanes(uint32_t      size,
+                            ACC_PRIM     *prim,
+                            const double *va,
+                            const double *vw,
+                            const double *vo)
+{
+    double vlen   = ACC_R + 2.0;
+    double rho[2] = {ACC_R, 0.3 * ACC_R};
+    long   n      = 6;
+
+    make_pupil_dt(IMGENACC_IM,
+                  size,
+                  size,
+                  ACC_XC,
+                  ACC_YC,
+                  ACC_R,
+                  0.3 * ACC_R,
+                  4,
+                  va,
+                  vw,
+                  vo,
+                  &imgenacc_out);
+
+    acc_prim_disk(prim, ACC_XC, ACC_YC, ACC_R, 0);
+    acc_prim_disk(prim + 1, ACC_XC, ACC_YC, 0.3 * ACC_R, 1);
+    for(int k = 0; k < 4; k++)
+    {
+        double c = cos(va[k]);
+        double s = sin(va[k]);
+
+        acc_prim_rect(prim + 2 + k,
+                      ACC_XC,
+                      ACC_YC,
+                      va[k],
+                      0.0,
+                      vlen,
+                      vo[k] - 0.5 * vw[k],
+                      vo[k] + 0.5 * vw[k],
+                      1);
+
+        // vane edge v = e meets circle rho at u = sqrt(rho^2 - e^2)
+        for(int side = 0; side < 2; side++)
+        {
+            double e = vo[k] + (side - 0.5) * vw[k];
+            for(int r = 0; r < 2; r++)
+            {
+                double u = sqrt(rho[r] * rho[r] - e * e);
+                acc_prim_corner(prim + n,
+                                ACC_XC + u * c - e * s,
+                                ACC_YC + u * s + e * c);
+                n++;
+            }
+        }
+    }
+    return n;
+}
+
+static long acc_pupil(uint32_t size, ACC_PRIM *prim)
+{
+    double va[4] = {0.6, 2.4, 3.7, 5.5};
+    double vw[4] = {2.1, 2.1, 1.3, 3.2};
+    double vo[4] = {0.0, 0.0, 0.7, -1.4};
+
+    return acc_pupil_vanes(size, prim, va, vw, vo);
+}
+
+static long acc_pupil_thinvane(uint32_t size, ACC_PRIM *prim)
+{
+    double va[4] = {0.3, 1.9, 3.4, 4.6};
+    double vw[4] = {0.3, 0.5, 0.8, 1.0};
+    double vo[4] = {0.13, -0.29, 0.41, 0.0};
+
+    return acc_pupil_vanes(size, prim, va, vw, vo);
+}
+
+static long acc_disks(uint32_t size, ACC_PRIM *prim)
+{
+    // 8 x 8 disks, radius 0.7 to 3.4, sub-pixel centers
+    double x[64], y[64], r[64];
+    double pitch = size / 8.0;
+
+    for(int k = 0; k < 64; k++)
+    {
+        x[k] = pitch * ((k % 8) + 0.5) + 0.137 * (k % 5);
+        y[k] = pitch * ((k / 8) + 0.5) - 0.113 * (k % 7);
+        r[k] = 0.7 + 2.7 * (k % 8) / 7.0 + 0.05 * (k / 8);
+        acc_prim_disk(prim + k, x[k], y[k], r[k], 0);
+    }
+    make_disks(IMGENACC_IM, size, size, 64, x, y, r, NULL);
+    return 64;
+}
+
+#undef ACC_XC
+#undef ACC_YC
+#undef ACC_R
+
+/**
+ * @brief Regularized lower incomplete gamma function P(a, x)
+ *
+ * Series for x < a + 1, continued fraction (modified Lentz) above.
+ */
+static double acc_gammap(double a, double x)
+{
+    if(x <= 0.0)
+    {
+        return 0.0;
+    }
+
+    double lpre = -x + a * log(x) - lgamma(a);
+
+    if(x < a + 1.0)
+    {
+        double t   = 1.0 / a;
+        double sum = t;
+        for(long n = 1; n < 1000000; n++)
+        {
+            t *= x / (a + n);
+            sum += t;
+            if(t < sum * 1.0e-16)
+            {
+                break;
+            }
+        }
+        return sum * exp(lpre);
+    }
+
+    double b = x + 1.0 - a;
+    double c = 1.0 / 1.0e-300;
+    double d = 1.0 / b;
+    double h = d;
+    for(long n = 1; n < 1000000; n++)
+    {
+        double an = -n * (n - a);
+        b += 2.0;
+        d = an * d + b;
+        d = (fabs(d) < 1.0e-300) ? 1.0e-300 : d;
+        c = b + an / c;
+        c = (fabs(c) < 1.0e-300) ? 1.0e-300 : c;
+        d = 1.0 / d;
+        double del = d * c;
+        h *= del;
+        if(fabs(del - 1.0) < 1.0e-16)
+        {
+            break;
+        }
+    }
+    return 1.0 - exp(lpre) * h;
+}
+
+// distribution CDF, p : distribution parameter
+static double acc_cdf(int distrib, double p, double x)
+{
+    if(distrib == CBRNG_DISTRIB_POISSON)
+    {
+        // P(X <= k) = Q(k + 1, mean)
+        return (x < 0.0) ? 0.0 : 1.0 - acc_gammap(floor(x) + 1.0, p);
+    }
+    // gamma, unit scale
+    return acc_gammap(p, x);
+}
+
+static int acc_cmpfloat(const void *a, const void *b)
+{
+    float fa = *(const float *) a;
+    float fb = *(const float *) b;
+
+    return (fa > fb) - (fa < fb);
+}
+
+/**
+ * @brief Kolmogorov-Smirnov distance of sampler output to distribution
+ *
+ * nsample values from cbrng_fill_float_param, sorted. The empirical CDF
+ * steps at each distinct value x and is compared with the CDF at x and,
+ * for the discrete Poisson distribution, at x - 1 below the step.
+ */
+static errno_t acc_distrib_error(int       distrib,
+                                 double    p,
+                                 uint64_t  nsample,
+                                 double   *dist)
+{
+    CBRNG_PARAM param = {p, 1.0, NULL};
+    float      *v     = (float *) malloc(sizeof(float) * nsample);
+    double      dmax  = 0.0;
+
+    if(v == NULL)
+    {
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
+    }
+
+    cbrng_fill_float_param(v, nsample, distrib, &param, 0x5eed, 0);
+    qsort(v, nsample, sizeof(float), acc_cmpfloat);
+
+    uint64_t ii = 0;
+    while(ii < nsample)
+    {
+        uint64_t i1 = ii;
+        while((i1 < nsample) && (v[i1] == v[ii]))
+        {
+            i1++;
+        }
+
+        double below = (distrib == CBRNG_DISTRIB_POISSON)
+                       ? acc_cdf(distrib, p, v[ii] - 1.0)
+                       : acc_cdf(distrib, p, v[ii]);
+        double at    = acc_cdf(distrib, p, v[ii]);
+        dmax = fmax(dmax, fabs((double) ii / nsample - below));
+        dmax = fmax(dmax, fabs((double) i1 / nsample - at));
+        ii   = i1;
+    }
+    free(v);
+
+    *dist = dmax;
+    return RETURN_SUCCESS;
+}
+
+// kernel field of distribution cases
+#define IMGENACC_DISTRIB (-1)
+
+/**
+ * Limits bound the error of each mode: 55 x 55 subgrid sampling,
+ * coverage table on straight edges and disk curvature, up to a quarter
+ * pixel at 90 degree corners (half-plane model), float rounding for
+ * exact modes. Cases with skip primitives compare edges away from
+ * corners only. Shape cases are also allowed the reference error, see
+ * acc_refallow. Distribution cases are bound by the 99.9 % quantile of
+ * the Kolmogorov-Smirnov distance, 1.95 / sqrt(IMGENACC_NSAMPLE).
+ */
+typedef struct
+{
+    const char   *name;
+    double        limit;   // maximum error allowed
+    ACC_SHAPEFUNC shape;   // NULL for sampler kernel or distribution
+    int           kernel;  // CBRNG_KERNEL_* or IMGENACC_DISTRIB
+    int           distrib; // CBRNG_DISTRIB_POISSON or CBRNG_DISTRIB_GAMMA
+    double        p;       // Poisson mean, gamma shape
+} IMGENACC;
+
+static const IMGENACC imgenacc_list[] =
+{
+    {"make_subpixdisk", 2.0e-2, acc_subpixdisk, 0, 0, 0.0},
+    {"make_subpixdisk_mode(EXACT)", 1.0e-6, acc_subpixdisk_exact, 0, 0, 0.0},
+    {"make_subpixdisk_perturb", 2.0e-2, acc_subpixdisk_perturb, 0, 0, 0.0},
+    {"make_aashape(disk)", 1.0e-2, acc_aashape_disk, 0, 0, 0.0},
+    {"make_aashape(disk r=2.7)", 5.0e-2, acc_aashape_smalldisk, 0, 0, 0.0},
+    {"make_aashape(rect)", 1.0e-2, acc_aashape_rect, 0, 0, 0.0},
+    {"make_aashape(rect w=0.3)", 1.0e-2, acc_aashape_thinrect, 0, 0, 0.0},
+    {"make_aashape(hex)", 1.0e-2, acc_aashape_hex, 0, 0, 0.0},
+    {"make_aashape(line)", 1.0e-2, acc_aashape_line, 0, 0, 0.0},
+    {"make_aashape(line t=0.7)", 1.0e-2, acc_aashape_thinline, 0, 0, 0.0},
+    {"make_pupil", 1.0e-2, acc_pupil, 0, 0, 0.0},
+    {"make_pupil(sub-pixel vanes)", 1.0e-2, acc_pupil_thinvane, 0, 0, 0.0},
+    {"make_disks", 1.0e-6, acc_disks, 0, 0, 0.0},
+    {"cbrng logf", 1.0e-6, NULL, CBRNG_KERNEL_LOGF, 0, 0.0},
+    {"cbrng expf", 1.0e-6, NULL, CBRNG_KERNEL_EXPF, 0, 0.0},
+    {"cbrng sincos2pi", 1.0e-6, NULL, CBRNG_KERNEL_SINCOS, 0, 0.0},
+    {"cbrng gauss", 1.0e-5, NULL, CBRNG_KERNEL_GAUSS, 0, 0.0},
+    {"cbrng gausstrc", 1.0e-6, NULL, CBRNG_KERNEL_GAUSSTRC, 0, 0.0},
+    {
+        "cbrng Poisson mean=0.7", 9.5e-4, NULL,
+        IMGENACC_DISTRIB, CBRNG_DISTRIB_POISSON, 0.7
+    },
+    {
+        "cbrng Poisson mean=6", 9.5e-4, NULL,
+        IMGENACC_DISTRIB, CBRNG_DISTRIB_POISSON, 6.0
+    },
+    {
+        "cbrng Poisson mean=14 (PTRS)", 9.5e-4, NULL,
+        IMGENACC_DISTRIB, CBRNG_DISTRIB_POISSON, 14.0
+    },
+    {
+        "cbrng Poisson mean=1e4 (PTRS)", 9.5e-4, NULL,
+        IMGENACC_DISTRIB, CBRNG_DISTRIB_POISSON, 1.0e4
+    },
+    {
+        "cbrng gamma shape=0.4", 9.5e-4, NULL,
+        IMGENACC_DISTRIB, CBRNG_DISTRIB_GAMMA, 0.4
+    },
+    {
+        "cbrng gamma shape=2.5", 9.5e-4, NULL,
+        IMGENACC_DISTRIB, CBRNG_DISTRIB_GAMMA, 2.5
+    },
+    {
+        "cbrng gamma shape=40", 9.5e-4, NULL,
+        IMGENACC_DISTRIB, CBRNG_DISTRIB_GAMMA, 40.0
+    }
+};
+
+/**
+ * Reference error, dominated by columns near a tangent to a disk of
+ * radius r, where the column integral varies as sqrt(2 r dx): measured
+ * at 3 nsub^-1.5 for r = 0.37 size, size = 256.
+ */
+static double acc_refallow(uint32_t size, long nsub)
+{
+    return 0.25 * sqrt(size) * pow(nsub, -1.5);
+}
+
+/**
+ * @brief Compare image IMGENACC_IM with reference
+ *
+ * RMS error is over edge pixels: reference coverage strictly between 0
+ * and 1, or image differs from reference.
+ */
+static void acc_compare(const ACC_PRIM *prim,
+                        long            nprim,
+                        long            nsub,
+                        double         *errmax,
+                        double         *errrms,
+                        long           *nedge)
+{
+    imageID  ID    = image_ID(IMGENACC_IM);
+    uint32_t xsize = data.image[ID].md[0].size[0];
+    uint32_t ysize = data.image[ID].md[0].size[1];
+    double   emax  = 0.0;
+    double   esum  = 0.0;
+    long     n     = 0;
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel
+#endif
+    {
+        long *list = (long *) malloc(sizeof(long) * nprim);
+        if(list == NULL)
+        {
+            PRINT_ERROR("malloc returns NULL pointer");
+            abort();
+        }
+
+#ifdef HAVE_LIBGOMP
+        #pragma omp for schedule(dynamic, 4) \
+        reduction(max : emax) reduction(+ : esum, n)
+#endif
+        for(uint32_t jj = 0; jj < ysize; jj++)
+        {
+            for(uint32_t ii = 0; ii < xsize; ii++)
+            {
+                if(acc_skipped(prim, nprim, ii, jj))
+                {
+                    continue;
+                }
+
+                double v = data.image[ID].array.F[(uint64_t) jj * xsize + ii];
+                double vref = acc_reference(prim, nprim, nsub, ii, jj, list);
+                double e    = fabs(v - vref);
+
+                if(((vref > 0.0) && (vref < 1.0)) || (e > 0.0))
+                {
+                    emax = fmax(emax, e);
+                    esum += e * e;
+                    n++;
+                }
+            }
+        }
+        free(list);
+    }
+
+    *errmax = emax;
+    *errrms = (n > 0) ? sqrt(esum / n) : 0.0;
+    *nedge  = n;
+}
+
+errno_t image_gen_accuracy(const char *fname, uint32_t size, long nsub)
+{
+    FILE    *fp;
+    int      ncase = sizeof(imgenacc_list) / sizeof(imgenacc_list[0]);
+    int      nfail = 0;
+    ACC_PRIM prim[IMGENACC_MAXPRIM];
+
+    if((size < 64) || (nsub < 2))
+    {
+        PRINT_ERROR("size must be >= 64, nsub >= 2");
+        return RETURN_FAILURE;
+    }
+
+    fp = fopen(fname, "w");
+    if(fp == NULL)
+    {
+        PRINT_ERROR("cannot create file \"%s\"", fname);
+        return RETURN_FAILURE;
+    }
+
+    fprintf(fp, "{\n  \"module\": \"image_gen\",\n");
+    fprintf(fp, "  \"size\": %u,\n  \"nsub\": %ld,\n", size, nsub);
+    fprintf(fp, "  \"results\": [");
+
+    printf("%-30s %12s %12s %10s %10s %6s\n",
+           "case",
+           "max err",
+           "rms err",
+           "count",
+           "limit",
+           "status");
+
+    for(int c = 0; c < ncase; c++)
+    {
+        const IMGENACC *acc = &imgenacc_list[c];
+        double          errmax, errrms;
+        long            n;
+
+        if(acc->shape != NULL)
+        {
+            long nprim = acc->shape(size, prim);
+            acc_compare(prim, nprim, nsub, &errmax, &errrms, &n);
+            delete_image_ID(IMGENACC_IM, DELETE_IMAGE_ERRMODE_WARNING);
+        }
+        else if(acc->kernel == IMGENACC_DISTRIB)
+        {
+            n = IMGENACC_NSAMPLE;
+            acc_distrib_error(acc->distrib, acc->p, n, &errmax);
+            errrms = errmax;
+        }
+        else
+        {
+            n = IMGENACC_NSAMPLE;
+            cbrng_kernel_error(acc->kernel, n, &errmax, &errrms);
+        }
+
+        double limit = acc->limit;
+        if(acc->shape != NULL)
+        {
+            limit += acc_refallow(size, nsub);
+        }
+        int pass = (errmax <= limit);
+        if(!pass)
+        {
+            nfail++;
+        }
+
+        printf("%-30s %12.3e %12.3e %10ld %10.1e %6s\n",
+               acc->name,
+               errmax,
+               errrms,
+               n,
+               limit,
+               pass ? "OK" : "FAIL");
+        fprintf(fp,
+                "%s\n    {\"case\": \"%s\", \"errmax\": %.6e, "
+                "\"errrms\": %.6e, \"count\": %ld, \"limit\": %.3e, "
+                "\"pass\": %s}",
+                (c == 0) ? "" : ",",
+                acc->name,
+                errmax,
+                errrms,
+                n,
+                limit,
+                pass ? "true" : "false");
+    }
+
+    fprintf(fp, "\n  ]\n}\n");
+    fclose(fp);
+
+    printf("%d / %d cases within limits, results written to %s\n",
+           ncase - nfail,
+           ncase,
+           fname);
+
+    return (nfail == 0) ? RETURN_SUCCESS : RETURN_FAILURE;
+}
@@ -0,0 +1,22 @@
+#ifndef IMAGE_GEN_IMGENACCURACY_H
+#define IMAGE_GEN_IMGENACCURACY_H
+
+#include <stdint.h>
+
+/** @brief Check fast generator modes against high precision references
+ *
+ * Anti-aliased shapes (sub-pixel disks, signed distance coverage,
+ * pupils, disk batches) are compared pixel by pixel with a reference
+ * coverage on size x size frames. The reference integrates an exact
+ * inside test along nsub columns per pixel, edges located by bisection,
+ * and is accurate to about 0.25 sqrt(size) nsub^-1.5. Pixels within 2
+ * of a polygon vertex, line end or vane corner are not compared. Sampler
+ * kernels of the counter-based generator are compared with double
+ * precision libm, Poisson and gamma samplers with their CDF
+ * (Kolmogorov-Smirnov distance). Max and RMS error per case are written
+ * as JSON to fname. Returns RETURN_FAILURE if any case exceeds its limit.
+ * Run by ctest (imgenaccuracy_test) on 256 x 256 frames, nsub = 32.
+ */
+errno_t image_gen_accuracy(const char *fname, uint32_t size, long nsub);
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ * @file    imgenaccuracy_test.c
+ * @brief   Accuracy regression test, run by ctest
+ *
+ * Allocates the CLIcore image and variable tables without starting the
+ * command line interpreter, then runs image_gen_accuracy. Exit status is
+ * nonzero if a case exceeds its limit.
+ *
+ * Usage : imgenaccuracy_test [size [nsub [fname]]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "CommandLineInterface/CLIcore.h"
+
+#include "imgenaccuracy.h"
+
+#define IMGENACC_TEST_NBIMAGE    100
+#define IMGENACC_TEST_NBVARIABLE 100
+
+int main(int argc, char *argv[])
+{
+    uint32_t    size  = 256;
+    long        nsub  = 32;
+    const char *fname = "imgenaccuracy.json";
+
+    if(argc > 1)
+    {
+        size = (uint32_t) strtoul(argv[1], NULL, 10);
+    }
+    if(argc > 2)
+    {
+        nsub = strtol(argv[2], NULL, 10);
+    }
+    if(argc > 3)
+    {
+        fname = argv[3];
+    }
+
+    data.NB_MAX_IMAGE    = IMGENACC_TEST_NBIMAGE;
+    data.NB_MAX_VARIABLE = IMGENACC_TEST_NBVARIABLE;
+    data.image           = calloc(data.NB_MAX_IMAGE, sizeof(IMAGE));
+    data.variable        = calloc(data.NB_MAX_VARIABLE, sizeof(VARIABLE));
+    if(data.image == NULL || data.variable == NULL)
+    {
+        PRINT_ERROR("calloc returns NULL pointer");
+        abort();
+    }
+    data.SHARED_DFT    = 0;
+    data.NBKEYWORD_DFT = 10;
+
+    if(image_gen_accuracy(fname, size, nsub) != RETURN_SUCCESS)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
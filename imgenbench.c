@@ -0,0 +1,859 @@
+/**
+ * @file    imgenbench.c
+ * @brief   Benchmark of image_gen generators
+ *
+ * Generators run with parameters scaled to the frame size, FLOAT output
+ * and no in-place redraw, whatever the CLI settings. Timed runs include image
+ * creation, not deletion. Generators that need an input (voronoi point
+ * list, segment images) get it prepared outside the timed section;
+ * streaming kernels (mkrandomim fill, phase screen frames) write into a
+ * preallocated buffer, as they do per frame in their loops.
+ *
+ * Hexagonal segment generators compute their geometry on every run
+ * unless variable hexsegcache exists, make_hexsegpupil runs with compact
+ * influence functions (hexpupifcompact), IMAGE_gen_segments2WFmodes
+ * without writing _pupmask.fits (seg2wfmnosave). Variables are set for
+ * these cases only, unless already defined. Side outputs are deleted
+ * between runs.
+ *
+ * Not benchmarked :
+ * - make_FiberCouplingOverlap, make_psf_from_profile : inputs read from
+ *   disk
+ * - make_tile, image_gen_im2coord : transforms of an input image, no
+ *   generator code
+ * - make_sdfshape : user distance function, timed through make_aashape
+ * - make_rnd_cbrng_frame, make_rnd_datatype : same kernels as
+ *   make_rnd_cbrng, make_rnd
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef HAVE_LIBGOMP
+#include <omp.h>
+#endif
+
+#include "CommandLineInterface/CLIcore.h"
+
+#include "image_gen/image_gen.h"
+
+#include "cbrng.h"
+#include "diskbatch.h"
+#include "imgenbench.h"
+#include "phasescreen.h"
+
+#define IMGENBENCH_IM "_imgenbench"
+
+// segment images input of IMAGE_gen_segments2WFmodes, 4 x 4 grid
+#define IMGENBENCH_SEG    "_imgenbenchseg"
+#define IMGENBENCH_NSEG1D 4
+
+#define IMGENBENCH_MAXVAR 4
+
+typedef struct
+{
+    uint32_t     size;
+    char         vorfile[64]; // voronoi point list
+    float       *buff;        // streaming kernels output
+    PHASESCREEN  ps;
+    int          psinit;
+    int          nvar; // variables created by setup, deleted by teardown
+    const char  *var[IMGENBENCH_MAXVAR];
+} IMGENBENCH_STATE;
+
+typedef struct
+{
+    const char *name;
+    int         nframe; // frames per run (cubes)
+    int         stream; // writes into state buffer, no image created
+    void (*run)(IMGENBENCH_STATE *st);
+    // optional, untimed : inputs and variables before runs at each size
+    // (on = 1), removed after them (on = 0)
+    void (*setup)(IMGENBENCH_STATE *st, int on);
+    // optional, untimed : deletes side outputs after each run
+    void (*clean)(IMGENBENCH_STATE *st);
+} IMGENBENCH;
+
+static double imgenbench_time()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + 1.0e-9 * t.tv_nsec;
+}
+
+/**
+ * @brief Reset peak resident set size to current (Linux >= 4.0)
+ *
+ * Returns 0 on success, -1 if the kernel does not support it : peak RSS
+ * is then the process lifetime peak.
+ */
+static int imgenbench_rss_reset()
+{
+    FILE *fp = fopen("/proc/self/clear_refs", "w");
+    int   ok;
+
+    if(fp == NULL)
+    {
+        return -1;
+    }
+    ok = (fputs("5", fp) >= 0);
+    if(fclose(fp) != 0)
+    {
+        ok = 0;
+    }
+    return ok ? 0 : -1;
+}
+
+// peak resident set size [kB] since last reset, VmHWM
+static long imgenbench_rss_peak()
+{
+    FILE *fp = fopen("/proc/self/status", "r");
+    char  line[256];
+    long  hwm = -1;
+
+    if(fp != NULL)
+    {
+        while(fgets(line, sizeof(line), fp) != NULL)
+        {
+            if(sscanf(line, "VmHWM: %ld", &hwm) == 1)
+            {
+                break;
+            }
+        }
+        fclose(fp);
+    }
+    if(hwm < 0)
+    {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        hwm = usage.ru_maxrss;
+    }
+    return hwm;
+}
+
+// sets variable name for the case, unless already defined
+static void imgenbench_var(IMGENBENCH_STATE *st, const char *name)
+{
+    if(variable_ID(name) == -1)
+    {
+        create_variable_ID(name, 1.0);
+        st->var[st->nvar++] = name;
+    }
+}
+
+// deletes variables set by imgenbench_var
+static void imgenbench_var_clear(IMGENBENCH_STATE *st)
+{
+    while(st->nvar > 0)
+    {
+        delete_variable_ID(st->var[--st->nvar]);
+    }
+}
+
+// shape generators output
+static const IMAGE_GEN_OUTPUT imgenbench_out = {_DATATYPE_FLOAT, 1.0, 0};
+
+// size-relative parameters
+#define BS  ((double) st->size)
+#define BSZ st->size
+
+static void bench_disk(IMGENBENCH_STATE *st)
+{
+    make_disk_dt(IMGENBENCH_IM,
+                 BSZ,
+                 BSZ,
+                 0.51 * BS,
+                 0.49 * BS,
+                 0.4 * BS,
+                 &imgenbench_out);
+}
+
+static void bench_subpixdisk(IMGENBENCH_STATE *st)
+{
+    make_subpixdisk_mode_dt(IMGENBENCH_IM,
+                            BSZ,
+                            BSZ,
+                            0.51 * BS,
+                            0.49 * BS,
+                            0.4 * BS,
+                            SUBPIXDISK_MODE_GRID,
+                            &imgenbench_out);
+}
+
+static void bench_subpixdisk_exact(IMGENBENCH_STATE *st)
+{
+    make_subpixdisk_mode_dt(IMGENBENCH_IM,
+                            BSZ,
+                            BSZ,
+                            0.51 * BS,
+                            0.49 * BS,
+                            0.4 * BS,
+                            SUBPIXDISK_MODE_EXACT,
+                            &imgenbench_out);
+}
+
+static void bench_subpixdisk_perturb(IMGENBENCH_STATE *st)
+{
+    double ra[3] = {0.05, 0.02, 0.01}; // relative to radius
+    double ka[3] = {3.0, 7.0, 12.0};
+    double pa[3] = {0.1, 1.2, 2.3};
+
+    make_subpixdisk_perturb_dt(IMGENBENCH_IM,
+                               BSZ,
+                               BSZ,
+                               0.51 * BS,
+                               0.49 * BS,
+                               0.4 * BS,
+                               3,
+                               ra,
+                               ka,
+                               pa,
+                               &imgenbench_out);
+}
+
+static void bench_subpixdisk_sweep(IMGENBENCH_STATE *st)
+{
+    double x[8], y[8], r[8];
+
+    for(int k = 0; k < 8; k++)
+    {
+        x[k] = 0.5 * BS + 0.37 * k;
+        y[k] = 0.5 * BS - 0.21 * k;
+        r[k] = 0.4 * BS;
+    }
+    make_subpixdisk_sweep_dt(IMGENBENCH_IM,
+                             BSZ,
+                             BSZ,
+                             8,
+                             x,
+                             y,
+                             r,
+                             SUBPIXDISK_MODE_EXACT,
+                             &imgenbench_out);
+}
+
+static void bench_square(IMGENBENCH_STATE *st)
+{
+    make_square_dt(IMGENBENCH_IM,
+                   BSZ,
+                   BSZ,
+                   0.51 * BS,
+                   0.49 * BS,
+                   0.3 * BS,
+                   &imgenbench_out);
+}
+
+static void bench_rectangle(IMGENBENCH_STATE *st)
+{
+    make_rectangle_dt(IMGENBENCH_IM,
+                      BSZ,
+                      BSZ,
+                      0.51 * BS,
+                      0.49 * BS,
+                      0.3 * BS,
+                      0.2 * BS,
+                      &imgenbench_out);
+}
+
+static void bench_line(IMGENBENCH_STATE *st)
+{
+    make_line_dt(IMGENBENCH_IM,
+                 BSZ,
+                 BSZ,
+                 0.1 * BS,
+                 0.2 * BS,
+                 0.9 * BS,
+                 0.7 * BS,
+                 0.02 * BS,
+                 &imgenbench_out);
+}
+
+static void bench_lincoordinate(IMGENBENCH_STATE *st)
+{
+    make_lincoordinate(IMGENBENCH_IM, BSZ, BSZ, 0.5 * BS, 0.5 * BS, 0.3);
+}
+
+static void bench_hexagon(IMGENBENCH_STATE *st)
+{
+    make_hexagon_dt(IMGENBENCH_IM,
+                    BSZ,
+                    BSZ,
+                    0.51 * BS,
+                    0.49 * BS,
+                    0.35 * BS,
+                    &imgenbench_out);
+}
+
+static void bench_aashape(IMGENBENCH_STATE *st)
+{
+    make_aashape_dt(IMGENBENCH_IM,
+                    BSZ,
+                    BSZ,
+                    "hex",
+                    0.51 * BS,
+                    0.49 * BS,
+                    0.35 * BS,
+                    0.0,
+                    0.1,
+                    &imgenbench_out);
+}
+
+static void bench_pupil(IMGENBENCH_STATE *st)
+{
+    double va[4] = {0.785, 2.356, 3.927, 5.498};
+    double vw[4] = {0.005 * BS, 0.005 * BS, 0.005 * BS, 0.005 * BS};
+    double vo[4] = {0.0, 0.0, 0.0, 0.0};
+
+    make_pupil_dt(IMGENBENCH_IM,
+                  BSZ,
+                  BSZ,
+                  0.51 * BS,
+                  0.49 * BS,
+                  0.4 * BS,
+                  0.12 * BS,
+                  4,
+                  va,
+                  vw,
+                  vo,
+                  &imgenbench_out);
+}
+
+static void bench_pupil_sweep(IMGENBENCH_STATE *st)
+{
+    double va[4] = {0.785, 2.356, 3.927, 5.498};
+    double vw[4] = {0.005 * BS, 0.005 * BS, 0.005 * BS, 0.005 * BS};
+    double vo[4] = {0.0, 0.0, 0.0, 0.0};
+    double x[8], y[8], r[8];
+
+    for(int k = 0; k < 8; k++)
+    {
+        x[k] = 0.5 * BS + 0.37 * k;
+        y[k] = 0.5 * BS - 0.21 * k;
+        r[k] = 0.4 * BS;
+    }
+    make_pupil_sweep_dt(IMGENBENCH_IM,
+                        BSZ,
+                        BSZ,
+                        8,
+                        x,
+                        y,
+                        r,
+                        0.3,
+                        4,
+                        va,
+                        vw,
+                        vo,
+                        &imgenbench_out);
+}
+
+static void bench_hexsegpupil_setup(IMGENBENCH_STATE *st, int on)
+{
+    if(on)
+    {
+        imgenbench_var(st, "hexpupifcompact");
+    }
+    else
+    {
+        imgenbench_var_clear(st);
+    }
+}
+
+static void bench_hexsegpupil_clean(IMGENBENCH_STATE *st)
+{
+    delete_image_ID("hexpupifc", DELETE_IMAGE_ERRMODE_WARNING);
+    delete_image_ID("hexpupifoff", DELETE_IMAGE_ERRMODE_WARNING);
+}
+
+static void bench_hexsegpupil(IMGENBENCH_STATE *st)
+{
+    make_hexsegpupil(IMGENBENCH_IM, BSZ, 0.45 * BS, 0.004 * BS, 0.06 * BS);
+}
+
+static void bench_hexseglabel(IMGENBENCH_STATE *st)
+{
+    make_hexseglabel(IMGENBENCH_IM, BSZ, 0.45 * BS, 0.004 * BS, 0.06 * BS);
+}
+
+static void bench_segments2WFmodes_setup(IMGENBENCH_STATE *st, int on)
+{
+    double cell = BS / IMGENBENCH_NSEG1D;
+    char   name[64];
+
+    if(on)
+    {
+        imgenbench_var(st, "seg2wfmnosave");
+    }
+    else
+    {
+        imgenbench_var_clear(st);
+    }
+    for(int k = 0; k < IMGENBENCH_NSEG1D * IMGENBENCH_NSEG1D; k++)
+    {
+        snprintf(name, sizeof(name), "%s%02d", IMGENBENCH_SEG, k);
+        if(on)
+        {
+            make_square_dt(name,
+                           BSZ,
+                           BSZ,
+                           cell * (k % IMGENBENCH_NSEG1D + 0.5),
+                           cell * (k / IMGENBENCH_NSEG1D + 0.5),
+                           0.45 * cell,
+                           &imgenbench_out);
+        }
+        else
+        {
+            delete_image_ID(name, DELETE_IMAGE_ERRMODE_WARNING);
+        }
+    }
+}
+
+static void bench_segments2WFmodes_clean(IMGENBENCH_STATE *st)
+{
+    delete_image_ID("_pupmask", DELETE_IMAGE_ERRMODE_WARNING);
+}
+
+static void bench_segments2WFmodes(IMGENBENCH_STATE *st)
+{
+    IMAGE_gen_segments2WFmodes(IMGENBENCH_SEG, 2, IMGENBENCH_IM);
+}
+
+static void bench_disks(IMGENBENCH_STATE *st)
+{
+    // lenslet grid, pitch 8 pixel
+    long    n1 = BSZ / 8;
+    long    nd = n1 * n1;
+    double *v  = (double *) malloc(sizeof(double) * 3 * (nd + 1));
+    if(v == NULL)
+    {
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
+    }
+    for(long k = 0; k < nd; k++)
+    {
+        v[k]          = 8.0 * (k % n1) + 4.3;
+        v[nd + k]     = 8.0 * (k / n1) + 3.8;
+        v[2 * nd + k] = 2.7;
+    }
+    make_disks(IMGENBENCH_IM, BSZ, BSZ, nd, v, v + nd, v + 2 * nd, NULL);
+    free(v);
+}
+
+static void bench_jacquinot(IMGENBENCH_STATE *st)
+{
+    make_jacquinot_pupil(IMGENBENCH_IM,
+                         BSZ,
+                         BSZ,
+                         0.5 * BS,
+                         0.5 * BS,
+                         0.3 * BS,
+                         0.2 * BS);
+}
+
+static void bench_sectors(IMGENBENCH_STATE *st)
+{
+    make_sectors(IMGENBENCH_IM, BSZ, BSZ, 0.5 * BS, 0.5 * BS, 0.05 * BS, 8);
+}
+
+static void bench_rnd(IMGENBENCH_STATE *st)
+{
+    make_rnd(IMGENBENCH_IM, BSZ, BSZ, "-gauss");
+}
+
+static void bench_rnd_double(IMGENBENCH_STATE *st)
+{
+    make_rnd_double(IMGENBENCH_IM, BSZ, BSZ, "-gauss");
+}
+
+static void bench_rnd_cbrng(IMGENBENCH_STATE *st)
+{
+    make_rnd_cbrng(IMGENBENCH_IM, BSZ, BSZ, CBRNG_DISTRIB_GAUSS, 1);
+}
+
+static void bench_cbrng_fill(IMGENBENCH_STATE *st)
+{
+    // mkrandomim per-frame fill
+    static uint64_t frame = 0;
+    cbrng_fill_typed(st->buff,
+                     _DATATYPE_FLOAT,
+                     (uint64_t) BSZ * BSZ,
+                     CBRNG_DISTRIB_GAUSS,
+                     NULL,
+                     1.0,
+                     0.0,
+                     1,
+                     frame++);
+}
+
+static void bench_phasescreen(IMGENBENCH_STATE *st)
+{
+    if(!st->psinit)
+    {
+        PHASESCREEN_PARAM param = {0.1 * BS,
+                                   11.0 / 3.0,
+                                   0.0,
+                                   1,
+                                   PHASESCREEN_MODE_FFT,
+                                   0,
+                                   4,
+                                   1.0
+                                  };
+        phasescreen_init(&st->ps, BSZ, BSZ, &param, 1);
+        st->psinit = 1;
+    }
+    phasescreen_frame(&st->ps, st->buff);
+}
+
+static void bench_gauss(IMGENBENCH_STATE *st)
+{
+    make_gauss(IMGENBENCH_IM, BSZ, BSZ, 0.1 * BS, 1.0);
+}
+
+static void bench_2axis_gauss(IMGENBENCH_STATE *st)
+{
+    make_2axis_gauss(IMGENBENCH_IM, BSZ, BSZ, 0.1 * BS, 1.0, 0.3, 0.5);
+}
+
+static void bench_galaxy(IMGENBENCH_STATE *st)
+{
+    make_galaxy(IMGENBENCH_IM,
+                BSZ,
+                BSZ,
+                0.1 * BS,
+                1.0,
+                0.3,
+                0.5,
+                0.05 * BS,
+                1.0,
+                0.2,
+                0.1);
+}
+
+static void bench_double_star(IMGENBENCH_STATE *st)
+{
+    make_double_star(IMGENBENCH_IM, BSZ, BSZ, 1.0, 0.3, 0.1 * BS, 0.5);
+}
+
+static void bench_cluster(IMGENBENCH_STATE *st)
+{
+    make_cluster(IMGENBENCH_IM, BSZ, BSZ, "-nbstars 3000");
+}
+
+static void bench_Egalaxy(IMGENBENCH_STATE *st)
+{
+    make_Egalaxy(IMGENBENCH_IM, BSZ, BSZ, "-size 0.2 -e 0.3 -pa 0.5");
+}
+
+static void bench_EZdisk(IMGENBENCH_STATE *st)
+{
+    gen_image_EZdisk(IMGENBENCH_IM, BSZ, 0.1 * BS, 1.5, 0.5);
+}
+
+static void bench_slopexy(IMGENBENCH_STATE *st)
+{
+    make_slopexy(IMGENBENCH_IM, BSZ, BSZ, 0.1, 0.2);
+}
+
+static void bench_dist(IMGENBENCH_STATE *st)
+{
+    make_dist(IMGENBENCH_IM, BSZ, BSZ, 0.5 * BS, 0.5 * BS);
+}
+
+static void bench_PosAngle(IMGENBENCH_STATE *st)
+{
+    make_PosAngle(IMGENBENCH_IM, BSZ, BSZ, 0.5 * BS, 0.5 * BS);
+}
+
+static void bench_offsetHyperGaussian(IMGENBENCH_STATE *st)
+{
+    make_offsetHyperGaussian(BSZ, 0.3 * BS, 0.05 * BS, 4, IMGENBENCH_IM);
+}
+
+static void bench_cosapoedgePupil(IMGENBENCH_STATE *st)
+{
+    make_cosapoedgePupil(BSZ, 0.3 * BS, 0.05 * BS, IMGENBENCH_IM);
+}
+
+static void bench_2Dgridpix(IMGENBENCH_STATE *st)
+{
+    make_2Dgridpix(IMGENBENCH_IM, BSZ, BSZ, 8.0, 8.0, 0.5, 0.5);
+}
+
+static void bench_voronoi(IMGENBENCH_STATE *st)
+{
+    image_gen_make_voronoi_map(st->vorfile,
+                               IMGENBENCH_IM,
+                               BSZ,
+                               BSZ,
+                               0.1,
+                               0.01);
+}
+
+#undef BS
+#undef BSZ
+
+static const IMGENBENCH imgenbench_list[] =
+{
+    {"make_disk", 1, 0, bench_disk, NULL, NULL},
+    {"make_subpixdisk", 1, 0, bench_subpixdisk, NULL, NULL},
+    {"make_subpixdisk_mode(EXACT)", 1, 0, bench_subpixdisk_exact, NULL, NULL},
+    {"make_subpixdisk_perturb", 1, 0, bench_subpixdisk_perturb, NULL, NULL},
+    {"make_subpixdisk_sweep(EXACT)", 8, 0, bench_subpixdisk_sweep, NULL, NULL},
+    {"make_square", 1, 0, bench_square, NULL, NULL},
+    {"make_rectangle", 1, 0, bench_rectangle, NULL, NULL},
+    {"make_line", 1, 0, bench_line, NULL, NULL},
+    {"make_lincoordinate", 1, 0, bench_lincoordinate, NULL, NULL},
+    {"make_hexagon", 1, 0, bench_hexagon, NULL, NULL},
+    {"make_aashape(hex)", 1, 0, bench_aashape, NULL, NULL},
+    {"make_pupil", 1, 0, bench_pupil, NULL, NULL},
+    {"make_pupil_sweep", 8, 0, bench_pupil_sweep, NULL, NULL},
+    {
+        "make_hexsegpupil",
+        1,
+        0,
+        bench_hexsegpupil,
+        bench_hexsegpupil_setup,
+        bench_hexsegpupil_clean
+    },
+    {"make_hexseglabel", 1, 0, bench_hexseglabel, NULL, NULL},
+    {
+        "IMAGE_gen_segments2WFmodes",
+        1,
+        0,
+        bench_segments2WFmodes,
+        bench_segments2WFmodes_setup,
+        bench_segments2WFmodes_clean
+    },
+    {"make_disks", 1, 0, bench_disks, NULL, NULL},
+    {"make_jacquinot_pupil", 1, 0, bench_jacquinot, NULL, NULL},
+    {"make_sectors", 1, 0, bench_sectors, NULL, NULL},
+    {"make_rnd(gauss)", 1, 0, bench_rnd, NULL, NULL},
+    {"make_rnd_double(gauss)", 1, 0, bench_rnd_double, NULL, NULL},
+    {"make_rnd_cbrng(gauss)", 1, 0, bench_rnd_cbrng, NULL, NULL},
+    {"mkrandomim(cbrng_fill_typed)", 1, 1, bench_cbrng_fill, NULL, NULL},
+    {"mkphasescreen(phasescreen_frame)", 1, 1, bench_phasescreen, NULL, NULL},
+    {"make_gauss", 1, 0, bench_gauss, NULL, NULL},
+    {"make_2axis_gauss", 1, 0, bench_2axis_gauss, NULL, NULL},
+    {"make_double_star", 1, 0, bench_double_star, NULL, NULL},
+    {"make_cluster", 1, 0, bench_cluster, NULL, NULL},
+    {"make_galaxy", 1, 0, bench_galaxy, NULL, NULL},
+    {"make_Egalaxy", 1, 0, bench_Egalaxy, NULL, NULL},
+    {"gen_image_EZdisk", 1, 0, bench_EZdisk, NULL, NULL},
+    {"make_slopexy", 1, 0, bench_slopexy, NULL, NULL},
+    {"make_dist", 1, 0, bench_dist, NULL, NULL},
+    {"make_PosAngle", 1, 0, bench_PosAngle, NULL, NULL},
+    {"make_offsetHyperGaussian", 1, 0, bench_offsetHyperGaussian, NULL, NULL},
+    {"make_cosapoedgePupil", 1, 0, bench_cosapoedgePupil, NULL, NULL},
+    {"make_2Dgridpix", 1, 0, bench_2Dgridpix, NULL, NULL},
+    {"image_gen_make_voronoi_map", 1, 0, bench_voronoi, NULL, NULL}
+};
+
+// voronoi input : 200 random points in unit square
+static int imgenbench_vorfile(char *fname)
+{
+    strcpy(fname, "/tmp/imgenbench_vorXXXXXX");
+    int fd = mkstemp(fname);
+    if(fd == -1)
+    {
+        return -1;
+    }
+    FILE *fp = fdopen(fd, "w");
+    if(fp == NULL)
+    {
+        close(fd);
+        return -1;
+    }
+    fprintf(fp, "200\n");
+    for(int k = 0; k < 200; k++)
+    {
+        float xy[2];
+        cbrng_fill_float(xy, 2, CBRNG_DISTRIB_UNIFORM, 7, k);
+        fprintf(fp, "%d %.6f %.6f\n", k, xy[0], xy[1]);
+    }
+    fclose(fp);
+    return 0;
+}
+
+errno_t image_gen_benchmark(const char *fname,
+                            uint32_t    sizemin,
+                            uint32_t    sizemax,
+                            int         nthreadmax,
+                            double      tmin,
+                            double      tmax)
+{
+    FILE *fp;
+    int   nbench  = sizeof(imgenbench_list) / sizeof(imgenbench_list[0]);
+    int   nresult = 0;
+#ifdef HAVE_LIBGOMP
+    int nthread0 = omp_get_max_threads();
+#else
+    nthreadmax = 1;
+#endif
+
+    if((sizemin < 1) || (nthreadmax < 1))
+    {
+        PRINT_ERROR("sizemin and nthreadmax must be >= 1");
+        return RETURN_FAILURE;
+    }
+
+    fp = fopen(fname, "w");
+    if(fp == NULL)
+    {
+        PRINT_ERROR("cannot create file \"%s\"", fname);
+        return RETURN_FAILURE;
+    }
+
+    IMGENBENCH_STATE st;
+    memset(&st, 0, sizeof(st));
+    if(imgenbench_vorfile(st.vorfile) != 0)
+    {
+        PRINT_ERROR("cannot create voronoi point file");
+        fclose(fp);
+        return RETURN_FAILURE;
+    }
+
+    fprintf(fp, "{\n  \"module\": \"image_gen\",\n");
+    fprintf(fp, "  \"tmin\": %g,\n  \"tmax\": %g,\n", tmin, tmax);
+    fprintf(fp,
+            "  \"maxrss_per_case\": %s,\n",
+            (imgenbench_rss_reset() == 0) ? "true" : "false");
+    fprintf(fp, "  \"results\": [");
+
+    printf("%-34s %6s %3s %6s %12s %10s %10s\n",
+           "generator",
+           "size",
+           "thr",
+           "nrun",
+           "time[s]",
+           "Mpix/s",
+           "maxRSS[MB]");
+
+    for(int b = 0; b < nbench; b++)
+    {
+        const IMGENBENCH *bench = &imgenbench_list[b];
+
+        // 1, 2, 4, ... nthreadmax
+        for(int nthread = 1;; nthread *= 2)
+        {
+            if(nthread > nthreadmax)
+            {
+                nthread = nthreadmax;
+            }
+#ifdef HAVE_LIBGOMP
+            omp_set_num_threads(nthread);
+#endif
+            for(uint64_t size = sizemin; size <= sizemax; size *= 2)
+            {
+                double  ttot = 0.0;
+                double  trun = 0.0;
+                long    nrun = 0;
+                uint64_t npix = size * size * bench->nframe;
+
+                st.size = size;
+                if(bench->setup != NULL)
+                {
+                    bench->setup(&st, 1);
+                }
+                imgenbench_rss_reset();
+                if(bench->stream)
+                {
+                    st.buff = (float *) calloc(size * size, sizeof(float));
+                    if(st.buff == NULL)
+                    {
+                        PRINT_ERROR("calloc returns NULL pointer");
+                        abort();
+                    }
+                    // untimed: FFT plan, first touch of buffer
+                    bench->run(&st);
+                }
+
+                while((nrun == 0) || (ttot < tmin))
+                {
+                    double t0 = imgenbench_time();
+                    bench->run(&st);
+                    trun = imgenbench_time() - t0;
+                    ttot += trun;
+                    nrun++;
+                    if(!bench->stream)
+                    {
+                        delete_image_ID(IMGENBENCH_IM,
+                                        DELETE_IMAGE_ERRMODE_WARNING);
+                    }
+                    if(bench->clean != NULL)
+                    {
+                        bench->clean(&st);
+                    }
+                    if(trun > tmax)
+                    {
+                        break;
+                    }
+                }
+
+                if(st.psinit)
+                {
+                    phasescreen_free(&st.ps);
+                    st.psinit = 0;
+                }
+                free(st.buff);
+                st.buff = NULL;
+
+                long   rss = imgenbench_rss_peak();
+                if(bench->setup != NULL)
+                {
+                    bench->setup(&st, 0);
+                }
+                double t   = ttot / nrun;
+                printf("%-34s %6lu %3d %6ld %12.6f %10.2f %10.1f\n",
+                       bench->name,
+                       (unsigned long) size,
+                       nthread,
+                       nrun,
+                       t,
+                       1.0e-6 * npix / t,
+                       rss / 1024.0);
+                fprintf(fp,
+                        "%s\n    {\"generator\": \"%s\", \"size\": %lu, "
+                        "\"nframe\": %d, \"nthread\": %d, \"nrun\": %ld, "
+                        "\"time_s\": %.9f, \"mpix_s\": %.3f, "
+                        "\"maxrss_kB\": %ld}",
+                        (nresult == 0) ? "" : ",",
+                        bench->name,
+                        (unsigned long) size,
+                        bench->nframe,
+                        nthread,
+                        nrun,
+                        t,
+                        1.0e-6 * npix / t,
+                        rss);
+                fflush(fp);
+                nresult++;
+
+                if(trun > tmax)
+                {
+                    // larger sizes skipped
+                    break;
+                }
+            }
+            if(nthread == nthreadmax)
+            {
+                break;
+            }
+        }
+    }
+
+    fprintf(fp, "\n  ]\n}\n");
+    fclose(fp);
+    unlink(st.vorfile);
+
+#ifdef HAVE_LIBGOMP
+    omp_set_num_threads(nthread0);
+#endif
+
+    printf("%d results written to %s\n", nresult, fname);
+
+    return RETURN_SUCCESS;
+}
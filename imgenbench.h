@@ -0,0 +1,23 @@
+#ifndef IMAGE_GEN_IMGENBENCH_H
+#define IMAGE_GEN_IMGENBENCH_H
+
+#include <stdint.h>
+
+/** @brief Benchmark image_gen generators, results written as JSON
+ *
+ * Each generator runs at sizes sizemin, 2 sizemin, ... <= sizemax
+ * (square frames) and thread counts 1, 2, 4, ... nthreadmax. A case is
+ * repeated for at least tmin seconds; once a single run exceeds tmax
+ * seconds, larger sizes are skipped for that generator and thread
+ * count. Reports wall time per run, Mpixel/s and peak RSS of each case
+ * (VmHWM, reset through /proc/self/clear_refs; process lifetime peak
+ * where the reset is not supported, maxrss_per_case false).
+ */
+errno_t image_gen_benchmark(const char *fname,
+                            uint32_t    sizemin,
+                            uint32_t    sizemax,
+                            int         nthreadmax,
+                            double      tmin,
+                            double      tmax);
+
+#endif
@@ -0,0 +1,210 @@
+#include <string.h>
+
+#include "CommandLineInterface/CLIcore.h"
+
+#include "COREMOD_memory/image_keyword_addL.h"
+#include "COREMOD_memory/image_keyword_addS.h"
+
+#include "hexseg.h"
+
+// Local variables pointers
+static LOCVAR_OUTIMG2D outim;
+static char              *coeffname;
+static double            *hexradius;
+static double            *hexgap;
+static double            *hexstep;
+
+
+static CLICMDARGDEF farg[] =
+{
+    FARG_OUTIM2D(outim),
+    {
+        CLIARG_STR,
+        ".coeff",
+        "coefficient stream, float, 3 x nseg (piston, tip, tilt)",
+        "hexsegcoeff",
+        CLIARG_VISIBLE_DEFAULT,
+        (void **) &coeffname,
+        NULL
+    },
+    {
+        CLIARG_FLOAT64,
+        ".radius",
+        "pupil radius [pixel]",
+        "2000.0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &hexradius,
+        NULL
+    },
+    {
+        CLIARG_FLOAT64,
+        ".gap",
+        "gap between segments [pixel]",
+        "2.0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &hexgap,
+        NULL
+    },
+    {
+        CLIARG_FLOAT64,
+        ".step",
+        "segment step [pixel]",
+        "46.3",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &hexstep,
+        NULL
+    }
+};
+
+
+
+static CLICMDDATA CLIcmddata =
+{
+    "mkhexsegphase",
+    "segmented mirror phase from piston/tip/tilt stream",
+    CLICMD_FIELDS_DEFAULTS
+};
+
+
+
+
+/** @brief Detailed help
+ */
+static errno_t help_function()
+{
+    printf("Phase map of hexagonal segmented pupil, segments as\n"
+           "  mkhexsegpup (output size, .radius, .gap, .step).\n"
+           "Coefficients 3k, 3k+1, 3k+2 of .coeff are piston, tip and\n"
+           "  tilt of segment k, in the units of the hexpupif influence\n"
+           "  functions: tip / tilt are normalized to unit rms over the\n"
+           "  segment, about its centroid.\n");
+    printf("Each frame is one parallel pass over the segment label map,\n"
+           "  cost independent of the number of segments. Set the\n"
+           "  procinfo trigger to the .coeff stream to run at loop rate.\n");
+    return RETURN_SUCCESS;
+}
+
+
+
+
+static errno_t compute_function()
+{
+    DEBUG_TRACE_FSTART();
+
+    if(*outim.xsize != *outim.ysize)
+    {
+        PRINT_ERROR("output %s must be square", outim.name);
+        DEBUG_TRACE_FEXIT();
+        return RETURN_FAILURE;
+    }
+    uint32_t size = *outim.xsize;
+
+    IMGID img  = makeIMGID_2D(outim.name, size, size);
+    img.shared = *outim.shared;
+    img.NBkw   = *outim.NBkw;
+    img.CBsize = *outim.CBsize;
+
+    // Create image if needed
+    imcreateIMGID(&img);
+
+    if((img.md->datatype != _DATATYPE_FLOAT) || (img.md->size[0] != size) ||
+            (img.md->size[1] != size))
+    {
+        PRINT_ERROR("stream %s must be float, size %u x %u",
+                    outim.name,
+                    size,
+                    size);
+        DEBUG_TRACE_FEXIT();
+        return RETURN_FAILURE;
+    }
+
+    HEXSEGGEOM geom;
+    hexseg_geom(&geom, size, *hexradius, *hexgap, *hexstep);
+    long nseg = geom.hs.nseg;
+
+    imageID IDc = image_ID(coeffname);
+    if(IDc == -1)
+    {
+        PRINT_ERROR("coefficient stream %s not found", coeffname);
+        hexseg_geom_free(&geom);
+        DEBUG_TRACE_FEXIT();
+        return RETURN_FAILURE;
+    }
+    if((data.image[IDc].md->datatype != _DATATYPE_FLOAT) ||
+            (data.image[IDc].md->nelement < (uint64_t) 3 * nseg))
+    {
+        PRINT_ERROR("coefficient stream %s must be float, >= %ld elements",
+                    coeffname,
+                    3 * nseg);
+        hexseg_geom_free(&geom);
+        DEBUG_TRACE_FEXIT();
+        return RETURN_FAILURE;
+    }
+
+    // per label : piston, tip and tilt slopes, centroid
+    // label 0 (outside segments) stays zero
+    double *segc = (double *) calloc(5 * (nseg + 1), sizeof(double));
+    if(segc == NULL)
+    {
+        PRINT_ERROR("calloc returns NULL pointer");
+        abort();
+    }
+    for(long seg = 0; seg < nseg; seg++)
+    {
+        segc[5 * (seg + 1) + 3] = geom.mom[seg].xc;
+        segc[5 * (seg + 1) + 4] = geom.mom[seg].yc;
+    }
+
+    image_keyword_addS(img, "MILKFUNC", "mkhexsegphase", "MILK function");
+    image_keyword_addL(img, "HEXNSEG", nseg, "number of segments");
+
+    INSERT_STD_PROCINFO_COMPUTEFUNC_START
+
+    const float *coeff = data.image[IDc].array.F;
+    for(long seg = 0; seg < nseg; seg++)
+    {
+        double *c = segc + 5 * (seg + 1);
+
+        c[0] = coeff[3 * seg];
+        c[1] = coeff[3 * seg + 1] * geom.mom[seg].gx;
+        c[2] = coeff[3 * seg + 2] * geom.mom[seg].gy;
+    }
+
+    img.md->write = 1;
+    float *phase  = img.im->array.F;
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for(uint32_t jj = 0; jj < size; jj++)
+    {
+        const int32_t *lrow = geom.label + (uint64_t) jj * size;
+        float         *prow = phase + (uint64_t) jj * size;
+
+        for(uint32_t ii = 0; ii < size; ii++)
+        {
+            const double *c = segc + 5 * lrow[ii];
+
+            prow[ii] = c[0] + c[1] * (ii - c[3]) + c[2] * (jj - c[4]);
+        }
+    }
+
+    processinfo_update_output_stream(processinfo, img.ID);
+
+    INSERT_STD_PROCINFO_COMPUTEFUNC_END
+
+    free(segc);
+    hexseg_geom_free(&geom);
+
+    DEBUG_TRACE_FEXIT();
+    return RETURN_SUCCESS;
+}
+
+INSERT_STD_FPSCLIfunctions
+
+// Register function in CLI
+errno_t
+CLIADDCMD_image_gen__mkhexsegphase()
+{
+    INSERT_STD_CLIREGISTERFUNC
+    return RETURN_SUCCESS;
+}
@@ -0,0 +1,275 @@
+#include <string.h>
+
+#include "CommandLineInterface/CLIcore.h"
+
+#include "COREMOD_memory/image_keyword_addD.h"
+#include "COREMOD_memory/image_keyword_addL.h"
+#include "COREMOD_memory/image_keyword_addS.h"
+
+#include "cbrng.h"
+#include "phasescreen.h"
+
+// Local variables pointers
+static LOCVAR_OUTIMG2D outim;
+static double            *psr0;
+static double            *psalpha;
+static double            *psL0;
+static uint32_t          *pspad;
+static uint32_t          *psmode;
+static uint32_t          *psdir;
+static uint32_t          *psarorder;
+static double            *psvel;
+static uint32_t          *rngmode;
+static uint64_t          *rngseed;
+static uint64_t          *frame0;
+
+
+static CLICMDARGDEF farg[] =
+{
+    FARG_OUTIM2D(outim),
+    {
+        CLIARG_FLOAT64,
+        ".r0",
+        "Fried parameter [pixel]",
+        "10.0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &psr0,
+        NULL
+    },
+    {
+        CLIARG_FLOAT64,
+        ".alpha",
+        "PSD power law exponent (11/3: Kolmogorov)",
+        "3.6666667",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &psalpha,
+        NULL
+    },
+    {
+        CLIARG_FLOAT64,
+        ".L0",
+        "outer scale [pixel] (0: infinite)",
+        "0.0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &psL0,
+        NULL
+    },
+    {
+        CLIARG_UINT32,
+        ".pad",
+        "FFT size / output size",
+        "2",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &pspad,
+        NULL
+    },
+    {
+        CLIARG_UINT32,
+        ".mode",
+        "0: independent frames (FFT), 1: scrolling screen",
+        "0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &psmode,
+        NULL
+    },
+    {
+        CLIARG_UINT32,
+        ".dir",
+        "scrolling: 0 new rows, 1 new columns",
+        "0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &psdir,
+        NULL
+    },
+    {
+        CLIARG_UINT32,
+        ".arorder",
+        "scrolling: autoregressive model order",
+        "4",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &psarorder,
+        NULL
+    },
+    {
+        CLIARG_FLOAT64,
+        ".vel",
+        "scrolling: velocity [pixel/frame]",
+        "1.0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &psvel,
+        NULL
+    },
+    {
+        CLIARG_UINT32,
+        ".rng",
+        "random generator seed\n"
+        " (0: drawn from global ran1 state)\n"
+        " (1: explicit, .seed)\n",
+        "0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &rngmode,
+        NULL
+    },
+    {
+        CLIARG_UINT64,
+        ".seed",
+        "counter-based generator seed (.rng 1), < 2^63",
+        "0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &rngseed,
+        NULL
+    },
+    {
+        CLIARG_UINT64,
+        ".frame0",
+        "FFT mode: first frame index",
+        "0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &frame0,
+        NULL
+    }
+};
+
+
+
+static CLICMDDATA CLIcmddata =
+{
+    "mkphasescreen", "make power-law phase screen", CLICMD_FIELDS_DEFAULTS
+};
+
+
+
+
+/** @brief Detailed help
+ */
+static errno_t help_function()
+{
+    printf("Phase screen [rad] with power spectral density\n"
+           "  0.0229 r0^(2-alpha) (f^2 + 1/L0^2)^(-alpha/2), f in\n"
+           "  cycle/pixel. alpha = 11/3 is Kolmogorov / von Karman,\n"
+           "  other exponents give 1/f^alpha noise.\n");
+    printf("Mode 0: each frame is an independent screen, computed by FFT\n"
+           "  of size .pad x output size (one FFT per two frames). Frame\n"
+           "  N is a pure function of (RNDSEED, N).\n"
+           "Mode 1: frozen flow. Each frame shifts the screen by .vel\n"
+           "  pixel toward row (.dir 0) or column (.dir 1) 0, new lines\n"
+           "  are extruded at the opposite edge. A new line costs one FFT\n"
+           "  of .pad x line length, the screen never repeats.\n");
+    return RETURN_SUCCESS;
+}
+
+
+
+
+static errno_t compute_function()
+{
+    DEBUG_TRACE_FSTART();
+
+    IMGID img  = makeIMGID_2D(outim.name, *outim.xsize, *outim.ysize);
+    img.shared = *outim.shared;
+    img.NBkw   = *outim.NBkw;
+    img.CBsize = *outim.CBsize;
+
+    // Create image if needed
+    imcreateIMGID(&img);
+
+    if(img.md->datatype != _DATATYPE_FLOAT)
+    {
+        PRINT_ERROR("stream %s must be float", outim.name);
+        DEBUG_TRACE_FEXIT();
+        return RETURN_FAILURE;
+    }
+
+    uint64_t seed = *rngseed;
+    if(*rngmode == 0)
+    {
+        seed = cbrng_seed_ran1();
+    }
+    else if(seed > CBRNG_SEED_MAX)
+    {
+        PRINT_ERROR("seed must be < 2^63 to be recorded in RNDSEED");
+        DEBUG_TRACE_FEXIT();
+        return RETURN_FAILURE;
+    }
+
+    PHASESCREEN_PARAM psparam;
+    psparam.r0      = *psr0;
+    psparam.alpha   = *psalpha;
+    psparam.L0      = *psL0;
+    psparam.pad     = *pspad;
+    psparam.mode    = (*psmode == 1) ? PHASESCREEN_MODE_SCROLL
+                      : PHASESCREEN_MODE_FFT;
+    psparam.dir     = (*psdir == 1) ? 1 : 0;
+    psparam.arorder = *psarorder;
+    psparam.vel     = *psvel;
+
+    PHASESCREEN ps;
+    if(phasescreen_init(&ps,
+                        img.md->size[0],
+                        img.md->size[1],
+                        &psparam,
+                        seed) != RETURN_SUCCESS)
+    {
+        phasescreen_free(&ps);
+        DEBUG_TRACE_FEXIT();
+        return RETURN_FAILURE;
+    }
+    if(psparam.mode == PHASESCREEN_MODE_FFT)
+    {
+        phasescreen_seek(&ps, *frame0);
+    }
+
+    image_keyword_addS(img, "MILKFUNC", "mkphasescreen", "MILK function");
+    image_keyword_addD(img, "PSR0", psparam.r0, "Fried parameter [pix]");
+    image_keyword_addD(img, "PSALPHA", psparam.alpha, "PSD exponent");
+    image_keyword_addD(img, "PSL0", psparam.L0, "outer scale [pix]");
+    image_keyword_addL(img, "PSMODE", (long) psparam.mode, "0:FFT 1:scroll");
+    image_keyword_addS(img, "RNDGEN", "philox4x32-10", "random generator");
+    image_keyword_addL(img,
+                       "RNDSEED",
+                       (long) seed,
+                       "random generator seed (< 2^63)");
+    image_keyword_addL(img,
+                       "RNDFRAME",
+                       (long) ps.frame,
+                       "random generator frame index");
+
+    // RNDFRAME keyword, updated with each frame
+    IMAGE_KEYWORD *kwframe = NULL;
+    for(int kw = 0; kw < img.md->NBkw; kw++)
+    {
+        if(strcmp(img.im->kw[kw].name, "RNDFRAME") == 0)
+        {
+            kwframe = &img.im->kw[kw];
+            break;
+        }
+    }
+
+    INSERT_STD_PROCINFO_COMPUTEFUNC_START
+
+    img.md->write = 1;
+    if(kwframe != NULL)
+    {
+        kwframe->value.numl = (int64_t) ps.frame;
+    }
+    phasescreen_frame(&ps, img.im->array.F);
+
+    processinfo_update_output_stream(processinfo, img.ID);
+
+    INSERT_STD_PROCINFO_COMPUTEFUNC_END
+
+    phasescreen_free(&ps);
+
+    DEBUG_TRACE_FEXIT();
+    return RETURN_SUCCESS;
+}
+
+INSERT_STD_FPSCLIfunctions
+
+// Register function in CLI
+errno_t
+CLIADDCMD_image_gen__mkphasescreen()
+{
+    INSERT_STD_CLIREGISTERFUNC
+    return RETURN_SUCCESS;
+}
@@ -0,0 +1,6 @@
+#ifndef IMAGE_GEN_MKPHASESCREEN_H
+#define IMAGE_GEN_MKPHASESCREEN_H
+
+errno_t CLIADDCMD_image_gen__mkphasescreen();
+
+#endif
@@ -1,12 +1,35 @@
+#include <string.h>
+#include <time.h>
+
 #include "CommandLineInterface/CLIcore.h"
 #include "statistic/statistic.h"
 
+#include "COREMOD_memory/image_keyword_addD.h"
 #include "COREMOD_memory/image_keyword_addL.h"
 #include "COREMOD_memory/image_keyword_addS.h"
 
+#include "cbrng.h"
+#include "image_gen/image_gen.h"
+#include "testpattern.h"
+
 // Local variables pointers
 static LOCVAR_OUTIMG2D outim;
 static uint32_t          *distrib;
+static uint32_t          *rngmode;
+static uint64_t          *rngseed;
+static uint64_t          *frame0;
+static double            *streamfps;
+static uint32_t          *streamnbuff;
+static uint32_t          *streamspinus;
+static uint32_t          *banksize;
+static double            *distp1;
+static double            *distp2;
+static char              *distp1im;
+static char              *outdatatype;
+static double            *outscale;
+static double            *outoffset;
+static uint32_t          *tppattern;
+static uint32_t          *tpsize;
 
 
 static CLICMDARGDEF farg[] =
@@ -15,14 +38,150 @@ static CLICMDARGDEF farg[] =
     {
         CLIARG_UINT32,
         ".distrib",
-        "distribution \n"
-        " (0: uniform)\n"
-        " (1: gauss)\n"
-        " (2: truncated gauss)\n",
+        "distribution\n"
+        " 0:uniform 1:gauss 2:trgauss 3:test\n"
+        " 4:Poisson 5:exp 6:gamma 7:Rayleigh 8:integer\n",
         "0",
         CLIARG_HIDDEN_DEFAULT,
         (void **) &distrib,
         NULL
+    },
+    {
+        CLIARG_FLOAT64,
+        ".p1",
+        "distribution parameter 1",
+        "1.0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &distp1,
+        NULL
+    },
+    {
+        CLIARG_FLOAT64,
+        ".p2",
+        "distribution parameter 2",
+        "1.0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &distp2,
+        NULL
+    },
+    {
+        CLIARG_STR,
+        ".p1im",
+        "per-pixel parameter 1 image, float (null: use .p1)",
+        "null",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &distp1im,
+        NULL
+    },
+    {
+        CLIARG_STR,
+        ".datatype",
+        "output datatype (FLOAT DOUBLE HALF UINT8 INT8 UINT16 INT16 ...)",
+        "FLOAT",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &outdatatype,
+        NULL
+    },
+    {
+        CLIARG_FLOAT64,
+        ".scale",
+        "output value = scale * random value + offset",
+        "1.0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &outscale,
+        NULL
+    },
+    {
+        CLIARG_FLOAT64,
+        ".offset",
+        "output value = scale * random value + offset",
+        "0.0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &outoffset,
+        NULL
+    },
+    {
+        CLIARG_UINT32,
+        ".rng",
+        "random generator seed\n"
+        " (0: drawn from global ran1 state)\n"
+        " (1: explicit, .seed)\n",
+        "0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &rngmode,
+        NULL
+    },
+    {
+        CLIARG_UINT64,
+        ".seed",
+        "counter-based generator seed, < 2^63",
+        "0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &rngseed,
+        NULL
+    },
+    {
+        CLIARG_UINT64,
+        ".frame0",
+        "index of first frame (replay from frame N)",
+        "0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &frame0,
+        NULL
+    },
+    {
+        CLIARG_FLOAT64,
+        ".fps",
+        "streaming frame rate [Hz] (0: paced by processinfo loop)",
+        "0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &streamfps,
+        NULL
+    },
+    {
+        CLIARG_UINT32,
+        ".nbuff",
+        "streaming: frames generated ahead (0: use output CBsize)",
+        "0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &streamnbuff,
+        NULL
+    },
+    {
+        CLIARG_UINT32,
+        ".spinus",
+        "streaming: busy-wait margin before frame deadline [us]",
+        "100",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &streamspinus,
+        NULL
+    },
+    {
+        CLIARG_UINT32,
+        ".bank",
+        "noise bank size [frames] (0: compute every frame)",
+        "0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &banksize,
+        NULL
+    },
+    {
+        CLIARG_UINT32,
+        ".pattern",
+        "test pattern (distrib 3) 0: pixel flip 1: spot 2: checkerboard",
+        "0",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &tppattern,
+        NULL
+    },
+    {
+        CLIARG_UINT32,
+        ".tpsize",
+        "test pattern spot / checkerboard square size [pixel]",
+        "8",
+        CLIARG_HIDDEN_DEFAULT,
+        (void **) &tpsize,
+        NULL
     }
 };
 
@@ -40,6 +199,43 @@ static CLICMDDATA CLIcmddata =
  */
 static errno_t help_function()
 {
+    printf("Output is written in the stream datatype (.datatype) as\n"
+           "  .scale * value + .offset, rounded and saturated for integer\n"
+           "  types, saturated to +/-65504 for HALF. The test pattern\n"
+           "  (distribution 3) is FLOAT only.\n");
+    printf("Frame N of a run is a pure function of (RNDSEED, N) and of the\n"
+           "  distribution settings. RNDSEED and RNDFRAME keywords record\n"
+           "  them; rerun with .rng 1, .seed RNDSEED and .frame0 N to\n"
+           "  regenerate the sequence from frame N, or use mkrndimframe to\n"
+           "  compute a single frame.\n");
+    printf("Distributions 4 to 8 (see cbrng.h) take parameters .p1 and\n"
+           "  .p2: Poisson mean p1, exponential mean p1, gamma shape p1\n"
+           "  and scale p2, Rayleigh sigma p1, integers in [p1, p2] (bounds\n"
+           "  and count of values at most 2^24). If .p1im names a float\n"
+           "  image of the output size, it provides a per-pixel p1 (for\n"
+           "  example the Poisson mean, or the number of input electrons\n"
+           "  for EMCCD gain with distribution 6).\n");
+    printf("Streaming mode (.fps > 0):\n"
+           "  frames are generated ahead into a ring of .nbuff frames\n"
+           "  (default: output CBsize, minimum 2). At each frame deadline,\n"
+           "  the next ready frame is copied to the output and its\n"
+           "  semaphores are posted once. Remaining time before the next\n"
+           "  deadline is used to refill the ring.\n"
+           "Noise bank mode (.bank > 0):\n"
+           "  .bank frames are computed at startup. Each output frame is\n"
+           "  a randomly selected bank frame, cyclically shifted by a\n"
+           "  random offset, optionally flipped and, for distributions\n"
+           "  0 to 2, sign-reversed (1-x for uniform distribution). Frames\n"
+           "  are built with memory copies. Not used with .p1im.\n");
+    printf("Test pattern (.distrib 3):\n"
+           "  .pattern 0 toggles one pixel per frame, 1 draws a .tpsize\n"
+           "  spot moving by one pixel per frame, 2 draws a checkerboard\n"
+           "  of .tpsize squares inverted every frame. Pixels 0 to 8 hold\n"
+           "  marker 0x7E57, frame counter and CLOCK_MONOTONIC write time\n"
+           "  [ns] as 16-bit words, least significant first (see\n"
+           "  testpattern.h); keywords RNDFRAME and TPTIMENS hold the same\n"
+           "  values. Readers get latency from the write time and dropped\n"
+           "  frames from counter gaps.\n");
     return RETURN_SUCCESS;
 }
 
@@ -47,6 +243,18 @@ static errno_t help_function()
 
 
 
+/**
+ * @brief Output format
+ */
+typedef struct
+{
+    uint8_t datatype;
+    size_t  esize;   // bytes per element
+    double  scale;
+    double  offset;
+    int     direct;  // float, unit scale, zero offset
+} RNDOUTFMT;
+
 /**
  * @brief Make random image
  *
@@ -57,11 +265,27 @@ static errno_t help_function()
  * @param[in] pdf
  *      Probability distribution function
  *
+ * @param[in] param
+ *      Distribution parameters (pdf >= 4)
+ *
+ * @param[in] fmt
+ *      Output datatype and scaling
+ *
+ * @param[in] seed
+ *      Counter-based generator seed
+ *
+ * @param[in] frame
+ *      Counter-based generator frame index
+ *
  * @return imageID
  */
 static imageID make_image_random(
     IMGID *img,
-    int pdf
+    int pdf,
+    const CBRNG_PARAM *param,
+    const RNDOUTFMT *fmt,
+    uint64_t seed,
+    uint64_t frame
 )
 {
     DEBUG_TRACE_FSTART();
@@ -69,46 +293,309 @@ static imageID make_image_random(
     // 0: uniform
     // 1: gauss
     // 2: truncated gauss
+    // 3: test pattern
+    // 4-8: see cbrng.h
 
     // Create image if needed
     imcreateIMGID(img);
 
+    if(pdf != 3)
+    {
+        cbrng_fill_typed(img->im->array.raw,
+                         fmt->datatype,
+                         img->md->nelement,
+                         pdf,
+                         param,
+                         fmt->scale,
+                         fmt->offset,
+                         seed,
+                         frame);
+    }
+    if(pdf == 3)  // test pattern
+    {
+        testpattern_draw(img->im->array.F,
+                         img->md->size[0],
+                         img->md->size[1],
+                         (int)(*tppattern),
+                         *tpsize,
+                         frame);
+    }
 
-    // openMP is slow when calling gsl random number generator : do not use openMP here
-    if(pdf == 0)
+    DEBUG_TRACE_FEXIT();
+    return (img->ID);
+}
+
+/**
+ * @brief Pre-computed noise frames (noise bank mode)
+ */
+typedef struct
+{
+    float   *frames;   // nframe frames
+    uint32_t nframe;
+    uint32_t xsize;
+    uint32_t ysize;
+    int      pdf;
+    uint64_t seed;     // bank frame selection seed
+} NOISEBANK;
+
+static void noisebank_init(NOISEBANK *bank,
+                           uint32_t   nframe,
+                           uint32_t   xsize,
+                           uint32_t   ysize,
+                           int        pdf,
+                           const CBRNG_PARAM *param,
+                           uint64_t   seed)
+{
+    uint64_t nelement = (uint64_t) xsize * ysize;
+
+    bank->nframe = nframe;
+    bank->xsize  = xsize;
+    bank->ysize  = ysize;
+    bank->pdf    = pdf;
+    bank->seed   = seed;
+    bank->frames = (float *) malloc(sizeof(float) * nelement * nframe);
+    if(bank->frames == NULL)
     {
-        for(uint64_t ii = 0; ii < img->md->nelement; ii++)
-        {
-            img->im->array.F[ii] = (float) ran1();
-        }
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
     }
-    if(pdf == 1)
+
+    printf("computing noise bank: %u frames\n", nframe);
+    for(uint32_t k = 0; k < nframe; k++)
     {
-        for(uint64_t ii = 0; ii < img->md->nelement; ii++)
+        cbrng_fill_float_param(bank->frames + k * nelement,
+                               nelement,
+                               pdf,
+                               param,
+                               seed,
+                               k);
+    }
+}
+
+/**
+ * @brief Copy n bank values to element ii0 of array
+ *
+ * signmode 0: x, 1: -x, 2: 1-x, followed by output conversion. Plain
+ * memcpy for float output without sign change.
+ */
+static void noisebank_copy(void            *array,
+                           const RNDOUTFMT *fmt,
+                           uint64_t         ii0,
+                           const float     *src,
+                           uint32_t         n,
+                           int              signmode)
+{
+    if((signmode == 0) && (fmt->direct == 1))
+    {
+        memcpy((float *) array + ii0, src, sizeof(float) * n);
+        return;
+    }
+
+    float a = (signmode == 2) ? 1.0f : 0.0f;
+    float b = (signmode == 0) ? 1.0f : -1.0f;
+    float tmp[1024];
+
+    for(uint32_t i0 = 0; i0 < n; i0 += 1024)
+    {
+        uint32_t m = n - i0;
+        if(m > 1024)
         {
-            img->im->array.F[ii] = (float) gauss();
+            m = 1024;
         }
+        for(uint32_t ii = 0; ii < m; ii++)
+        {
+            tmp[ii] = a + b * src[i0 + ii];
+        }
+        cbrng_store_typed(array,
+                          fmt->datatype,
+                          ii0 + i0,
+                          tmp,
+                          m,
+                          fmt->scale,
+                          fmt->offset);
+    }
+}
+
+/**
+ * @brief Build frame from noise bank
+ *
+ * Bank frame, offsets, flip and sign are drawn from the counter-based
+ * generator with the frame index as counter, so the output sequence is
+ * reproducible. Each row is built from two contiguous segments of a bank
+ * row, copied with memcpy for float output.
+ */
+static void noisebank_frame(const NOISEBANK *bank,
+                            void            *array,
+                            const RNDOUTFMT *fmt,
+                            uint64_t         frame)
+{
+    uint32_t ctr[4];
+    uint32_t key[2];
+    uint32_t rnd[4];
+
+    ctr[0] = (uint32_t) frame;
+    ctr[1] = (uint32_t)(frame >> 32);
+    ctr[2] = 0;
+    ctr[3] = 0x4e4f4953; // separates selection draws from pixel draws
+    key[0] = (uint32_t) bank->seed;
+    key[1] = (uint32_t)(bank->seed >> 32);
+    cbrng_philox4x32(ctr, key, rnd);
+
+    uint32_t xsize = bank->xsize;
+    uint32_t ysize = bank->ysize;
+    uint32_t k     = rnd[0] % bank->nframe;
+    uint32_t dx    = rnd[1] % xsize;
+    uint32_t dy    = rnd[2] % ysize;
+    int      flip  = rnd[3] & 1;
+    // sign reversal for symmetric distributions only
+    // uniform distribution is reflected about 0.5
+    int signmode = 0;
+    if(((rnd[3] >> 1) & 1) && (bank->pdf < 3))
+    {
+        signmode = (bank->pdf == 0) ? 2 : 1;
+    }
+
+    const float *src0 = bank->frames + (uint64_t) k * xsize * ysize;
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for(uint32_t jj = 0; jj < ysize; jj++)
+    {
+        uint32_t     jj1 = flip ? (ysize - 1 - jj) : jj;
+        const float *src = src0 + (uint64_t)((jj1 + dy) % ysize) * xsize;
+        uint64_t     ii0 = (uint64_t) jj * xsize;
+
+        noisebank_copy(array, fmt, ii0, src + dx, xsize - dx, signmode);
+        noisebank_copy(array, fmt, ii0 + xsize - dx, src, dx, signmode);
     }
-    if(pdf == 2)
+}
+
+/**
+ * @brief Frames generated ahead of publication (streaming mode)
+ */
+typedef struct
+{
+    char    *buff;    // nslot frames, output datatype
+    uint64_t nelement;
+    uint32_t nslot;
+    uint32_t nready;  // generated, not yet published
+    uint32_t rdslot;  // next slot to publish
+    uint64_t frame;   // counter-based frame index of next generated frame
+    int64_t  tgenns;  // last frame generation time [ns]
+    const NOISEBANK *bank; // NULL if frames are computed
+    const CBRNG_PARAM *param;
+    const RNDOUTFMT   *fmt;
+    uint64_t seed;
+} RNDSTREAM_RING;
+
+static inline int64_t timespec_diff_ns(const struct timespec *t1,
+                                       const struct timespec *t0)
+{
+    return (int64_t)(t1->tv_sec - t0->tv_sec) * 1000000000L +
+           (t1->tv_nsec - t0->tv_nsec);
+}
+
+static inline void timespec_add_ns(struct timespec *t, int64_t ns)
+{
+    ns += t->tv_nsec;
+    t->tv_sec += ns / 1000000000L;
+    t->tv_nsec = ns % 1000000000L;
+    if(t->tv_nsec < 0)
     {
-        for(uint64_t ii = 0; ii < img->md->nelement; ii++)
+        t->tv_sec--;
+        t->tv_nsec += 1000000000L;
+    }
+}
+
+/**
+ * @brief Generate frames into free ring slots
+ *
+ * Generates at most maxcnt frames. Stops when the ring is full or, if
+ * deadline is not NULL, when the next frame would not be complete before
+ * the deadline. Returns number of frames generated.
+ */
+static uint32_t rndstream_ring_fill(RNDSTREAM_RING        *ring,
+                                    const struct timespec *deadline,
+                                    uint32_t               maxcnt)
+{
+    uint32_t cnt = 0;
+
+    while((ring->nready < ring->nslot) && (cnt < maxcnt))
+    {
+        struct timespec t0, t1;
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        if(deadline != NULL)
+        {
+            if(timespec_diff_ns(deadline, &t0) < ring->tgenns)
+            {
+                break;
+            }
+        }
+
+        uint32_t wrslot = (ring->rdslot + ring->nready) % ring->nslot;
+        char    *wrbuff = ring->buff +
+                          (uint64_t) wrslot * ring->nelement * ring->fmt->esize;
+        if(ring->bank != NULL)
+        {
+            noisebank_frame(ring->bank, wrbuff, ring->fmt, ring->frame);
+        }
+        else
         {
-            img->im->array.F[ii] = (float) gauss_trc();
+            cbrng_fill_typed(wrbuff,
+                             ring->fmt->datatype,
+                             ring->nelement,
+                             *distrib,
+                             ring->param,
+                             ring->fmt->scale,
+                             ring->fmt->offset,
+                             ring->seed,
+                             ring->frame);
         }
+        ring->frame++;
+        ring->nready++;
+        cnt++;
+
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        ring->tgenns = timespec_diff_ns(&t1, &t0);
     }
-    if(pdf == 3)  // test pattern
+
+    return cnt;
+}
+
+/**
+ * @brief Sleep until absolute CLOCK_MONOTONIC time t
+ *
+ * Sleeps until spinns before t, then busy-waits to reduce wake-up jitter.
+ */
+static void rndstream_wait_until(const struct timespec *t, int64_t spinns)
+{
+    struct timespec tsleep = *t;
+    struct timespec tnow;
+
+    timespec_add_ns(&tsleep, -spinns);
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tsleep, NULL);
+    do
     {
-        static uint64_t ii   = 0;
-        img->im->array.F[ii] = 1.0 - img->im->array.F[ii];
-        ii++;
-        if(ii == img->md->nelement)
+        clock_gettime(CLOCK_MONOTONIC, &tnow);
+    }
+    while(timespec_diff_ns(t, &tnow) > 0);
+}
+
+/**
+ * @brief Keyword of output image, NULL if not found
+ */
+static IMAGE_KEYWORD *image_keyword_find(IMGID img, const char *name)
+{
+    for(int kw = 0; kw < img.md->NBkw; kw++)
+    {
+        if(strcmp(img.im->kw[kw].name, name) == 0)
         {
-            ii = 0;
+            return &img.im->kw[kw];
         }
     }
-
-    DEBUG_TRACE_FEXIT();
-    return (img->ID);
+    return NULL;
 }
 
 static errno_t compute_function()
@@ -121,23 +608,259 @@ static errno_t compute_function()
     img.NBkw   = *outim.NBkw;
     img.CBsize = *outim.CBsize;
 
+    uint8_t datatype = image_gen_datatype_from_name(outdatatype);
+    if((datatype == 0) || (cbrng_datatype_size(datatype) == 0))
+    {
+        PRINT_ERROR("datatype %s not supported", outdatatype);
+        DEBUG_TRACE_FEXIT();
+        return RETURN_FAILURE;
+    }
+    if((*distrib == 3) && (datatype != _DATATYPE_FLOAT))
+    {
+        printf("test pattern is float only, using FLOAT\n");
+        datatype = _DATATYPE_FLOAT;
+    }
+    img.datatype = datatype;
+
     // Create image if needed
     imcreateIMGID(&img);
 
+    // output format, from existing stream if already created
+    RNDOUTFMT outfmt;
+    outfmt.datatype = img.md->datatype;
+    outfmt.esize    = cbrng_datatype_size(outfmt.datatype);
+    outfmt.scale    = *outscale;
+    outfmt.offset   = *outoffset;
+    outfmt.direct   = ((outfmt.datatype == _DATATYPE_FLOAT) &&
+                       (outfmt.scale == 1.0) && (outfmt.offset == 0.0));
+    if((outfmt.esize == 0) ||
+            ((*distrib == 3) && (outfmt.datatype != _DATATYPE_FLOAT)))
+    {
+        PRINT_ERROR("stream %s datatype %d not supported",
+                    outim.name,
+                    (int) outfmt.datatype);
+        DEBUG_TRACE_FEXIT();
+        return RETURN_FAILURE;
+    }
+
+    // generator seed, recorded so that any frame can be regenerated
+    uint64_t seed = *rngseed;
+    if(*rngmode == 0)
+    {
+        seed = cbrng_seed_ran1();
+    }
+    else if(seed > CBRNG_SEED_MAX)
+    {
+        PRINT_ERROR("seed must be < 2^63 to be recorded in RNDSEED");
+        DEBUG_TRACE_FEXIT();
+        return RETURN_FAILURE;
+    }
+
+    // counter-based generator frame index, O(1) jump to frame0
+    uint64_t frame = *frame0;
+
     image_keyword_addS(img, "MILKFUNC", "mkrandomim", "MILK function");
     image_keyword_addL(img,
                        "RNDPDF",
                        (long)(*distrib),
                        "random value distribution");
+    image_keyword_addS(img, "RNDGEN", "philox4x32-10", "random generator");
+    image_keyword_addL(img,
+                       "RNDSEED",
+                       (long) seed,
+                       "random generator seed (< 2^63)");
+    image_keyword_addD(img, "RNDP1", *distp1, "distribution parameter 1");
+    image_keyword_addD(img, "RNDP2", *distp2, "distribution parameter 2");
+    image_keyword_addL(img,
+                       "RNDBANK",
+                       (long)(*banksize),
+                       "noise bank size, 0 if unused");
+    image_keyword_addD(img, "RNDSCALE", outfmt.scale, "output scale");
+    image_keyword_addD(img, "RNDOFFS", outfmt.offset, "output offset");
+    image_keyword_addL(img,
+                       "RNDFRAME",
+                       (long) frame,
+                       "random generator frame index");
+
+    // test pattern write time
+    if(*distrib == 3)
+    {
+        image_keyword_addL(img,
+                           "TPTIMENS",
+                           0,
+                           "test pattern write time [ns] (monotonic)");
+        if(img.md->nelement < TESTPATTERN_NRESERVED)
+        {
+            printf("image too small for test pattern stamp\n");
+        }
+    }
+
+    // keywords updated with each frame
+    IMAGE_KEYWORD *kwframe = image_keyword_find(img, "RNDFRAME");
+    IMAGE_KEYWORD *kwtime  = image_keyword_find(img, "TPTIMENS");
+
+    // distribution parameters
+    CBRNG_PARAM rndparam;
+    rndparam.p1    = *distp1;
+    rndparam.p2    = *distp2;
+    rndparam.p1map = NULL;
+    if(strcmp(distp1im, "null") != 0)
+    {
+        imageID IDp1 = image_ID(distp1im);
+        if(IDp1 == -1)
+        {
+            PRINT_ERROR("parameter image %s not found", distp1im);
+            DEBUG_TRACE_FEXIT();
+            return RETURN_FAILURE;
+        }
+        if((data.image[IDp1].md->datatype != _DATATYPE_FLOAT) ||
+                (data.image[IDp1].md->nelement != img.md->nelement))
+        {
+            PRINT_ERROR("parameter image %s must be float, size %u x %u",
+                        distp1im,
+                        *outim.xsize,
+                        *outim.ysize);
+            DEBUG_TRACE_FEXIT();
+            return RETURN_FAILURE;
+        }
+        rndparam.p1map = data.image[IDp1].array.F;
+    }
+
+    // noise bank mode : output frames assembled from pre-computed frames
+    NOISEBANK  bankdata;
+    NOISEBANK *bank = NULL;
+
+    if((*banksize > 0) && (*distrib != 3) && (rndparam.p1map == NULL))
+    {
+        noisebank_init(&bankdata,
+                       *banksize,
+                       img.md->size[0],
+                       img.md->size[1],
+                       *distrib,
+                       &rndparam,
+                       seed);
+        bank = &bankdata;
+    }
+
+    // streaming mode : paced output from ring of pre-computed frames
+    int             streammode = 0;
+    RNDSTREAM_RING  ring;
+    int64_t         periodns = 0;
+    struct timespec tnext;
+    uint64_t        nlate = 0;
+
+    if((*streamfps > 0.0) && (*distrib != 3))
+    {
+        streammode    = 1;
+        periodns      = (int64_t)(1.0e9 / (*streamfps));
+        ring.nelement = img.md->nelement;
+        ring.nslot    = (*streamnbuff > 0) ? *streamnbuff : *outim.CBsize;
+        if(ring.nslot < 2)
+        {
+            ring.nslot = 2;
+        }
+        ring.nready = 0;
+        ring.rdslot = 0;
+        ring.frame  = frame;
+        ring.tgenns = 0;
+        ring.bank   = bank;
+        ring.param  = &rndparam;
+        ring.fmt    = &outfmt;
+        ring.seed   = seed;
+        ring.buff   = (char *) malloc(outfmt.esize * ring.nelement *
+                                      ring.nslot);
+        if(ring.buff == NULL)
+        {
+            PRINT_ERROR("malloc returns NULL pointer");
+            abort();
+        }
+        printf("streaming at %.1f Hz, %u frames ahead\n",
+               *streamfps,
+               ring.nslot);
+
+        rndstream_ring_fill(&ring, NULL, ring.nslot);
+        clock_gettime(CLOCK_MONOTONIC, &tnext);
+    }
 
     INSERT_STD_PROCINFO_COMPUTEFUNC_START
 
-    make_image_random(&img, *distrib);
+    if(streammode == 1)
+    {
+        struct timespec tnow;
+
+        timespec_add_ns(&tnext, periodns);
+        clock_gettime(CLOCK_MONOTONIC, &tnow);
+        if(timespec_diff_ns(&tnow, &tnext) > periodns)
+        {
+            // more than one period late : resynchronize
+            nlate++;
+            tnext = tnow;
+        }
+        rndstream_wait_until(&tnext, 1000L * (*streamspinus));
+
+        if(ring.nready == 0)
+        {
+            // generation could not keep up : frame is late
+            nlate++;
+            rndstream_ring_fill(&ring, NULL, 1);
+        }
+
+        img.md->write = 1;
+        memcpy(img.im->array.raw,
+               ring.buff + (uint64_t) ring.rdslot * ring.nelement *
+               outfmt.esize,
+               outfmt.esize * ring.nelement);
+        ring.rdslot = (ring.rdslot + 1) % ring.nslot;
+        ring.nready--;
+    }
+    else if(bank != NULL)
+    {
+        img.md->write = 1;
+        noisebank_frame(bank, img.im->array.raw, &outfmt, frame);
+    }
+    else
+    {
+        make_image_random(&img, *distrib, &rndparam, &outfmt, seed, frame);
+    }
+    if(*distrib == 3)
+    {
+        // stamped last, just before semaphores are posted
+        uint64_t tns = testpattern_stamp(img.im->array.F,
+                                         img.md->nelement,
+                                         frame);
+        if(kwtime != NULL)
+        {
+            kwtime->value.numl = (int64_t) tns;
+        }
+    }
+    if(kwframe != NULL)
+    {
+        kwframe->value.numl = (int64_t) frame;
+    }
+    frame++;
 
     DEBUG_TRACEPOINT("update output ID %ld", img.ID);
     processinfo_update_output_stream(processinfo, img.ID);
+
+    if(streammode == 1)
+    {
+        // refill ring ahead of next deadline
+        struct timespec tfill = tnext;
+        timespec_add_ns(&tfill, periodns - 1000L * (*streamspinus));
+        rndstream_ring_fill(&ring, &tfill, ring.nslot);
+    }
     INSERT_STD_PROCINFO_COMPUTEFUNC_END
 
+    if(streammode == 1)
+    {
+        printf("%lu late frames\n", (unsigned long) nlate);
+        free(ring.buff);
+    }
+    if(bank != NULL)
+    {
+        free(bank->frames);
+    }
+
     DEBUG_TRACE_FEXIT();
     return RETURN_SUCCESS;
 }
@@ -0,0 +1,517 @@
+/**
+ * @file    phasescreen.c
+ * @brief   Power-law phase screens and correlated noise
+ *
+ * FFT mode: complex white noise from the counter-based generator is
+ * multiplied by sqrt(PSD) and inverse transformed. Real and imaginary
+ * parts of the result are two independent screens, so one FFT provides
+ * two frames. Screens are periodic over the FFT size (see pad).
+ *
+ * Scroll mode: the screen is extended one line at a time along the flow
+ * direction. Along a line, the screen is represented by its nfft Fourier
+ * coefficients. Along the flow direction, each coefficient is a
+ * stationary process, modelled as an autoregressive process of order
+ * arorder whose coefficients are fitted (Levinson-Durbin) to the exact
+ * autocorrelation of that Fourier mode. A new line costs one nfft-point
+ * FFT and O(arorder nfft) operations instead of a full 2D FFT, and the
+ * screen never repeats along the flow direction. The first lines use the
+ * lower order predictors of the recursion, so the screen is stationary
+ * from the first frame.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include <fftw3.h>
+
+#include "CommandLineInterface/CLIcore.h"
+
+#include "cbrng.h"
+#include "phasescreen.h"
+
+// Kolmogorov phase PSD constant
+#define PHASESCREEN_KOLMO 0.0229
+
+// along-flow extent of the virtual screen used for autocorrelations
+#define PHASESCREEN_VIRTUAL_MIN 16
+
+static double phasescreen_psd(const PHASESCREEN_PARAM *param,
+                              double                   fx,
+                              double                   fy)
+{
+    double f0  = (param->L0 > 0.0) ? 1.0 / param->L0 : 0.0;
+    double ff2 = fx * fx + fy * fy + f0 * f0;
+
+    if(ff2 == 0.0)
+    {
+        return 0.0;
+    }
+    return PHASESCREEN_KOLMO * pow(param->r0, 2.0 - param->alpha) *
+           pow(ff2, -0.5 * param->alpha);
+}
+
+/**
+ * @brief PSD averaged over frequency cell [fx - dfx/2, fx + dfx/2] at fy
+ *
+ * Near the origin the PSD varies strongly across the cell, and sampling
+ * it at the cell center would put far too much power in the low-order
+ * along-line modes. The cell integral is evaluated with fx = c tan(t),
+ * c^2 = fy^2 + 1/L0^2, which removes the peak.
+ */
+static double phasescreen_psd_cell(const PHASESCREEN_PARAM *param,
+                                   double                   fx,
+                                   double                   dfx,
+                                   double                   fy)
+{
+    double f0    = (param->L0 > 0.0) ? 1.0 / param->L0 : 0.0;
+    double c2    = fy * fy + f0 * f0;
+    double alpha = param->alpha;
+    double amp   = PHASESCREEN_KOLMO * pow(param->r0, 2.0 - alpha);
+
+    if((fabs(fx) > 4.0 * dfx) || (c2 > 16.0 * dfx * dfx))
+    {
+        return phasescreen_psd(param, fx, fy);
+    }
+    if(c2 == 0.0)
+    {
+        if(fx == 0.0)
+        {
+            // piston
+            return 0.0;
+        }
+        // cell does not contain origin : integral of f^-alpha
+        double fa = fabs(fx) - 0.5 * dfx;
+        double fb = fabs(fx) + 0.5 * dfx;
+        if(alpha == 1.0)
+        {
+            return amp * log(fb / fa) / dfx;
+        }
+        return amp * (pow(fb, 1.0 - alpha) - pow(fa, 1.0 - alpha)) /
+               ((1.0 - alpha) * dfx);
+    }
+
+    // Simpson rule over t
+    int    nstep = 32;
+    double c     = sqrt(c2);
+    double ta    = atan((fx - 0.5 * dfx) / c);
+    double tb    = atan((fx + 0.5 * dfx) / c);
+    double h     = (tb - ta) / nstep;
+    double sum   = 0.0;
+    for(int i = 0; i <= nstep; i++)
+    {
+        double w = ((i == 0) || (i == nstep)) ? 1.0 : ((i % 2) ? 4.0 : 2.0);
+        sum += w * pow(cos(ta + i * h), alpha - 2.0);
+    }
+
+    return amp * pow(c, 1.0 - alpha) * sum * h / 3.0 / dfx;
+}
+
+// frequency of FFT index k for size n [cycle/pixel]
+static inline double phasescreen_freq(uint32_t k, uint32_t n)
+{
+    int64_t kk = (k < (n + 1) / 2) ? (int64_t) k : (int64_t) k - n;
+    return (double) kk / n;
+}
+
+static errno_t phasescreen_init_fft(PHASESCREEN *ps)
+{
+    uint32_t nfx  = ps->param.pad * ps->xsize;
+    uint32_t nfy  = ps->param.pad * ps->ysize;
+    double   df2  = 1.0 / ((double) nfx * nfy);
+
+    ps->nfx    = nfx;
+    ps->nfy    = nfy;
+    ps->pair   = -1;
+    ps->filter = (float *) malloc(sizeof(float) * nfx * nfy);
+    ps->buff   = fftwf_malloc(sizeof(fftwf_complex) * nfx * nfy);
+    if((ps->filter == NULL) || (ps->buff == NULL))
+    {
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
+    }
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for(uint32_t ky = 0; ky < nfy; ky++)
+    {
+        double fy = phasescreen_freq(ky, nfy);
+        for(uint32_t kx = 0; kx < nfx; kx++)
+        {
+            double fx = phasescreen_freq(kx, nfx);
+            ps->filter[(uint64_t) ky * nfx + kx] =
+                (float) sqrt(phasescreen_psd(&ps->param, fx, fy) * df2);
+        }
+    }
+    // piston
+    ps->filter[0] = 0.0f;
+
+    ps->plan = fftwf_plan_dft_2d(nfy,
+                                 nfx,
+                                 ps->buff,
+                                 ps->buff,
+                                 FFTW_BACKWARD,
+                                 FFTW_MEASURE);
+
+    return RETURN_SUCCESS;
+}
+
+/**
+ * @brief Along-flow autocorrelation of each line Fourier mode
+ *
+ * r[d * nfft + k], d = 0..P, summed over a virtual screen of nvirt lines
+ * (periodic, band-limited to the pixel Nyquist frequency). Along the
+ * line, the PSD is averaged over each FFT frequency cell.
+ */
+static void phasescreen_autocorr(const PHASESCREEN_PARAM *param,
+                                 uint32_t                 nfft,
+                                 uint32_t                 P,
+                                 double                  *r)
+{
+    uint32_t nvirt = PHASESCREEN_VIRTUAL_MIN * nfft;
+    if(nvirt < 8.0 * param->L0)
+    {
+        nvirt = (uint32_t) ceil(8.0 * param->L0);
+    }
+
+    double *ctab = (double *) malloc(sizeof(double) * nvirt);
+    if(ctab == NULL)
+    {
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
+    }
+    for(uint32_t j = 0; j < nvirt; j++)
+    {
+        ctab[j] = cos(2.0 * M_PI * j / nvirt);
+    }
+
+    double df2 = 1.0 / ((double) nfft * nvirt);
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for schedule(dynamic)
+#endif
+    for(uint32_t k = 0; k <= nfft / 2; k++)
+    {
+        double fx = (double) k / nfft;
+        double rk[PHASESCREEN_AR_MAXORDER + 1];
+
+        for(uint32_t d = 0; d <= P; d++)
+        {
+            rk[d] = 0.0;
+        }
+        for(uint32_t j = 0; j < nvirt; j++)
+        {
+            // fy = j / nvirt, wrapped to [-0.5, 0.5)
+            double psd = phasescreen_psd_cell(param,
+                                              fx,
+                                              1.0 / nfft,
+                                              phasescreen_freq(j, nvirt)) *
+                         df2;
+            for(uint32_t d = 0; d <= P; d++)
+            {
+                rk[d] += psd * ctab[((uint64_t) j * d) % nvirt];
+            }
+        }
+        for(uint32_t d = 0; d <= P; d++)
+        {
+            r[(uint64_t) d * nfft + k] = rk[d];
+            // PSD is even in fx
+            r[(uint64_t) d * nfft + (nfft - k) % nfft] = rk[d];
+        }
+    }
+
+    free(ctab);
+}
+
+static errno_t phasescreen_init_scroll(PHASESCREEN *ps)
+{
+    uint32_t P = ps->param.arorder;
+
+    if((P < 1) || (P > PHASESCREEN_AR_MAXORDER))
+    {
+        PRINT_ERROR("AR order %u out of range [1, %d]",
+                    P,
+                    PHASESCREEN_AR_MAXORDER);
+        return RETURN_FAILURE;
+    }
+
+    if(ps->param.dir == 0)
+    {
+        ps->linesize = ps->xsize;
+        ps->nline    = ps->ysize;
+    }
+    else
+    {
+        ps->linesize = ps->ysize;
+        ps->nline    = ps->xsize;
+    }
+    uint32_t nfft = ps->param.pad * ps->linesize;
+    ps->nfft      = nfft;
+
+    ps->arcoeff = (float *) malloc(sizeof(float) * P * P * nfft);
+    ps->innov   = (float *) malloc(sizeof(float) * (P + 1) * nfft);
+    ps->lines   = (float *) malloc(sizeof(float) * ps->nline * ps->linesize);
+    ps->state   = fftwf_malloc(sizeof(fftwf_complex) * P * nfft);
+    ps->buff    = fftwf_malloc(sizeof(fftwf_complex) * nfft);
+    double *r   = (double *) malloc(sizeof(double) * (P + 1) * nfft);
+    if((ps->arcoeff == NULL) || (ps->innov == NULL) || (ps->lines == NULL)
+            || (ps->state == NULL) || (ps->buff == NULL) || (r == NULL))
+    {
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
+    }
+    memset(ps->arcoeff, 0, sizeof(float) * P * P * nfft);
+
+    phasescreen_autocorr(&ps->param, nfft, P, r);
+
+    // Levinson-Durbin recursion, predictors of order 1 to P
+    for(uint32_t k = 0; k < nfft; k++)
+    {
+        double a[PHASESCREEN_AR_MAXORDER + 1];
+        double atmp[PHASESCREEN_AR_MAXORDER + 1];
+        double e  = r[k];
+        double e0 = e;
+
+        ps->innov[k] = (float) sqrt(e);
+        for(uint32_t m = 1; m <= P; m++)
+        {
+            double kappa = 0.0;
+            // stop refining once prediction error is negligible
+            if(e > 1e-12 * e0)
+            {
+                kappa = r[(uint64_t) m * nfft + k];
+                for(uint32_t i = 1; i < m; i++)
+                {
+                    kappa -= a[i] * r[(uint64_t)(m - i) * nfft + k];
+                }
+                kappa /= e;
+            }
+            for(uint32_t i = 1; i < m; i++)
+            {
+                atmp[i] = a[i] - kappa * a[m - i];
+            }
+            for(uint32_t i = 1; i < m; i++)
+            {
+                a[i] = atmp[i];
+            }
+            a[m] = kappa;
+            e *= (1.0 - kappa * kappa);
+            if(e < 0.0)
+            {
+                e = 0.0;
+            }
+
+            for(uint32_t i = 1; i <= m; i++)
+            {
+                ps->arcoeff[((uint64_t)(m - 1) * P + (i - 1)) * nfft + k] =
+                    (float) a[i];
+            }
+            ps->innov[(uint64_t) m * nfft + k] = (float) sqrt(e);
+        }
+    }
+    free(r);
+
+    ps->plan = fftwf_plan_dft_1d(nfft,
+                                 ps->buff,
+                                 ps->buff,
+                                 FFTW_BACKWARD,
+                                 FFTW_MEASURE);
+
+    ps->nlinegen = 0;
+    ps->pos      = 0.0;
+
+    return RETURN_SUCCESS;
+}
+
+errno_t phasescreen_init(PHASESCREEN             *ps,
+                         uint32_t                 xsize,
+                         uint32_t                 ysize,
+                         const PHASESCREEN_PARAM *param,
+                         uint64_t                 seed)
+{
+    memset(ps, 0, sizeof(PHASESCREEN));
+    ps->param = *param;
+    ps->xsize = xsize;
+    ps->ysize = ysize;
+    ps->seed  = seed;
+    ps->frame = 0;
+
+    if(ps->param.pad < 1)
+    {
+        ps->param.pad = 1;
+    }
+    if((param->r0 <= 0.0) || (param->vel < 0.0))
+    {
+        PRINT_ERROR("r0 must be > 0, vel >= 0");
+        return RETURN_FAILURE;
+    }
+
+    if(param->mode == PHASESCREEN_MODE_SCROLL)
+    {
+        return phasescreen_init_scroll(ps);
+    }
+    return phasescreen_init_fft(ps);
+}
+
+/**
+ * @brief Extrude next line into the line ring
+ *
+ * Line n draws its innovations from generator frame n.
+ */
+static void phasescreen_scroll_line(PHASESCREEN *ps)
+{
+    uint32_t nfft = ps->nfft;
+    uint32_t P    = ps->param.arorder;
+    uint64_t n    = ps->nlinegen;
+    uint32_t m    = (n < P) ? (uint32_t) n : P;
+    float   *b    = (float *) ps->buff;
+
+    cbrng_fill_float(b, 2 * nfft, CBRNG_DISTRIB_GAUSS, ps->seed, n);
+
+    const float *g = ps->innov + (uint64_t) m * nfft;
+    for(uint32_t k = 0; k < nfft; k++)
+    {
+        b[2 * k]     *= g[k];
+        b[2 * k + 1] *= g[k];
+    }
+    for(uint32_t i = 1; i <= m; i++)
+    {
+        const float *a =
+            ps->arcoeff + ((uint64_t)(m - 1) * P + (i - 1)) * nfft;
+        const float *s = (float *)(ps->state + ((n - i) % P) * nfft);
+        for(uint32_t k = 0; k < nfft; k++)
+        {
+            b[2 * k]     += a[k] * s[2 * k];
+            b[2 * k + 1] += a[k] * s[2 * k + 1];
+        }
+    }
+    memcpy(ps->state + (n % P) * nfft, b, sizeof(fftwf_complex) * nfft);
+
+    fftwf_execute(ps->plan);
+
+    float *line = ps->lines + (n % ps->nline) * ps->linesize;
+    for(uint32_t ii = 0; ii < ps->linesize; ii++)
+    {
+        line[ii] = b[2 * ii];
+    }
+    ps->nlinegen++;
+}
+
+static void phasescreen_frame_scroll(PHASESCREEN *ps, float *array)
+{
+    uint64_t target = ps->nline;
+
+    if(ps->frame > 0)
+    {
+        ps->pos += ps->param.vel;
+        target  += (uint64_t) ps->pos;
+    }
+    while(ps->nlinegen < target)
+    {
+        phasescreen_scroll_line(ps);
+    }
+
+    // oldest line first, new lines enter at the last row / column
+    uint64_t n0       = ps->nlinegen - ps->nline;
+    uint32_t linesize = ps->linesize;
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for(uint32_t q = 0; q < ps->nline; q++)
+    {
+        const float *line = ps->lines + ((n0 + q) % ps->nline) * linesize;
+        if(ps->param.dir == 0)
+        {
+            memcpy(array + (uint64_t) q * linesize,
+                   line,
+                   sizeof(float) * linesize);
+        }
+        else
+        {
+            for(uint32_t jj = 0; jj < linesize; jj++)
+            {
+                array[(uint64_t) jj * ps->xsize + q] = line[jj];
+            }
+        }
+    }
+}
+
+static void phasescreen_frame_fft(PHASESCREEN *ps, float *array)
+{
+    int64_t  pair  = (int64_t)(ps->frame / 2);
+    int      part  = (int)(ps->frame % 2);
+    uint64_t nelem = (uint64_t) ps->nfx * ps->nfy;
+
+    if(pair != ps->pair)
+    {
+        float *b = (float *) ps->buff;
+
+        cbrng_fill_float(b, 2 * nelem, CBRNG_DISTRIB_GAUSS, ps->seed, pair);
+#ifdef HAVE_LIBGOMP
+        #pragma omp parallel for schedule(static)
+#endif
+        for(uint64_t ii = 0; ii < nelem; ii++)
+        {
+            b[2 * ii]     *= ps->filter[ii];
+            b[2 * ii + 1] *= ps->filter[ii];
+        }
+        fftwf_execute(ps->plan);
+        ps->pair = pair;
+    }
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for(uint32_t jj = 0; jj < ps->ysize; jj++)
+    {
+        const float *src = (float *)(ps->buff + (uint64_t) jj * ps->nfx);
+        float       *dst = array + (uint64_t) jj * ps->xsize;
+        for(uint32_t ii = 0; ii < ps->xsize; ii++)
+        {
+            dst[ii] = src[2 * ii + part];
+        }
+    }
+}
+
+errno_t phasescreen_frame(PHASESCREEN *ps, float *array)
+{
+    if(ps->param.mode == PHASESCREEN_MODE_SCROLL)
+    {
+        phasescreen_frame_scroll(ps, array);
+    }
+    else
+    {
+        phasescreen_frame_fft(ps, array);
+    }
+    ps->frame++;
+
+    return RETURN_SUCCESS;
+}
+
+errno_t phasescreen_seek(PHASESCREEN *ps, uint64_t frame)
+{
+    if(ps->param.mode == PHASESCREEN_MODE_SCROLL)
+    {
+        PRINT_ERROR("scroll mode frames are sequential");
+        return RETURN_FAILURE;
+    }
+    ps->frame = frame;
+
+    return RETURN_SUCCESS;
+}
+
+void phasescreen_free(PHASESCREEN *ps)
+{
+    if(ps->buff != NULL)
+    {
+        fftwf_destroy_plan(ps->plan);
+        fftwf_free(ps->buff);
+    }
+    fftwf_free(ps->state);
+    free(ps->filter);
+    free(ps->arcoeff);
+    free(ps->innov);
+    free(ps->lines);
+    memset(ps, 0, sizeof(PHASESCREEN));
+}
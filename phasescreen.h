@@ -0,0 +1,84 @@
+#ifndef IMAGE_GEN_PHASESCREEN_H
+#define IMAGE_GEN_PHASESCREEN_H
+
+#include <stdint.h>
+
+#include <fftw3.h>
+
+/** @file phasescreen.h
+ * @brief Power-law phase screens and correlated noise
+ *
+ * Screens have power spectral density
+ *   PSD(f) = 0.0229 r0^(2-alpha) (f^2 + 1/L0^2)^(-alpha/2)
+ * with f in cycle/pixel and r0, L0 in pixel. alpha = 11/3 is the
+ * Kolmogorov / von Karman phase spectrum [rad^2], other exponents give
+ * 1/f^alpha noise.
+ */
+
+// one full FFT per pair of frames
+#define PHASESCREEN_MODE_FFT    0
+// new lines extruded at the screen edge (frozen flow)
+#define PHASESCREEN_MODE_SCROLL 1
+
+#define PHASESCREEN_AR_MAXORDER 16
+
+typedef struct
+{
+    double   r0;      // Fried parameter [pixel]
+    double   alpha;   // PSD exponent
+    double   L0;      // outer scale [pixel], 0: pure power law
+    uint32_t pad;     // FFT size / output size, >= 1
+    int      mode;    // PHASESCREEN_MODE_*
+    int      dir;     // scroll mode: 0 new rows, 1 new columns
+    uint32_t arorder; // scroll mode autoregressive order
+    double   vel;     // scroll mode velocity [line/frame]
+} PHASESCREEN_PARAM;
+
+typedef struct
+{
+    PHASESCREEN_PARAM param;
+    uint32_t          xsize;
+    uint32_t          ysize;
+    uint64_t          seed;
+    uint64_t          frame;  // next output frame
+
+    fftwf_complex *buff;
+    fftwf_plan     plan;
+
+    // FFT mode
+    uint32_t nfx;
+    uint32_t nfy;
+    float   *filter;  // sqrt(PSD df^2) on FFT grid
+    int64_t  pair;    // frame pair held in buff, -1 if none
+
+    // scroll mode
+    uint32_t       nfft;      // line FFT size
+    uint32_t       linesize;  // output line length
+    uint32_t       nline;     // output lines along flow
+    float         *arcoeff;   // [order-1][lag-1][mode]
+    float         *innov;     // innovation std dev [order][mode]
+    fftwf_complex *state;     // last arorder lines, mode coefficients
+    float         *lines;     // ring of nline output lines
+    uint64_t       nlinegen;  // lines generated
+    double         pos;       // scroll position [line]
+} PHASESCREEN;
+
+errno_t phasescreen_init(PHASESCREEN             *ps,
+                         uint32_t                 xsize,
+                         uint32_t                 ysize,
+                         const PHASESCREEN_PARAM *param,
+                         uint64_t                 seed);
+
+/** @brief Compute next frame into array (xsize x ysize)
+ *
+ * FFT mode frames are a pure function of (seed, frame), see
+ * phasescreen_seek. Scroll mode frames follow each other.
+ */
+errno_t phasescreen_frame(PHASESCREEN *ps, float *array);
+
+// FFT mode : set next output frame
+errno_t phasescreen_seek(PHASESCREEN *ps, uint64_t frame);
+
+void phasescreen_free(PHASESCREEN *ps);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef IMAGE_GEN_PIXCOVERAGE_H
+#define IMAGE_GEN_PIXCOVERAGE_H
+
+/** @file pixcoverage.h
+ * @brief Exact area of shapes over pixels
+ */
+
+/** @brief Area of disk of given radius, centered at origin, inside
+ * rectangle [x0, x1] x [y0, y1] (x0 <= x1, y0 <= y1)
+ */
+double pixcoverage_disk_rect(double x0,
+                             double x1,
+                             double y0,
+                             double y1,
+                             double radius);
+
+/** @brief Fraction of unit pixel centered at (dx, dy) from disk center
+ * that lies within the disk
+ */
+double pixcoverage_disk(double dx, double dy, double radius);
+
+#endif
@@ -0,0 +1,528 @@
+/**
+ * @file    sdfraster.c
+ * @brief   Anti-aliased shape rasterization from signed distance functions
+ *
+ * Coverage table: for an edge of unit normal (na, nb), na >= nb >= 0,
+ * the covered fraction of the pixel is the distribution function of
+ * na x + nb y over the unit square, a trapezoid integral in closed form.
+ * The table is indexed by q = nb / na in [0, 1] (no angle evaluation)
+ * and by d in [-SDF_DMAX, SDF_DMAX]; pixels farther than SDF_DMAX (half
+ * pixel diagonal) from the edge are fully covered or empty.
+ *
+ * All shape functions return the exact Euclidean distance, and a shape
+ * with holes uses max(d, -d_hole), which remains 1-Lipschitz. A pixel at
+ * distance |d| is thus followed along the row by |d| - SDF_DMAX pixels on
+ * the same side: rows are filled in runs, and the SDF is only evaluated near
+ * the edge and once per run.
+ *
+ * Near an edge, coverage is computed per shape rather than from the
+ * nearest boundary, so that a pixel seeing both edges of a vane or line
+ * narrower than a pixel diagonal gets the slab area (see
+ * sdf_shape_coverage_cs).
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "CommandLineInterface/CLIcore.h"
+
+#include "sdfraster.h"
+
+#define SDF_DMAX 0.70710679
+
+#define SDF_COVTAB_ND 512
+#define SDF_COVTAB_NQ 32
+
+static float          sdf_covtab[(SDF_COVTAB_NQ + 1) * (SDF_COVTAB_ND + 1)];
+static pthread_once_t sdf_covtab_once = PTHREAD_ONCE_INIT;
+
+// area of unit pixel where na x + nb y < -d, na >= nb >= 0, na^2+nb^2=1
+static double sdf_halfplane_area(double d, double na, double nb)
+{
+    double t = -d + 0.5 * (na + nb);
+
+    if(t <= 0.0)
+    {
+        return 0.0;
+    }
+    if(t >= na + nb)
+    {
+        return 1.0;
+    }
+    if(t <= nb)
+    {
+        return t * t / (2.0 * na * nb);
+    }
+    if(t <= na)
+    {
+        return (t - 0.5 * nb) / na;
+    }
+    return 1.0 - (na + nb - t) * (na + nb - t) / (2.0 * na * nb);
+}
+
+static void sdf_covtab_init()
+{
+    for(int iq = 0; iq <= SDF_COVTAB_NQ; iq++)
+    {
+        double q  = 1.0 * iq / SDF_COVTAB_NQ;
+        double na = 1.0 / sqrt(1.0 + q * q);
+        double nb = q * na;
+        for(int id = 0; id <= SDF_COVTAB_ND; id++)
+        {
+            double d = SDF_DMAX * (2.0 * id / SDF_COVTAB_ND - 1.0);
+            sdf_covtab[iq * (SDF_COVTAB_ND + 1) + id] =
+                (float) sdf_halfplane_area(d, na, nb);
+        }
+    }
+}
+
+float sdf_coverage(double d, double nx, double ny)
+{
+    if(d <= -SDF_DMAX)
+    {
+        return 1.0f;
+    }
+    if(d >= SDF_DMAX)
+    {
+        return 0.0f;
+    }
+
+    double ax = fabs(nx);
+    double ay = fabs(ny);
+    double q  = (ax > ay) ? ay / ax : ((ay > 0.0) ? ax / ay : 0.0);
+
+    double tq = q * SDF_COVTAB_NQ;
+    double td = (d + SDF_DMAX) * (0.5 * SDF_COVTAB_ND / SDF_DMAX);
+    int    iq = (int) tq;
+    int    id = (int) td;
+    if(iq >= SDF_COVTAB_NQ)
+    {
+        iq = SDF_COVTAB_NQ - 1;
+    }
+    if(id >= SDF_COVTAB_ND)
+    {
+        id = SDF_COVTAB_ND - 1;
+    }
+    double fq = tq - iq;
+    double fd = td - id;
+
+    const float *c = sdf_covtab + iq * (SDF_COVTAB_ND + 1) + id;
+    double       c0 = c[0] + fd * (c[1] - c[0]);
+    double       c1 = c[SDF_COVTAB_ND + 1] +
+                      fd * (c[SDF_COVTAB_ND + 2] - c[SDF_COVTAB_ND + 1]);
+
+    return (float)(c0 + fq * (c1 - c0));
+}
+
+void sdf_shape_line(SDF_SHAPE *shape,
+                    double     x1,
+                    double     y1,
+                    double     x2,
+                    double     y2,
+                    double     t)
+{
+    shape->type  = SDF_SHAPE_RECT;
+    shape->xc    = 0.5 * (x1 + x2);
+    shape->yc    = 0.5 * (y1 + y2);
+    shape->angle = atan2(y2 - y1, x2 - x1);
+    shape->a     = 0.5 * sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+    shape->b     = 0.5 * t;
+}
+
+// rectangle, half-widths (a, b), p in first quadrant
+static double sdf_rect(double  px,
+                       double  py,
+                       double  a,
+                       double  b,
+                       double *nx,
+                       double *ny)
+{
+    double qx = px - a;
+    double qy = py - b;
+
+    if((qx > 0.0) && (qy > 0.0))
+    {
+        double d = sqrt(qx * qx + qy * qy);
+        *nx      = qx / d;
+        *ny      = qy / d;
+        return d;
+    }
+    if(qx > qy)
+    {
+        *nx = 1.0;
+        *ny = 0.0;
+        return qx;
+    }
+    *nx = 0.0;
+    *ny = 1.0;
+    return qy;
+}
+
+// hexagon of inner radius r, flat sides at y = +/-r, p in first quadrant
+static double sdf_hexagon(double  px,
+                          double  py,
+                          double  r,
+                          double *nx,
+                          double *ny)
+{
+    // unit normal of the slanted side, and half side length / r
+    const double kx = -0.866025403784439;
+    const double ky = 0.5;
+    const double kz = 0.577350269189626;
+
+    // fold onto the sector of the top side
+    double dk   = kx * px + ky * py;
+    int    refl = 0;
+    if(dk < 0.0)
+    {
+        px -= 2.0 * dk * kx;
+        py -= 2.0 * dk * ky;
+        refl = 1;
+    }
+
+    double cx = px;
+    if(cx < -kz * r)
+    {
+        cx = -kz * r;
+    }
+    if(cx > kz * r)
+    {
+        cx = kz * r;
+    }
+    double vx = px - cx;
+    double vy = py - r;
+    double vn = sqrt(vx * vx + vy * vy);
+    double d  = (vy < 0.0) ? -vn : vn;
+
+    double gx = 0.0;
+    double gy = 1.0;
+    if((vy >= 0.0) && (vn > 0.0))
+    {
+        // beyond a vertex
+        gx = vx / vn;
+        gy = vy / vn;
+    }
+    if(refl)
+    {
+        double dg = kx * gx + ky * gy;
+        gx -= 2.0 * dg * kx;
+        gy -= 2.0 * dg * ky;
+    }
+    *nx = gx;
+    *ny = gy;
+
+    return d;
+}
+
+// c, s: cos and sin of shape angle
+static double sdf_shape_eval_cs(const SDF_SHAPE *shape,
+                                double           c,
+                                double           s,
+                                double           x,
+                                double           y,
+                                double          *nx,
+                                double          *ny)
+{
+    double dx = x - shape->xc;
+    double dy = y - shape->yc;
+    // shape frame
+    double px = c * dx + s * dy;
+    double py = -s * dx + c * dy;
+    double gx, gy, d;
+
+    switch(shape->type)
+    {
+        case SDF_SHAPE_DISK:
+        {
+            double r = sqrt(px * px + py * py);
+            d        = r - shape->a;
+            gx       = (r > 0.0) ? px / r : 1.0;
+            gy       = (r > 0.0) ? py / r : 0.0;
+        }
+        break;
+
+        case SDF_SHAPE_HEXAGON:
+            d  = sdf_hexagon(fabs(px), fabs(py), shape->a, &gx, &gy);
+            gx = (px < 0.0) ? -gx : gx;
+            gy = (py < 0.0) ? -gy : gy;
+            break;
+
+        default:
+            d  = sdf_rect(fabs(px), fabs(py), shape->a, shape->b, &gx, &gy);
+            gx = (px < 0.0) ? -gx : gx;
+            gy = (py < 0.0) ? -gy : gy;
+            break;
+    }
+
+    // back to image frame
+    *nx = c * gx - s * gy;
+    *ny = s * gx + c * gy;
+
+    return d;
+}
+
+double sdf_shape_eval(const SDF_SHAPE *shape,
+                      double           x,
+                      double           y,
+                      double          *nx,
+                      double          *ny)
+{
+    return sdf_shape_eval_cs(shape,
+                             cos(shape->angle),
+                             sin(shape->angle),
+                             x,
+                             y,
+                             nx,
+                             ny);
+}
+
+void sdf_shape_bbox(const SDF_SHAPE *shape,
+                    uint32_t         xsize,
+                    uint32_t         ysize,
+                    long            *i0,
+                    long            *i1,
+                    long            *j0,
+                    long            *j1)
+{
+    double c = fabs(cos(shape->angle));
+    double s = fabs(sin(shape->angle));
+    double hx, hy;
+
+    switch(shape->type)
+    {
+        case SDF_SHAPE_DISK:
+            hx = shape->a;
+            hy = shape->a;
+            break;
+
+        case SDF_SHAPE_HEXAGON:
+            // circumscribed circle
+            hx = shape->a * 1.154700538379252;
+            hy = hx;
+            break;
+
+        default:
+            hx = shape->a * c + shape->b * s;
+            hy = shape->a * s + shape->b * c;
+            break;
+    }
+
+    *i0 = (long) floor(shape->xc - hx - 1.0);
+    *i1 = (long) ceil(shape->xc + hx + 1.0) + 1;
+    *j0 = (long) floor(shape->yc - hy - 1.0);
+    *j1 = (long) ceil(shape->yc + hy + 1.0) + 1;
+
+    *i0 = (*i0 < 0) ? 0 : ((*i0 > (long) xsize) ? (long) xsize : *i0);
+    *i1 = (*i1 < 0) ? 0 : ((*i1 > (long) xsize) ? (long) xsize : *i1);
+    *j0 = (*j0 < 0) ? 0 : ((*j0 > (long) ysize) ? (long) ysize : *j0);
+    *j1 = (*j1 < 0) ? 0 : ((*j1 > (long) ysize) ? (long) ysize : *j1);
+}
+
+/**
+ * @brief Pixel coverage of a single shape
+ *
+ * A rectangle is the intersection of two slabs. Each slab coverage is
+ * c1 + c2 - 1 from its two parallel edges, exact for any width: the
+ * half-planes cover the pixel together, so the overlap area is the sum
+ * minus one. Slab coverages are multiplied, exact for axis-aligned
+ * rectangles. Other shapes take the coverage of the nearest edge.
+ */
+static float sdf_shape_coverage_cs(const SDF_SHAPE *shape,
+                                   double           c,
+                                   double           s,
+                                   double           x,
+                                   double           y)
+{
+    if(shape->type == SDF_SHAPE_RECT)
+    {
+        double dx = x - shape->xc;
+        double dy = y - shape->yc;
+        double px = c * dx + s * dy;
+        double py = -s * dx + c * dy;
+        float  ca = sdf_coverage(px - shape->a, c, s) +
+                    sdf_coverage(-px - shape->a, c, s) - 1.0f;
+        float  cb = sdf_coverage(py - shape->b, s, c) +
+                    sdf_coverage(-py - shape->b, s, c) - 1.0f;
+
+        ca = (ca > 0.0f) ? ca : 0.0f;
+        cb = (cb > 0.0f) ? cb : 0.0f;
+        return ca * cb;
+    }
+
+    double nx, ny;
+    double d = sdf_shape_eval_cs(shape, c, s, x, y, &nx, &ny);
+    return sdf_coverage(d, nx, ny);
+}
+
+// coverage of shape times uncovered fraction of the most covering hole
+static float sdf_region_coverage(const SDF_SHAPE *shape,
+                                 const SDF_SHAPE *holes,
+                                 long             nhole,
+                                 const double    *cs,
+                                 double           x,
+                                 double           y)
+{
+    float v = sdf_shape_coverage_cs(shape, cs[0], cs[1], x, y);
+    float h = 0.0f;
+
+    for(long k = 0; k < nhole; k++)
+    {
+        float ch = sdf_shape_coverage_cs(&holes[k],
+                                         cs[2 * k + 2],
+                                         cs[2 * k + 3],
+                                         x,
+                                         y);
+        if(ch > h)
+        {
+            h = ch;
+        }
+    }
+
+    return v * (1.0f - h);
+}
+
+// shape minus holes: max(d, -d_hole), cs: cos, sin of each angle
+static double sdf_region_eval(const SDF_SHAPE *shape,
+                              const SDF_SHAPE *holes,
+                              long             nhole,
+                              const double    *cs,
+                              double           x,
+                              double           y,
+                              double          *nx,
+                              double          *ny)
+{
+    double d = sdf_shape_eval_cs(shape, cs[0], cs[1], x, y, nx, ny);
+
+    for(long k = 0; k < nhole; k++)
+    {
+        double hnx, hny;
+        double dh = -sdf_shape_eval_cs(&holes[k],
+                                       cs[2 * k + 2],
+                                       cs[2 * k + 3],
+                                       x,
+                                       y,
+                                       &hnx,
+                                       &hny);
+        if(dh > d)
+        {
+            d   = dh;
+            *nx = -hnx;
+            *ny = -hny;
+        }
+    }
+
+    return d;
+}
+
+void sdf_raster(float           *array,
+                uint32_t         xsize,
+                uint32_t         ysize,
+                const SDF_SHAPE *shape,
+                int              op)
+{
+    sdf_raster_holes(array, xsize, ysize, shape, NULL, 0, op);
+}
+
+void sdf_raster_holes(float           *array,
+                      uint32_t         xsize,
+                      uint32_t         ysize,
+                      const SDF_SHAPE *shape,
+                      const SDF_SHAPE *holes,
+                      long             nhole,
+                      int              op)
+{
+    sdf_raster_holes_box(array,
+                         xsize,
+                         0,
+                         xsize,
+                         0,
+                         ysize,
+                         shape,
+                         holes,
+                         nhole,
+                         op);
+}
+
+void sdf_raster_holes_box(float           *array,
+                          uint64_t         stride,
+                          long             wi0,
+                          long             wi1,
+                          long             wj0,
+                          long             wj1,
+                          const SDF_SHAPE *shape,
+                          const SDF_SHAPE *holes,
+                          long             nhole,
+                          int              op)
+{
+    long    i0, i1, j0, j1;
+    double *cs = (double *) malloc(sizeof(double) * 2 * (nhole + 1));
+    if(cs == NULL)
+    {
+        PRINT_ERROR("malloc returns NULL pointer");
+        abort();
+    }
+    cs[0] = cos(shape->angle);
+    cs[1] = sin(shape->angle);
+    for(long k = 0; k < nhole; k++)
+    {
+        cs[2 * k + 2] = cos(holes[k].angle);
+        cs[2 * k + 3] = sin(holes[k].angle);
+    }
+
+    pthread_once(&sdf_covtab_once, sdf_covtab_init);
+    sdf_shape_bbox(shape, wi1, wj1, &i0, &i1, &j0, &j1);
+    i0 = (i0 > wi0) ? i0 : wi0;
+    j0 = (j0 > wj0) ? j0 : wj0;
+
+#ifdef HAVE_LIBGOMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for(long jj = j0; jj < j1; jj++)
+    {
+        float *row = array + (uint64_t)(jj - wj0) * stride - wi0;
+        long   ii  = i0;
+        while(ii < i1)
+        {
+            double nx, ny;
+            double d =
+                sdf_region_eval(shape, holes, nhole, cs, ii, jj, &nx, &ny);
+
+            if(fabs(d) < SDF_DMAX)
+            {
+                float v = sdf_region_coverage(shape, holes, nhole, cs, ii, jj);
+                row[ii] = (op == SDF_RASTER_ADD) ? row[ii] + v : v;
+                ii++;
+                continue;
+            }
+
+            // region SDF is 1-Lipschitz: next pixels are on the same side
+            long  iie = ii + (long)(fabs(d) - SDF_DMAX) + 1;
+            float v   = (d < 0.0) ? 1.0f : 0.0f;
+            if(iie > i1)
+            {
+                iie = i1;
+            }
+            if(op == SDF_RASTER_ADD)
+            {
+                if(d < 0.0)
+                {
+                    for(; ii < iie; ii++)
+                    {
+                        row[ii] += 1.0f;
+                    }
+                }
+                ii = iie;
+            }
+            else
+            {
+                for(; ii < iie; ii++)
+                {
+                    row[ii] = v;
+                }
+            }
+        }
+    }
+
+    free(cs);
+}
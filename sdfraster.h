@@ -0,0 +1,106 @@
+#ifndef IMAGE_GEN_SDFRASTER_H
+#define IMAGE_GEN_SDFRASTER_H
+
+#include <stdint.h>
+
+/** @file sdfraster.h
+ * @brief Anti-aliased shape rasterization from signed distance functions
+ *
+ * Each shape provides its signed distance d (negative inside) and
+ * outward edge normal at the pixel center. Pixel coverage is read from a
+ * table of the exact area of a unit pixel behind a straight edge,
+ * indexed by d and normal direction. Rectangles and lines combine the
+ * coverage of their two pairs of parallel edges, so sub-pixel widths are
+ * exact. Coverage is exact for straight edges; the error is confined to
+ * corner pixels and to the curvature of small disks.
+ */
+
+#define SDF_SHAPE_DISK    0 // a: radius
+#define SDF_SHAPE_RECT    1 // a, b: half-widths along rotated x, y
+#define SDF_SHAPE_HEXAGON 2 // a: inner radius, flat sides along x
+
+// raster operations
+#define SDF_RASTER_SET 0 // pixel = coverage
+#define SDF_RASTER_ADD 1 // pixel += coverage
+
+typedef struct
+{
+    int    type;  // SDF_SHAPE_*
+    double xc;    // center [pixel]
+    double yc;
+    double angle; // rotation [rad], counter-clockwise
+    double a;
+    double b;
+} SDF_SHAPE;
+
+// segment (x1,y1)-(x2,y2) of thickness t, as in make_line
+void sdf_shape_line(SDF_SHAPE *shape,
+                    double     x1,
+                    double     y1,
+                    double     x2,
+                    double     y2,
+                    double     t);
+
+/** @brief Signed distance at (x, y) [pixel], outward normal (nx, ny)
+ */
+double sdf_shape_eval(const SDF_SHAPE *shape,
+                      double           x,
+                      double           y,
+                      double          *nx,
+                      double          *ny);
+
+// coverage of unit pixel at signed distance d from edge of normal n
+float sdf_coverage(double d, double nx, double ny);
+
+// pixel bounding box [*i0, *i1) x [*j0, *j1), clamped to image
+void sdf_shape_bbox(const SDF_SHAPE *shape,
+                    uint32_t         xsize,
+                    uint32_t         ysize,
+                    long            *i0,
+                    long            *i1,
+                    long            *j0,
+                    long            *j1);
+
+/** @brief Rasterize shape into float array
+ *
+ * Only pixels within the shape bounding box are written.
+ */
+void sdf_raster(float           *array,
+                uint32_t         xsize,
+                uint32_t         ysize,
+                const SDF_SHAPE *shape,
+                int              op);
+
+/** @brief Rasterize shape minus the union of holes
+ *
+ * Edges are resolved in a single pass: each pixel near an edge takes the
+ * shape coverage times one minus the largest hole coverage. This is exact
+ * for a hole edge or sub-pixel vane crossing the shape interior.
+ * Overlapping holes and shape / hole corners are approximate. Only
+ * pixels within the shape bounding box are written.
+ */
+void sdf_raster_holes(float           *array,
+                      uint32_t         xsize,
+                      uint32_t         ysize,
+                      const SDF_SHAPE *shape,
+                      const SDF_SHAPE *holes,
+                      long             nhole,
+                      int              op);
+
+/** @brief sdf_raster_holes into window [wi0, wi1) x [wj0, wj1)
+ *
+ * Pixel (ii, jj) is at array[(jj - wj0) * stride + ii - wi0]. Only
+ * pixels within both the window and the shape bounding box are written.
+ */
+void sdf_raster_holes_box(float           *array,
+                          uint64_t         stride,
+                          long             wi0,
+                          long             wi1,
+                          long             wj0,
+                          long             wj1,
+                          const SDF_SHAPE *shape,
+                          const SDF_SHAPE *holes,
+                          long             nhole,
+                          int              op);
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ * @file    testpattern.c
+ * @brief   Test pattern frames for latency and dropped frame measurement
+ *
+ * A reader compares the decoded write time with its own CLOCK_MONOTONIC
+ * time to get the end-to-end latency, and checks that consecutive frame
+ * counters increase by one to count dropped frames. The checkerboard
+ * pattern changes every pixel at every frame, so that a torn frame
+ * (partially updated) is visible.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "CommandLineInterface/CLIcore.h"
+
+#include "testpattern.h"
+
+uint64_t testpattern_time_ns()
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000UL + (uint64_t) t.tv_nsec;
+}
+
+static void testpattern_put64(float *p, uint64_t x)
+{
+    for(int w = 0; w < 4; w++)
+    {
+        p[w] = (float)((x >> (16 * w)) & 0xFFFF);
+    }
+}
+
+static int testpattern_get64(const float *p, uint64_t *x)
+{
+    *x = 0;
+    for(int w = 0; w < 4; w++)
+    {
+        float v = p[w];
+        if(!((v >= 0.0f) && (v <= 65535.0f)) || (v != (float)(int32_t) v))
+        {
+            return -1;
+        }
+        *x |= (uint64_t)(int32_t) v << (16 * w);
+    }
+    return 0;
+}
+
+void testpattern_draw(float   *array,
+                      uint32_t xsize,
+                      uint32_t ysize,
+                      int      pattern,
+                      uint32_t size,
+                      uint64_t frame)
+{
+    uint64_t nelement = (uint64_t) xsize * ysize;
+
+    if(size < 1)
+    {
+        size = 1;
+    }
+
+    switch(pattern)
+    {
+        case TESTPATTERN_SPOT:
+        {
+            // raster scan, wraps around image edges
+            uint32_t x0 = (uint32_t)(frame % xsize);
+            uint32_t y0 = (uint32_t)((frame / xsize) % ysize);
+
+            memset(array, 0, sizeof(float) * nelement);
+            for(uint32_t dy = 0; (dy < size) && (dy < ysize); dy++)
+            {
+                uint64_t jj = (y0 + dy) % ysize;
+                for(uint32_t dx = 0; (dx < size) && (dx < xsize); dx++)
+                {
+                    array[jj * xsize + (x0 + dx) % xsize] = 1.0f;
+                }
+            }
+        }
+        break;
+
+        case TESTPATTERN_CHECKER:
+        {
+            uint32_t phase = (uint32_t)(frame & 1);
+
+#ifdef HAVE_LIBGOMP
+            #pragma omp parallel for schedule(static)
+#endif
+            for(uint32_t jj = 0; jj < ysize; jj++)
+            {
+                uint32_t cy = (jj / size) & 1;
+                for(uint32_t ii = 0; ii < xsize; ii++)
+                {
+                    array[(uint64_t) jj * xsize + ii] =
+                        (float)(((ii / size) & 1) ^ cy ^ phase);
+                }
+            }
+        }
+        break;
+
+        default:
+        {
+            // legacy pattern, frame index instead of static counter
+            uint64_t ii = frame % nelement;
+            if(nelement > TESTPATTERN_NRESERVED)
+            {
+                ii = TESTPATTERN_NRESERVED +
+                     frame % (nelement - TESTPATTERN_NRESERVED);
+            }
+            array[ii] = 1.0f - array[ii];
+        }
+        break;
+    }
+}
+
+uint64_t testpattern_stamp(float *array, uint64_t nelement, uint64_t frame)
+{
+    uint64_t tns = testpattern_time_ns();
+
+    if(nelement >= TESTPATTERN_NRESERVED)
+    {
+        array[0] = (float) TESTPATTERN_MAGIC;
+        testpattern_put64(array + 1, frame);
+        testpattern_put64(array + 5, tns);
+    }
+    return tns;
+}
+
+int testpattern_decode(const float *array,
+                       uint64_t     nelement,
+                       uint64_t    *frame,
+                       uint64_t    *tns)
+{
+    if((nelement < TESTPATTERN_NRESERVED) ||
+            (array[0] != (float) TESTPATTERN_MAGIC))
+    {
+        return -1;
+    }
+    if(testpattern_get64(array + 1, frame) != 0)
+    {
+        return -1;
+    }
+    return testpattern_get64(array + 5, tns);
+}
@@ -0,0 +1,51 @@
+#ifndef IMAGE_GEN_TESTPATTERN_H
+#define IMAGE_GEN_TESTPATTERN_H
+
+#include <stdint.h>
+
+/** @file testpattern.h
+ * @brief Test pattern frames for latency and dropped frame measurement
+ *
+ * The first TESTPATTERN_NRESERVED pixels of each frame hold a marker,
+ * the frame counter and the CLOCK_MONOTONIC write time [ns], as 16-bit
+ * words (exact in float), least significant word first:
+ *   pixel 0     : TESTPATTERN_MAGIC
+ *   pixels 1-4  : frame counter
+ *   pixels 5-8  : write time [ns]
+ * The pattern fills the remaining pixels.
+ */
+
+#define TESTPATTERN_NRESERVED 9
+#define TESTPATTERN_MAGIC     0x7E57
+
+// one pixel toggled per frame (x -> 1-x), pixel index = frame
+#define TESTPATTERN_FLIP    0
+// square spot of side size, moves by one pixel per frame
+#define TESTPATTERN_SPOT    1
+// checkerboard of square side size, inverted every frame
+#define TESTPATTERN_CHECKER 2
+
+void testpattern_draw(float   *array,
+                      uint32_t xsize,
+                      uint32_t ysize,
+                      int      pattern,
+                      uint32_t size,
+                      uint64_t frame);
+
+// write marker, frame counter and current CLOCK_MONOTONIC time
+// returns time written [ns]
+uint64_t testpattern_stamp(float *array, uint64_t nelement, uint64_t frame);
+
+/** @brief Read marker, frame counter and write time
+ *
+ * @return 0 if marker found, -1 otherwise
+ */
+int testpattern_decode(const float *array,
+                       uint64_t     nelement,
+                       uint64_t    *frame,
+                       uint64_t    *tns);
+
+// CLOCK_MONOTONIC time [ns]
+uint64_t testpattern_time_ns();
+
+#endif